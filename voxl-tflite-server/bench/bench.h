@@ -0,0 +1,23 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t bench_nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+// synthetic benchmark against the previous yolov5 and opencv suppression,
+// returns -1 if the results disagree
+int nms_benchmark(void);
+
+// decodes recorded output tensors in dir (synthetic ones for null) with the
+// shared yolo decoders and the ones they replaced, returns -1 if any box,
+// score or class differs
+int decode_benchmark(const char *dir);
+
+#endif // BENCH_H
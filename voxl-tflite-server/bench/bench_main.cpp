@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+// Offline checks of the shared detector code against what it replaced, kept
+// out of the server binary
+
+static void print_usage(void)
+{
+    printf("\nUsage: voxl-tflite-bench <benchmark>\n\n");
+    printf("nms          : the nms engine against the previous suppression on synthetic boxes\n");
+    printf("decode [DIR] : the yolo decoders against the previous ones on the recorded output\n"
+           "               tensors in DIR, synthetic ones without\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && !strcmp(argv[1], "nms"))
+        return nms_benchmark() ? -1 : 0;
+    if (argc >= 2 && !strcmp(argv[1], "decode"))
+        return decode_benchmark(argc >= 3 ? argv[2] : nullptr) ? -1 : 0;
+
+    print_usage();
+    return -1;
+}
@@ -0,0 +1,285 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "detection_decoder.h"
+#include "yolo_decode.h"
+#include "bench.h"
+#include "legacy_decoders.h"
+
+// Compares yolov5_decode and yolov8_decode against the decoders the helpers
+// used before them, run with voxl-tflite-bench decode [DIR].
+//
+// DIR holds raw float32 output tensors, named after the layout and the
+// tensor shape without the batch dimension:
+//   yolov5_<anchors>x<5 + classes>.f32   anchor-major
+//   yolov8_<4 + classes>x<anchors>.f32   channel-major
+// e.g. interpreter.get_tensor(output).tofile("yolov8_84x8400.f32") in python.
+// Without DIR, randomized and tie-heavy synthetic tensors are decoded.
+//
+// Every tensor has to give the same boxes, scores and classes from both.
+
+#define DECODE_BENCH_ITERATIONS 50
+#define DECODE_BENCH_INPUT_W 640 // camera frame the boxes are scaled to
+#define DECODE_BENCH_INPUT_H 480
+
+typedef struct bench_tensor_t
+{
+    std::string name;
+    bool v8;
+    int rows; // as stored, anchors for v5 and channels for v8
+    int cols;
+    std::vector<float> data;
+} bench_tensor_t;
+
+// background everywhere, a few anchors with an object. quantize > 0 rounds
+// every value to that many steps, like a dequantized uint8 output, which
+// makes tied class scores common
+static void make_tensor(std::mt19937 &rng, bool v8, int anchors, int classes,
+                        int quantize, bench_tensor_t &t)
+{
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+    const int channels = (v8 ? 4 : 5) + classes;
+
+    t.v8 = v8;
+    t.rows = v8 ? channels : anchors;
+    t.cols = v8 ? anchors : channels;
+    t.data.assign((size_t)anchors * channels, 0.0f);
+
+    for (int a = 0; a < anchors; a++)
+    {
+        const bool object = uni(rng) < 0.02f;
+        for (int c = 0; c < channels; c++)
+        {
+            float v = c < 4 ? uni(rng) : (object ? uni(rng) : uni(rng) * 0.1f);
+            if (!v8 && c == 4 && object)
+                v = 0.3f + 0.7f * uni(rng);
+            if (quantize > 0)
+                v = std::round(v * quantize) / quantize;
+            t.data[v8 ? (size_t)c * anchors + a : (size_t)a * channels + c] = v;
+        }
+    }
+}
+
+static bool load_tensors(const char *dir, std::vector<bench_tensor_t> &tensors)
+{
+    DIR *d = opendir(dir);
+    if (d == nullptr)
+    {
+        fprintf(stderr, "ERROR: failed to open %s\n", dir);
+        return false;
+    }
+
+    struct dirent *e;
+    while ((e = readdir(d)) != nullptr)
+    {
+        bench_tensor_t t;
+        int v = 0;
+        char ext[8] = {};
+        if (sscanf(e->d_name, "yolov%d_%dx%d.%7s", &v, &t.rows, &t.cols, ext) != 4 ||
+            (v != 5 && v != 8) || strcmp(ext, "f32") || t.rows <= 0 || t.cols <= 0)
+            continue;
+
+        std::string path = std::string(dir) + "/" + e->d_name;
+        FILE *f = fopen(path.c_str(), "rb");
+        if (f == nullptr)
+            continue;
+        t.name = e->d_name;
+        t.v8 = v == 8;
+        t.data.resize((size_t)t.rows * t.cols);
+        const size_t n = fread(t.data.data(), sizeof(float), t.data.size(), f);
+        const bool extra = fgetc(f) != EOF;
+        fclose(f);
+
+        if (n != t.data.size() || extra || t.cols <= (t.v8 ? 0 : 5) || t.rows <= (t.v8 ? 4 : 0))
+        {
+            fprintf(stderr, "WARNING: %s doesn't hold a tensor of its shape, skipping it\n",
+                    e->d_name);
+            continue;
+        }
+        tensors.push_back(std::move(t));
+    }
+    closedir(d);
+
+    std::sort(tensors.begin(), tensors.end(),
+              [](const bench_tensor_t &a, const bench_tensor_t &b) { return a.name < b.name; });
+    return true;
+}
+
+// (class, score bits, box conf bits, x, y, w, h) per box, sorted, so the
+// comparison is exact and doesn't depend on output order
+typedef std::vector<std::vector<int64_t>> box_set_t;
+
+static int64_t bits(float f)
+{
+    int32_t i;
+    memcpy(&i, &f, sizeof(i));
+    return i;
+}
+
+static box_set_t as_set(const std::vector<detection_candidate_t> &c)
+{
+    box_set_t set;
+    for (const auto &b : c)
+        set.push_back({b.class_id, bits(b.class_conf), bits(b.box_conf), b.x, b.y, b.w, b.h});
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+// the winning class score, what the legacy helper ranked by and what
+// class_conf carries now
+static box_set_t as_set(const std::vector<legacy_b_box> &c)
+{
+    box_set_t set;
+    for (const auto &b : c)
+        set.push_back({b.class_id, bits(b.score), bits(b.detection_conf), b.x, b.y, b.w, b.h});
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+static box_set_t as_set(const std::vector<int> &class_ids, const std::vector<float> &confidences,
+                        const std::vector<cv::Rect> &boxes)
+{
+    box_set_t set;
+    for (size_t i = 0; i < boxes.size(); i++)
+        set.push_back({class_ids[i], bits(confidences[i]), bits(-1.0f),
+                       boxes[i].x, boxes[i].y, boxes[i].width, boxes[i].height});
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+// decodes t with both, returns whether they agree and adds the time each took
+static bool compare(const bench_tensor_t &t, double *legacy_us, double *new_us, size_t *num_boxes)
+{
+    std::vector<detection_candidate_t> out;
+    box_set_t legacy_set;
+
+    for (int it = 0; it < DECODE_BENCH_ITERATIONS; it++)
+    {
+        out.clear();
+        if (t.v8)
+        {
+            // the old decoder transposed in place, give it its own copy
+            std::vector<float> copy = t.data;
+            std::vector<int> class_ids;
+            std::vector<float> confidences;
+            std::vector<cv::Rect> boxes;
+
+            uint64_t start = bench_nanos();
+            legacy_yolov8_decode(copy.data(), t.cols, t.rows, t.rows - 4,
+                                 YoloV8Layout::score_threshold,
+                                 DECODE_BENCH_INPUT_W, DECODE_BENCH_INPUT_H,
+                                 class_ids, confidences, boxes);
+            *legacy_us += (bench_nanos() - start) / 1000.0;
+            if (it == 0)
+                legacy_set = as_set(class_ids, confidences, boxes);
+
+            start = bench_nanos();
+            yolov8_decode(t.data.data(), t.cols, t.rows - 4, t.rows - 4,
+                          YoloV8Layout::score_threshold,
+                          DECODE_BENCH_INPUT_W, DECODE_BENCH_INPUT_H, out);
+            *new_us += (bench_nanos() - start) / 1000.0;
+        }
+        else
+        {
+            std::vector<legacy_b_box> bbox_list;
+
+            uint64_t start = bench_nanos();
+            legacy_yolov5_get_bbox(t.data.data(), DECODE_BENCH_INPUT_W, DECODE_BENCH_INPUT_H,
+                                   t.rows, t.cols - 5, YoloV5Layout::box_threshold,
+                                   YoloV5Layout::class_threshold, bbox_list);
+            *legacy_us += (bench_nanos() - start) / 1000.0;
+            if (it == 0)
+                legacy_set = as_set(bbox_list);
+
+            start = bench_nanos();
+            yolov5_decode(t.data.data(), t.rows, t.cols - 5, YoloV5Layout::box_threshold,
+                          YoloV5Layout::class_threshold,
+                          DECODE_BENCH_INPUT_W, DECODE_BENCH_INPUT_H, out);
+            *new_us += (bench_nanos() - start) / 1000.0;
+        }
+    }
+
+    *legacy_us /= DECODE_BENCH_ITERATIONS;
+    *new_us /= DECODE_BENCH_ITERATIONS;
+    *num_boxes = out.size();
+    return as_set(out) == legacy_set;
+}
+
+int decode_benchmark(const char *dir)
+{
+    std::vector<bench_tensor_t> tensors;
+    if (dir != nullptr)
+    {
+        if (!load_tensors(dir, tensors))
+            return -1;
+        if (tensors.empty())
+        {
+            fprintf(stderr, "ERROR: no yolov5_*x*.f32 or yolov8_*x*.f32 tensors in %s\n", dir);
+            return -1;
+        }
+    }
+    else
+    {
+        // 640x640 exports, plus an anchor count that isn't a multiple of the
+        // vector width or the v8 block and a short class list
+        struct synthetic_t
+        {
+            const char *name;
+            bool v8;
+            int anchors;
+            int classes;
+            int quantize;
+        } synthetic[] = {
+            {"v5 random", false, 25200, 80, 0},
+            {"v5 ties", false, 25200, 80, 16},
+            {"v5 odd", false, 1003, 3, 8},
+            {"v8 random", true, 8400, 80, 0},
+            {"v8 ties", true, 8400, 80, 16},
+            {"v8 odd", true, 1003, 3, 8},
+        };
+
+        std::mt19937 rng(5165);
+        for (const auto &s : synthetic)
+        {
+            bench_tensor_t t;
+            make_tensor(rng, s.v8, s.anchors, s.classes, s.quantize, t);
+            t.name = s.name;
+            tensors.push_back(std::move(t));
+        }
+    }
+
+    printf("\ndecoder comparison, %d iterations per tensor, time per frame in us\n\n",
+           DECODE_BENCH_ITERATIONS);
+    printf("%-32s %6s | %10s %10s | %s\n", "tensor", "boxes", "legacy", "new", "result");
+
+    int mismatches = 0;
+    for (const auto &t : tensors)
+    {
+        double legacy_us = 0, new_us = 0;
+        size_t num_boxes = 0;
+        const bool same = compare(t, &legacy_us, &new_us, &num_boxes);
+        if (!same)
+            mismatches++;
+        printf("%-32s %6zu | %10.1f %10.1f | %s\n", t.name.c_str(), num_boxes,
+               legacy_us, new_us, same ? "same" : "DIFFERENT");
+    }
+
+    if (mismatches)
+    {
+        fprintf(stderr, "\nERROR: %d tensors decoded differently than the legacy decoders\n",
+                mismatches);
+        return -1;
+    }
+
+    printf("\nboxes, scores and classes match the legacy decoders\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+#ifndef LEGACY_DECODERS_H
+#define LEGACY_DECODERS_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Output decoding and suppression as the model helpers did it before the
+// shared decoders and nms engine replaced them. The benchmarks check the
+// replacements against these, nothing else may use them.
+
+// box of the old YoloV5ModelHelper
+struct legacy_b_box
+{
+    int32_t class_id;
+    std::string label;
+    float class_conf;
+    float detection_conf;
+    float score;
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+};
+
+// the old YoloV5ModelHelper::nms, kept verbatim apart from the box type
+inline float legacy_calc_iou(const legacy_b_box &obj0, const legacy_b_box &obj1)
+{
+    int32_t interx0 = (std::max)(obj0.x, obj1.x);
+    int32_t intery0 = (std::max)(obj0.y, obj1.y);
+    int32_t interx1 = (std::min)(obj0.x + obj0.w, obj1.x + obj1.w);
+    int32_t intery1 = (std::min)(obj0.y + obj0.h, obj1.y + obj1.h);
+    if (interx1 < interx0 || intery1 < intery0)
+        return 0;
+
+    int32_t area0 = obj0.w * obj0.h;
+    int32_t area1 = obj1.w * obj1.h;
+    int32_t areaInter = (interx1 - interx0) * (intery1 - intery0);
+    int32_t areaSum = area0 + area1 - areaInter;
+
+    return static_cast<float>(areaInter) / areaSum;
+}
+
+inline void legacy_yolov5_nms(std::vector<legacy_b_box> &bbox_list,
+                              std::vector<legacy_b_box> &bbox_nms_list,
+                              float threshold_nms_iou, bool check_class_id)
+{
+    std::sort(bbox_list.begin(), bbox_list.end(),
+              [](legacy_b_box const &lhs, legacy_b_box const &rhs)
+              {
+                  if (lhs.score > rhs.score)
+                      return true;
+                  return false;
+              });
+
+    std::unique_ptr<bool[]> is_merged(new bool[bbox_list.size()]);
+    for (size_t i = 0; i < bbox_list.size(); i++)
+        is_merged[i] = false;
+    for (size_t index_high_score = 0; index_high_score < bbox_list.size();
+         index_high_score++)
+    {
+        std::vector<legacy_b_box> candidates;
+        if (is_merged[index_high_score])
+            continue;
+        candidates.push_back(bbox_list[index_high_score]);
+        for (size_t index_low_score = index_high_score + 1;
+             index_low_score < bbox_list.size(); index_low_score++)
+        {
+            if (is_merged[index_low_score])
+                continue;
+            if (check_class_id && bbox_list[index_high_score].class_id !=
+                                      bbox_list[index_low_score].class_id)
+                continue;
+            if (legacy_calc_iou(bbox_list[index_high_score],
+                                bbox_list[index_low_score]) > threshold_nms_iou)
+            {
+                candidates.push_back(bbox_list[index_low_score]);
+                is_merged[index_low_score] = true;
+            }
+        }
+        bbox_nms_list.push_back(candidates[0]);
+    }
+}
+
+// the old YoloV5ModelHelper::get_bbox, kept verbatim apart from the box type
+// and walking every grid scale in one loop, which visits the anchors in the
+// same order
+inline void legacy_yolov5_get_bbox(const float *data, float scale_x, float scale_y,
+                                   int32_t num_anchors, int number_of_classes,
+                                   float threshold_box_confidence_,
+                                   float threshold_class_confidence_,
+                                   std::vector<legacy_b_box> &bbox_list)
+{
+    int32_t index = 0;
+    int32_t kNumberOfClass = number_of_classes;
+    int32_t kElementNumOfAnchor = kNumberOfClass + 5; // x, y, w, h, bbox confidence, [class confidence]
+
+    for (int32_t anchor = 0; anchor < num_anchors; anchor++)
+    {
+        float box_confidence = data[index + 4];
+
+        if (box_confidence >= threshold_box_confidence_)
+        {
+            int32_t class_id = 0;
+            float confidence = 0;
+            float confidence_of_class = 0;
+            for (int32_t class_index = 0; class_index < kNumberOfClass;
+                 class_index++)
+            {
+                confidence_of_class = data[index + 5 + class_index];
+                if (confidence_of_class > confidence)
+                {
+                    confidence = confidence_of_class;
+                    class_id = class_index;
+                }
+            }
+
+            if (confidence >= threshold_class_confidence_)
+            {
+                int32_t cx = static_cast<int32_t>((data[index + 0] + 0) * scale_x);
+                int32_t cy = static_cast<int32_t>((data[index + 1] + 0) * scale_y);
+                int32_t w = static_cast<int32_t>(data[index + 2] * scale_x);
+                int32_t h = static_cast<int32_t>(data[index + 3] * scale_y);
+                int32_t x = cx - w / 2;
+                int32_t y = cy - h / 2;
+                legacy_b_box bbox = {class_id, "", confidence_of_class, box_confidence,
+                                     confidence, x, y, w, h};
+                bbox_list.push_back(bbox);
+            }
+        }
+        index += kElementNumOfAnchor;
+    }
+}
+
+// the old YoloV8ModelHelper decode, transpose to anchor-major then a
+// minMaxLoc over the classes of each anchor
+inline void legacy_yolov8_decode(float *data, int rows, int dimensions, int label_count,
+                                 float model_score_threshold, int input_width, int input_height,
+                                 std::vector<int> &class_ids, std::vector<float> &confidences,
+                                 std::vector<cv::Rect> &boxes)
+{
+    cv::Mat temp(dimensions, rows, CV_32F, data);
+    cv::transpose(temp, temp);
+    float *new_data = (float *)temp.data;
+
+    for (int i = 0; i < rows; i++)
+    {
+        float *classes_scores = new_data + 4;
+
+        cv::Mat scores(1, label_count, CV_32FC1, classes_scores);
+        cv::Point class_id;
+        double maxClassScore;
+
+        cv::minMaxLoc(scores, 0, &maxClassScore, 0, &class_id);
+
+        if (maxClassScore > model_score_threshold)
+        {
+            confidences.push_back(maxClassScore);
+            class_ids.push_back(class_id.x);
+
+            float xc = new_data[0];
+            float yc = new_data[1];
+            float w = new_data[2];
+            float h = new_data[3];
+
+            int left = int((xc - 0.5 * w) * input_width);
+            int top = int((yc - 0.5 * h) * input_height);
+
+            int width = int(w * input_width);
+            int height = int(h * input_height);
+
+            boxes.push_back(cv::Rect(left, top, width, height));
+        }
+        new_data += dimensions;
+    }
+}
+
+#endif // LEGACY_DECODERS_H
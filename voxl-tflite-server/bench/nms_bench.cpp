@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "nms.h"
+#include "bench.h"
+#include "legacy_decoders.h"
+
+// Synthetic benchmark of NmsEngine against the suppression we used before it,
+// run with voxl-tflite-bench nms. Boxes are jittered copies around a
+// set of objects, roughly what a detector emits before nms.
+
+#define BENCH_ITERATIONS 200
+
+typedef struct bench_box_t
+{
+    int32_t class_id;
+    float score;
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+} bench_box_t;
+
+// the algorithm cv::dnn::NMSBoxes runs for the yolov8 helper (eta = 1,
+// top_k = 0), reproduced since we no longer link opencv_dnn
+static void reference_nms_boxes(const std::vector<bench_box_t> &boxes,
+                                float score_threshold, float nms_threshold,
+                                std::vector<int> &indices)
+{
+    std::vector<std::pair<float, int>> score_index;
+    for (size_t i = 0; i < boxes.size(); i++)
+        if (boxes[i].score > score_threshold)
+            score_index.push_back(std::make_pair(boxes[i].score, (int)i));
+
+    std::stable_sort(score_index.begin(), score_index.end(),
+                     [](const std::pair<float, int> &a, const std::pair<float, int> &b)
+                     { return a.first > b.first; });
+
+    indices.clear();
+    for (const auto &si : score_index)
+    {
+        const bench_box_t &a = boxes[si.second];
+        bool keep = true;
+        for (size_t k = 0; k < indices.size() && keep; k++)
+        {
+            const bench_box_t &b = boxes[indices[k]];
+            int ix = std::min(a.x + a.w, b.x + b.w) - std::max(a.x, b.x);
+            int iy = std::min(a.y + a.h, b.y + b.h) - std::max(a.y, b.y);
+            double inter = (ix > 0 && iy > 0) ? (double)ix * iy : 0.0;
+            double overlap = inter / ((double)a.w * a.h + (double)b.w * b.h - inter);
+            keep = overlap <= nms_threshold;
+        }
+        if (keep)
+            indices.push_back(si.second);
+    }
+}
+
+static void make_scene(std::mt19937 &rng, int num_objects, int boxes_per_object,
+                       int num_classes, std::vector<bench_box_t> &out)
+{
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+    std::normal_distribution<float> jitter(0.0f, 0.05f);
+
+    out.clear();
+    for (int o = 0; o < num_objects; o++)
+    {
+        float cx = uni(rng) * 640.0f;
+        float cy = uni(rng) * 480.0f;
+        float w = 16.0f + uni(rng) * 120.0f;
+        float h = 16.0f + uni(rng) * 120.0f;
+        int cls = (int)(uni(rng) * num_classes);
+
+        for (int b = 0; b < boxes_per_object; b++)
+        {
+            bench_box_t box;
+            box.w = (int32_t)(w * (1.0f + jitter(rng)));
+            box.h = (int32_t)(h * (1.0f + jitter(rng)));
+            box.x = (int32_t)(cx + w * jitter(rng)) - box.w / 2;
+            box.y = (int32_t)(cy + h * jitter(rng)) - box.h / 2;
+            // a few neighbours get a different class, like real yolo output
+            box.class_id = (uni(rng) < 0.1f) ? (int)(uni(rng) * num_classes) : cls;
+            box.score = 0.25f + 0.75f * uni(rng);
+            out.push_back(box);
+        }
+    }
+}
+
+// kept box sets as sorted (x, y, w, h, class) tuples so results from
+// implementations with different output order compare equal
+static std::vector<std::vector<int32_t>> as_set(const std::vector<bench_box_t> &boxes,
+                                               const std::vector<int> &idx)
+{
+    std::vector<std::vector<int32_t>> set;
+    for (int i : idx)
+        set.push_back({boxes[i].x, boxes[i].y, boxes[i].w, boxes[i].h, boxes[i].class_id});
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+static std::vector<std::vector<int32_t>> as_set(const std::vector<legacy_b_box> &boxes)
+{
+    std::vector<std::vector<int32_t>> set;
+    for (const auto &b : boxes)
+        set.push_back({b.x, b.y, b.w, b.h, b.class_id});
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+static void run_engine(NmsEngine &engine, const std::vector<bench_box_t> &boxes,
+                       const nms_params_t &params, std::vector<int> &keep)
+{
+    engine.clear();
+    for (const auto &b : boxes)
+        engine.add(b.x, b.y, b.x + b.w, b.y + b.h, b.score, b.class_id);
+    engine.run(params, keep);
+}
+
+int nms_benchmark(void)
+{
+    struct scene_t
+    {
+        const char *name;
+        int num_objects;
+        int boxes_per_object;
+    } scenes[] = {
+        {"sparse", 5, 20},
+        {"typical", 20, 50},
+        {"crowded", 300, 20},
+    };
+
+    std::mt19937 rng(5165);
+    std::vector<bench_box_t> boxes;
+    NmsEngine engine;
+    std::vector<int> keep;
+    std::vector<int> reference;
+    int mismatches = 0;
+
+    printf("\nnms benchmark, %d iterations per scene, time per frame in us\n\n", BENCH_ITERATIONS);
+    printf("%-8s %6s | %12s %12s | %10s %10s %10s %10s %10s\n",
+           "scene", "boxes", "legacy_v5", "nms_boxes",
+           "hard", "hard_cls", "grid", "soft_lin", "hard_top300");
+
+    for (const auto &scene : scenes)
+    {
+        make_scene(rng, scene.num_objects, scene.boxes_per_object, 80, boxes);
+
+        nms_params_t hard;
+        hard.iou_threshold = 0.5f;
+        nms_params_t hard_cls = hard;
+        hard_cls.class_aware = true;
+        nms_params_t grid = hard;
+        grid.method = NMS_GRID;
+        nms_params_t soft = hard;
+        soft.method = NMS_SOFT_LINEAR;
+        soft.score_threshold = 0.25f;
+        nms_params_t top = hard;
+        top.top_k = 300;
+
+        // correctness first, hard and grid must keep what the old code kept
+        std::vector<legacy_b_box> legacy_in, legacy_out;
+        for (const auto &b : boxes)
+            legacy_in.push_back({b.class_id, "", b.score, -1.0f, b.score, b.x, b.y, b.w, b.h});
+        legacy_yolov5_nms(legacy_in, legacy_out, 0.5f, false);
+        auto legacy_set = as_set(legacy_out);
+
+        reference_nms_boxes(boxes, 0.0f, 0.5f, reference);
+        auto reference_set = as_set(boxes, reference);
+
+        run_engine(engine, boxes, hard, keep);
+        if (as_set(boxes, keep) != legacy_set || as_set(boxes, keep) != reference_set)
+            mismatches++;
+        run_engine(engine, boxes, grid, keep);
+        if (as_set(boxes, keep) != legacy_set)
+            mismatches++;
+
+        legacy_in.clear();
+        for (const auto &b : boxes)
+            legacy_in.push_back({b.class_id, "", b.score, -1.0f, b.score, b.x, b.y, b.w, b.h});
+        legacy_out.clear();
+        legacy_yolov5_nms(legacy_in, legacy_out, 0.5f, true);
+        run_engine(engine, boxes, hard_cls, keep);
+        if (as_set(boxes, keep) != as_set(legacy_out))
+            mismatches++;
+
+        // timing, inputs are rebuilt every iteration like a real frame
+        double t[7] = {0};
+        for (int it = 0; it < BENCH_ITERATIONS; it++)
+        {
+            uint64_t start = bench_nanos();
+            legacy_in.clear();
+            legacy_out.clear();
+            for (const auto &b : boxes)
+                legacy_in.push_back({b.class_id, "", b.score, -1.0f, b.score, b.x, b.y, b.w, b.h});
+            legacy_yolov5_nms(legacy_in, legacy_out, 0.5f, false);
+            t[0] += bench_nanos() - start;
+
+            start = bench_nanos();
+            reference_nms_boxes(boxes, 0.0f, 0.5f, reference);
+            t[1] += bench_nanos() - start;
+
+            const nms_params_t *params[] = {&hard, &hard_cls, &grid, &soft, &top};
+            for (int p = 0; p < 5; p++)
+            {
+                start = bench_nanos();
+                run_engine(engine, boxes, *params[p], keep);
+                t[2 + p] += bench_nanos() - start;
+            }
+        }
+
+        for (double &v : t)
+            v /= BENCH_ITERATIONS * 1000.0;
+
+        printf("%-8s %6d | %12.1f %12.1f | %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+               scene.name, (int)boxes.size(), t[0], t[1], t[2], t[3], t[4], t[5], t[6]);
+    }
+
+    if (mismatches)
+    {
+        fprintf(stderr, "\nERROR: %d scenes kept different boxes than the legacy nms\n", mismatches);
+        return -1;
+    }
+
+    printf("\nhard, grid and hard_cls keep the same boxes as the legacy implementations\n");
+    return 0;
+}
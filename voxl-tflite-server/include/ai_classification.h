@@ -0,0 +1,31 @@
+#ifndef AI_CLASSIFICATION_H
+#define AI_CLASSIFICATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ai_detection.h"
+
+#define AI_CLASSIFICATION_MAGIC_NUMBER (0x564F5843)
+#define AI_CLASSIFICATION_MAX_K 16
+
+// one ranked result of a tflite classification model, each frame publishes
+// classification_top_k of these back to back, best first
+typedef struct ai_classification_t {
+    uint32_t magic_number;
+    int64_t timestamp_ns;   // timestamp of the camera frame that was classified
+    int32_t frame_id;
+    uint32_t class_id;      // index into the labels file
+    uint32_t rank;          // 0 is the best scoring class
+    float score;            // dequantized model output
+    char class_name[BUF_LEN];
+    char cam[BUF_LEN];
+} __attribute__((packed)) ai_classification_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AI_CLASSIFICATION_H
@@ -0,0 +1,43 @@
+#ifndef AI_POSE_H
+#define AI_POSE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ai_detection.h"
+
+#define AI_POSE_MAGIC_NUMBER (0x564F5850)
+#define AI_POSE_NUM_KEYPOINTS 17
+
+// keypoint order follows COCO: nose, left/right eye, left/right ear,
+// left/right shoulder, left/right elbow, left/right wrist, left/right hip,
+// left/right knee, left/right ankle
+typedef struct ai_pose_keypoint_t {
+    float x;            // input image pixels
+    float y;
+    float confidence;
+} __attribute__((packed)) ai_pose_keypoint_t;
+
+// one person found by a tflite pose model, each frame publishes one of these
+// per person back to back
+typedef struct ai_pose_t {
+    uint32_t magic_number;
+    int64_t timestamp_ns;   // timestamp of the camera frame the pose came from
+    int32_t frame_id;
+    uint32_t person_id;     // index of the person within the frame
+    float score;            // person score, mean keypoint confidence for single pose models
+    float x_min;            // person bounding box in input image pixels
+    float y_min;
+    float x_max;
+    float y_max;
+    char cam[BUF_LEN];
+    ai_pose_keypoint_t keypoints[AI_POSE_NUM_KEYPOINTS];
+} __attribute__((packed)) ai_pose_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AI_POSE_H
@@ -0,0 +1,42 @@
+#ifndef AI_STEREO_H
+#define AI_STEREO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ai_detection.h"
+
+#define AI_STEREO_DETECTION_MAGIC_NUMBER (0x564F5853)
+
+// one object of a tflite object detection model seen by both eyes of a
+// stereo pipe, each frame publishes one of these per matched pair back to
+// back. Boxes are in their own eye's image pixels
+typedef struct ai_stereo_detection_t {
+    uint32_t magic_number;
+    int64_t timestamp_ns;   // timestamp of the newer of the two camera frames
+    int32_t frame_id;
+    uint32_t class_id;
+    char class_name[BUF_LEN];
+    char cam[BUF_LEN];      // stereo pipe name
+    float class_confidence; // lower of the two eyes
+    float left_x_min;
+    float left_y_min;
+    float left_x_max;
+    float left_y_max;
+    float right_x_min;
+    float right_y_min;
+    float right_x_max;
+    float right_y_max;
+    float x;                // box center in the left camera frame (x right, y down,
+    float y;                // z forward), units of the stereo extrinsics (m)
+    float z;
+    float range;            // distance of the box center from the left camera
+} __attribute__((packed)) ai_stereo_detection_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AI_STEREO_H
@@ -0,0 +1,42 @@
+#ifndef AI_TRACK_H
+#define AI_TRACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ai_detection.h"
+
+#define AI_TRACK_MAGIC_NUMBER (0x564F5854)
+
+#define AI_TRACK_DETECTED   0 // box came from the network this frame
+#define AI_TRACK_PROPAGATED 1 // box was carried over by optical flow
+
+// one tracked object of a tflite object detection model, each frame
+// publishes one of these per live track back to back
+typedef struct ai_track_t {
+    uint32_t magic_number;
+    int64_t timestamp_ns;   // timestamp of the camera frame
+    int32_t frame_id;
+    uint32_t track_id;      // stable across frames, never reused
+    uint32_t class_id;
+    uint32_t age_frames;    // frames since the track was created
+    uint8_t source;         // AI_TRACK_DETECTED or AI_TRACK_PROPAGATED
+    uint8_t reserved[3];
+    char class_name[BUF_LEN];
+    char cam[BUF_LEN];
+    float confidence;       // detection score decayed by the flow quality
+    float x_min;            // input image pixels
+    float y_min;
+    float x_max;
+    float y_max;
+    float vx;               // box center velocity, pixels/s
+    float vy;
+} __attribute__((packed)) ai_track_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AI_TRACK_H
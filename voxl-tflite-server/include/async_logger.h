@@ -0,0 +1,43 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <stdint.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define ASYNC_LOGGER_LINE_LEN 256
+#define ASYNC_LOGGER_QUEUE 8
+
+// Rate limited stdout logging for the inference hot path.
+//
+// log() formats into a fixed slot and returns, the actual write to stdout
+// (and the journal behind it) happens on a background thread. Lines arriving
+// faster than max_rate_hz, or while the queue is full, are dropped and
+// counted so the caller never blocks on I/O.
+class AsyncLogger
+{
+public:
+    explicit AsyncLogger(float max_rate_hz);
+    ~AsyncLogger();
+
+    void log(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+    void run();
+
+    uint64_t min_interval_ns;
+    uint64_t last_log_ns = 0;
+    int num_dropped = 0;
+
+    char lines[ASYNC_LOGGER_QUEUE][ASYNC_LOGGER_LINE_LEN];
+    int head = 0;
+    int count = 0;
+    bool running = true;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread thread;
+};
+
+#endif // ASYNC_LOGGER_H
@@ -0,0 +1,95 @@
+#ifndef CAMERA_CALIBRATION_H
+#define CAMERA_CALIBRATION_H
+
+#include <stdint.h>
+
+#define CAMERA_CALIBRATION_DIR "/data/modalai/"
+#define CAMERA_CALIBRATION_MAX_DIST 8
+
+// Lens intrinsics as written by voxl-calibrate-camera
+typedef struct camera_calibration_t
+{
+    int width;  // resolution the calibration was done at, 0 if not in the file
+    int height;
+    double fx;
+    double fy;
+    double cx;
+    double cy;
+    bool fisheye; // 4 coefficient fisheye model, otherwise opencv radtan
+    int n_dist;
+    double dist[CAMERA_CALIBRATION_MAX_DIST];
+} camera_calibration_t;
+
+// Loads CAMERA_CALIBRATION_DIR/opencv_<cam>_intrinsics.yml. Stream names that
+// have no file of their own fall back to the camera they are derived from by
+// dropping trailing _suffixes (hires_small_color -> hires_small -> hires).
+// Returns 0 on success, -1 if no calibration file was found or parsed.
+int camera_calibration_load(const char *cam_name, camera_calibration_t *cal);
+
+// Stereo pair as written by voxl-calibrate-camera, R and T take points from
+// the left camera frame into the right one (x_r = R x_l + T)
+typedef struct stereo_calibration_t
+{
+    camera_calibration_t left;
+    camera_calibration_t right;
+    double R[9]; // row major
+    double T[3]; // units of the calibration target, meters
+} stereo_calibration_t;
+
+// Loads M1/D1, M2/D2 from CAMERA_CALIBRATION_DIR/opencv_<cam>_intrinsics.yml
+// and R/T from opencv_<cam>_extrinsics.yml, with the same stream name
+// fallback as camera_calibration_load. Returns 0 on success, -1 otherwise.
+int stereo_calibration_load(const char *cam_name, stereo_calibration_t *cal);
+
+// Fills the unit-depth ray (x/z, y/z) of every pixel of a width x height image
+// that was resized from an input_width x input_height stream of the calibrated
+// camera, with the lens distortion already removed. Built once so projecting
+// depth is a multiply per coordinate.
+void camera_calibration_build_rays(const camera_calibration_t *cal,
+                                   int input_width, int input_height,
+                                   int width, int height,
+                                   float *ray_x, float *ray_y);
+
+// unit-depth rays of n pixels (x[i], y[i]) of an input_width x input_height
+// stream of the calibrated camera, same conventions as the function above
+void camera_calibration_undistort_points(const camera_calibration_t *cal,
+                                         int input_width, int input_height,
+                                         const float *x, const float *y, int n,
+                                         float *ray_x, float *ray_y);
+
+// Corrections folded into the model input map by camera_calibration_build_remap
+typedef struct input_correction_t
+{
+    bool undistort; // remove the lens distortion, needs a calibration
+    int rotation;   // clockwise degrees after undistortion, 0, 90, 180 or 270
+    bool flip;      // mirror horizontally after the rotation
+} input_correction_t;
+
+// size of the corrected view of an input_width x input_height stream, the
+// input size with width and height swapped for 90 and 270 degrees
+void camera_correction_size(const input_correction_t *corr, int input_width,
+                            int input_height, int *width, int *height);
+
+// Fills the position in an input_width x input_height stream of the camera
+// that every pixel of a width x height image of the corrected view samples,
+// spaced like an mcv resize map of the corrected view, for mcv_init_remap.
+// The undistorted view is a pinhole camera cropped to valid pixels. cal can
+// be null when corr->undistort is false.
+//
+// When undistorting, corrected gets the pinhole intrinsics of the corrected
+// view at its own size (rotated, negative fx when flipped so rays keep the
+// real geometry), for camera_calibration_build_rays. Pass null if unused.
+void camera_calibration_build_remap(const camera_calibration_t *cal,
+                                    const input_correction_t *corr,
+                                    int input_width, int input_height,
+                                    int width, int height,
+                                    float *src_x, float *src_y,
+                                    camera_calibration_t *corrected);
+
+// Projects n depth values along their rays into packed float xyz points in the
+// camera frame (x right, y down, z forward). Output is organized, point i
+// belongs to depth pixel i, and pixels without a positive depth become NaN.
+void depth_to_points(const float *depth, const float *ray_x, const float *ray_y,
+                     int n, float *xyz);
+
+#endif // CAMERA_CALIBRATION_H
@@ -0,0 +1,79 @@
+#ifndef CAMERA_SCHEDULER_H
+#define CAMERA_SCHEDULER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "model_helper/model_helper.h"
+
+#define MAX_CAMERAS (1 + MAX_EXTRA_CAMERAS)
+#define CAMERA_CHANNELS 8             // output channels per camera, every *_CH fits
+#define SCHEDULER_MAX_FRAME_AGE_MS 500 // queued frames older than this are dropped
+#define SCHEDULER_STATS_PERIOD_S 5.0   // en_timing prints the camera stats this often
+
+// One camera pipe the server subscribes to. The helper holds everything per
+// camera (frame queue, resize maps, results, output channels), helpers after
+// the first run on the first one's interpreter.
+struct CameraStream
+{
+    ModelHelper *helper = nullptr;
+    std::string pipe;
+    int client_ch = -1; // input pipe channel
+    int priority = 1;   // share of the interpreter against the other cameras
+    float rate_hz = 0;  // most frames run per second, 0 for no limit
+    int n_skipped = 0;  // skip_n_frames counter, camera callback only
+
+    // scheduler state, guarded by the scheduler
+    uint64_t read_count = 0; // camera_queue.written when a frame was last taken
+    double pass = 0;         // stride scheduling position, advances 1/priority per frame
+    int64_t next_due_ns = 0; // rate_hz limit
+
+    // stats, guarded by the scheduler
+    uint64_t frames_run = 0;
+    uint64_t frames_dropped = 0; // superseded by a newer frame or too old
+    double total_wait_ms = 0;    // frame age when it was taken
+};
+
+// Decides which camera's frame the pipeline preprocesses next.
+//
+// Cameras share the interpreter by stride scheduling: each frame a camera
+// runs advances its pass by 1/priority and the camera with a frame waiting
+// and the lowest pass goes next, so over time every camera gets frames in
+// proportion to its priority and none can starve the others. A camera that
+// was idle rejoins at the current pass instead of catching up. rate_hz holds
+// a camera back until its next frame is due, ties go to the older frame.
+//
+// Only the newest queued frame of a camera is run, the ones before it and
+// any older than SCHEDULER_MAX_FRAME_AGE_MS are dropped, so a camera that
+// had to wait doesn't work through a backlog.
+class CameraScheduler
+{
+public:
+    void add(CameraStream *stream);
+    const std::vector<CameraStream *> &get_streams() { return streams; }
+
+    // blocks until a frame is due, returns its camera and queue slot, null
+    // once main_running is cleared. The slot stays reserved until
+    // camera_queue.release(). Preprocess thread only
+    CameraStream *next(int *slot);
+
+    // a camera queued a frame (or the server is stopping)
+    void notify();
+
+    // per camera rates, drops and waits since the last print, at most every
+    // SCHEDULER_STATS_PERIOD_S. Called from the main loop
+    void print_stats();
+
+private:
+    std::vector<CameraStream *> streams;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool pending = false;
+    double vtime = 0; // pass of the last frame taken
+    int64_t stats_start_ns = 0;
+};
+
+#endif // CAMERA_SCHEDULER_H
@@ -38,6 +38,8 @@
 #include <stdio.h>
 
 #define CHAR_BUF_SIZE 128
+#define MAX_EXTRA_CAMERAS 3
+#define MAX_POOL_INTERPRETERS 3
 #define CONFIG_FILE "/etc/modalai/voxl-tflite-server.conf"
 
 #ifdef BUILD_QRB5165
@@ -51,15 +53,114 @@
  * model               - which model to use. Currently support mobilenet, fastdepth,\n\
  *                         posenet, deeplab, and yolov5.\n\
  * input_pipe          - which camera to use (tracking, hires, or stereo).\n\
+ * input_priority      - share of the interpreter input_pipe gets against the\n\
+ *                         extra_cameras, 2 runs twice as many frames as a camera with 1.\n\
+ * input_rate_hz       - most frames per second run from input_pipe, 0 for no limit.\n\
+ * extra_cameras       - more camera pipes run through the same model and interpreter\n\
+ *                         as [{\"input_pipe\": ..., \"priority\": 1, \"rate_hz\": 0}], up to 3.\n\
+ *                         Frames are interleaved by priority and rate, newest first, and\n\
+ *                         every camera gets its own output pipes named with a _<camera>\n\
+ *                         suffix. input_scale_levels is off with extra cameras.\n\
  * delegate            - optional hardware acceleration: gpu, cpu, or nnapi. If\n\
  *                         the selection is invalid for the current model/hardware, \n\
  *                         will silently fall back to base cpu delegate.\n\
+ * interpreter_pool    - extra interpreters of the model (up to 3) run next to the\n\
+ *                         main one, frames go to whichever is free and the results\n\
+ *                         are published in frame order. 0 disables.\n\
+ * interpreter_pool_delegate - delegate of the extra interpreters: cpu, gpu or nnapi.\n\
+ * interpreter_pool_threads  - cpu threads of each extra interpreter.\n\
+ *                         Not with tiling, roi, the tracker, stereo or input_scale_levels.\n\
+ * invoke_arbiter      - order gpu/nnapi invokes with every other model that has it on,\n\
+ *                         in this and other voxl-tflite-server instances, earliest\n\
+ *                         deadline first. --timing prints misses and shed frames per model.\n\
+ * model_priority      - frames of lower priority models that would miss their deadline\n\
+ *                         are dropped while a higher priority model waits.\n\
+ * model_deadline_ms   - deadline of a frame from its camera timestamp.\n\
+ * arbiter_shed        - drop frames under overload as above, otherwise they run late.\n\
  * allow_multiple      - remove process handling and allow multiple instances\n\
  *                         of voxl-tflite-server to run. Enables the ability\n\
  *                         to run multiples models simultaneously.\n\
  * output_pipe_prefix  - if allow_multiple is set, create output pipes using default\n\
  *                         names (tflite, tflite_data) with added prefix.\n\
  *                         ONLY USED IF allow_multiple is set to true.\n\
+ * idle_suspend_s      - seconds without any output pipe clients before the camera\n\
+ *                         pipe is paused and the pipeline goes idle. 0 disables.\n\
+ * idle_release_s      - seconds without any output pipe clients before the\n\
+ *                         interpreter, delegate and frame buffers are released\n\
+ *                         to free memory. Rebuilt when a client connects. 0 disables.\n\
+ * gpu_cache_dir       - directory used to serialize compiled gpu delegate kernels so\n\
+ *                         startup and resume from release are fast. Empty disables.\n\
+ * overlay_rate_hz     - max rate the annotated image is rendered and published at,\n\
+ *                         independent of the inference rate. 0 renders every frame.\n\
+ *                         Nothing is rendered while the image pipe has no clients.\n\
+ * overlay_width       - width to downscale the published annotated image to, aspect\n\
+ *                         ratio is kept. 0 publishes at the input resolution.\n\
+ * overlay_jpeg        - publish the annotated image jpeg compressed instead of raw.\n\
+ * overlay_jpeg_quality- jpeg quality (1-100) used when overlay_jpeg is enabled.\n\
+ * nms_method          - non-maximum suppression used by the object detectors: hard,\n\
+ *                         grid (hard, faster for crowded frames), soft_linear or\n\
+ *                         soft_gaussian.\n\
+ * nms_class_aware     - only suppress overlapping boxes of the same class. When\n\
+ *                         false a box suppresses any class.\n\
+ * nms_top_k           - only the top_k highest scoring boxes enter nms. 0 keeps all.\n\
+ * segmentation_mask_rle - run-length encode the class mask published on tflite_data\n\
+ *                         by segmentation models. false publishes the raw mask.\n\
+ * classification_top_k - number of best classes classification models publish and\n\
+ *                         draw per frame (1-16).\n\
+ * gate_estimate_rate_hz - rate the filtered, latency compensated gate state is\n\
+ *                         published at on tflite_gate_estimate. 0 disables.\n\
+ * tracker_detect_interval - object detection models only. 0 publishes raw\n\
+ *                         detections. 1 also tracks them with persistent ids on\n\
+ *                         tflite_tracks. N > 1 only runs the network every N\n\
+ *                         frames and moves the tracks with optical flow between.\n\
+ * tracker_min_confidence - run the network early when a tracked box falls below\n\
+ *                         this confidence (0-1).\n\
+ * scene_change_threshold - skip inference and republish the last results while\n\
+ *                         no cell of a 32x24 luma thumbnail changed by this many\n\
+ *                         gray levels since the last inferred frame. 0 disables.\n\
+ * scene_change_max_interval_s - run the model at least this often even if the\n\
+ *                         scene looks unchanged.\n\
+ * tiled_inference     - object detection models only. Frames larger than the model\n\
+ *                         input are also cut into overlapping model sized tiles at\n\
+ *                         native resolution so small objects are not lost.\n\
+ * tile_overlap        - minimum overlap of neighbouring tiles (0-0.9).\n\
+ * tile_refresh_frames - tiles without detections or motion are skipped for up\n\
+ *                         to this many frames. 0 runs every tile every frame.\n\
+ * roi_mode            - object detection models only, ignored when tiled. off runs\n\
+ *                         the whole frame. static always runs the roi_window crop.\n\
+ *                         follow crops around the last detections or tracks.\n\
+ * roi_window          - static crop as [x, y, width, height] fractions of the frame.\n\
+ * roi_margin          - follow mode, space kept around the detections as a fraction\n\
+ *                         of their size on every side.\n\
+ * roi_smoothing       - follow mode, 0 jumps to the new detections, closer to 1\n\
+ *                         moves the window more slowly.\n\
+ * roi_full_frame_interval - follow mode, run the whole frame every this many\n\
+ *                         frames to pick up new targets. 0 only when the target is lost.\n\
+ * latency_budget_ms   - object detection models only. When the smoothed inference\n\
+ *                         time stays over this budget the model input is switched to a\n\
+ *                         smaller prepared resolution, and back up once there is\n\
+ *                         headroom. 0 always runs the model's own input size.\n\
+ * input_scale_levels  - resolutions prepared for latency_budget_ms, stepping down by a\n\
+ *                         quarter of the model input size (3 gives 640, 480, 320 for yolo).\n\
+ * letterbox_input     - object detection and pose models only. Fit the frame into\n\
+ *                         the model input keeping its aspect ratio, padded with gray,\n\
+ *                         instead of stretching it. Matches how yolo models are trained.\n\
+ * input_undistort     - remove the lens distortion from the model input using the\n\
+ *                         camera's calibration in /data/modalai/. Folded into the\n\
+ *                         resize map with the rotation and flip, no per frame cost.\n\
+ * input_rotation      - rotate the model input clockwise by 0, 90, 180 or 270\n\
+ *                         degrees, for cameras mounted sideways or upside down.\n\
+ * input_flip          - mirror the model input horizontally after the rotation.\n\
+ *                         With any of these three set, results and the overlay are in\n\
+ *                         the corrected view and tiling and roi crops are off.\n\
+ * stereo_mode         - object detection models on a stereo pipe. left runs the\n\
+ *                         left eye only. both runs both eyes every frame, alternate runs\n\
+ *                         one eye per frame at half the rate each. Detections are tagged\n\
+ *                         <cam>_left and <cam>_right. Needs tiling, roi, the tracker and\n\
+ *                         input correction off.\n\
+ * stereo_triangulate  - with both or alternate, match boxes of the same class between\n\
+ *                         the eyes and publish their rough 3D position and range on\n\
+ *                         tflite_stereo, from the stereo calibration in /data/modalai/.\n\
  */\n"
 #endif
 
@@ -74,19 +175,171 @@
  * model               - which model to use. Currently support mobilenet, fastdepth,\n\
  *                         posenet, deeplab, and yolov5.\n\
  * input_pipe         - which camera to use (tracking, hires, or stereo).\n\
+ * input_priority     - share of the interpreter input_pipe gets against the\n\
+ *                        extra_cameras, 2 runs twice as many frames as a camera with 1.\n\
+ * input_rate_hz      - most frames per second run from input_pipe, 0 for no limit.\n\
+ * extra_cameras      - more camera pipes run through the same model and interpreter\n\
+ *                        as [{\"input_pipe\": ..., \"priority\": 1, \"rate_hz\": 0}], up to 3.\n\
+ *                        Frames are interleaved by priority and rate, newest first, and\n\
+ *                        every camera gets its own output pipes named with a _<camera>\n\
+ *                        suffix. input_scale_levels is off with extra cameras.\n\
  * delegate           - optional hardware acceleration: gpu or cpu. If\n\
  *                        the selection is invalid for the current model/hardware, \n\
  *                        will silently fall back to base cpu delegate.\n\
+ * interpreter_pool   - extra interpreters of the model (up to 3) run next to the\n\
+ *                        main one, frames go to whichever is free and the results\n\
+ *                        are published in frame order. 0 disables.\n\
+ * interpreter_pool_delegate - delegate of the extra interpreters: cpu or gpu.\n\
+ * interpreter_pool_threads  - cpu threads of each extra interpreter.\n\
+ *                        Not with tiling, roi, the tracker, stereo or input_scale_levels.\n\
+ * invoke_arbiter     - order gpu invokes with every other model that has it on,\n\
+ *                        in this and other voxl-tflite-server instances, earliest\n\
+ *                        deadline first. --timing prints misses and shed frames per model.\n\
+ * model_priority     - frames of lower priority models that would miss their deadline\n\
+ *                        are dropped while a higher priority model waits.\n\
+ * model_deadline_ms  - deadline of a frame from its camera timestamp.\n\
+ * arbiter_shed       - drop frames under overload as above, otherwise they run late.\n\
+ * idle_suspend_s     - seconds without any output pipe clients before the camera\n\
+ *                        pipe is paused and the pipeline goes idle. 0 disables.\n\
+ * idle_release_s     - seconds without any output pipe clients before the\n\
+ *                        interpreter, delegate and frame buffers are released\n\
+ *                        to free memory. Rebuilt when a client connects. 0 disables.\n\
+ * gpu_cache_dir      - directory used to serialize compiled gpu delegate kernels so\n\
+ *                        startup and resume from release are fast. Empty disables.\n\
+ * overlay_rate_hz    - max rate the annotated image is rendered and published at,\n\
+ *                        independent of the inference rate. 0 renders every frame.\n\
+ *                        Nothing is rendered while the image pipe has no clients.\n\
+ * overlay_width      - width to downscale the published annotated image to, aspect\n\
+ *                        ratio is kept. 0 publishes at the input resolution.\n\
+ * overlay_jpeg       - publish the annotated image jpeg compressed instead of raw.\n\
+ * overlay_jpeg_quality - jpeg quality (1-100) used when overlay_jpeg is enabled.\n\
+ * nms_method         - non-maximum suppression used by the object detectors: hard,\n\
+ *                        grid (hard, faster for crowded frames), soft_linear or\n\
+ *                        soft_gaussian.\n\
+ * nms_class_aware    - only suppress overlapping boxes of the same class. When\n\
+ *                        false a box suppresses any class.\n\
+ * nms_top_k          - only the top_k highest scoring boxes enter nms. 0 keeps all.\n\
+ * segmentation_mask_rle - run-length encode the class mask published on tflite_data\n\
+ *                        by segmentation models. false publishes the raw mask.\n\
+ * classification_top_k - number of best classes classification models publish and\n\
+ *                        draw per frame (1-16).\n\
+ * gate_estimate_rate_hz - rate the filtered, latency compensated gate state is\n\
+ *                        published at on tflite_gate_estimate. 0 disables.\n\
+ * tracker_detect_interval - object detection models only. 0 publishes raw\n\
+ *                        detections. 1 also tracks them with persistent ids on\n\
+ *                        tflite_tracks. N > 1 only runs the network every N\n\
+ *                        frames and moves the tracks with optical flow between.\n\
+ * tracker_min_confidence - run the network early when a tracked box falls below\n\
+ *                        this confidence (0-1).\n\
+ * scene_change_threshold - skip inference and republish the last results while\n\
+ *                        no cell of a 32x24 luma thumbnail changed by this many\n\
+ *                        gray levels since the last inferred frame. 0 disables.\n\
+ * scene_change_max_interval_s - run the model at least this often even if the\n\
+ *                        scene looks unchanged.\n\
+ * tiled_inference     - object detection models only. Frames larger than the model\n\
+ *                        input are also cut into overlapping model sized tiles at\n\
+ *                        native resolution so small objects are not lost.\n\
+ * tile_overlap        - minimum overlap of neighbouring tiles (0-0.9).\n\
+ * tile_refresh_frames - tiles without detections or motion are skipped for up\n\
+ *                        to this many frames. 0 runs every tile every frame.\n\
+ * roi_mode            - object detection models only, ignored when tiled. off runs\n\
+ *                        the whole frame. static always runs the roi_window crop.\n\
+ *                        follow crops around the last detections or tracks.\n\
+ * roi_window          - static crop as [x, y, width, height] fractions of the frame.\n\
+ * roi_margin          - follow mode, space kept around the detections as a fraction\n\
+ *                        of their size on every side.\n\
+ * roi_smoothing       - follow mode, 0 jumps to the new detections, closer to 1\n\
+ *                        moves the window more slowly.\n\
+ * roi_full_frame_interval - follow mode, run the whole frame every this many\n\
+ *                        frames to pick up new targets. 0 only when the target is lost.\n\
+ * latency_budget_ms   - object detection models only. When the smoothed inference\n\
+ *                        time stays over this budget the model input is switched to a\n\
+ *                        smaller prepared resolution, and back up once there is\n\
+ *                        headroom. 0 always runs the model's own input size.\n\
+ * input_scale_levels  - resolutions prepared for latency_budget_ms, stepping down by a\n\
+ *                        quarter of the model input size (3 gives 640, 480, 320 for yolo).\n\
+ * letterbox_input     - object detection and pose models only. Fit the frame into\n\
+ *                        the model input keeping its aspect ratio, padded with gray,\n\
+ *                        instead of stretching it. Matches how yolo models are trained.\n\
+ * input_undistort     - remove the lens distortion from the model input using the\n\
+ *                        camera's calibration in /data/modalai/. Folded into the\n\
+ *                        resize map with the rotation and flip, no per frame cost.\n\
+ * input_rotation      - rotate the model input clockwise by 0, 90, 180 or 270\n\
+ *                        degrees, for cameras mounted sideways or upside down.\n\
+ * input_flip          - mirror the model input horizontally after the rotation.\n\
+ *                        With any of these three set, results and the overlay are in\n\
+ *                        the corrected view and tiling and roi crops are off.\n\
+ * stereo_mode         - object detection models on a stereo pipe. left runs the\n\
+ *                        left eye only. both runs both eyes every frame, alternate runs\n\
+ *                        one eye per frame at half the rate each. Detections are tagged\n\
+ *                        <cam>_left and <cam>_right. Needs tiling, roi, the tracker and\n\
+ *                        input correction off.\n\
+ * stereo_triangulate  - with both or alternate, match boxes of the same class between\n\
+ *                        the eyes and publish their rough 3D position and range on\n\
+ *                        tflite_stereo, from the stereo calibration in /data/modalai/.\n\
  */\n"
 #endif
 
 extern char model[CHAR_BUF_SIZE];
 extern char input_pipe[CHAR_BUF_SIZE];
+extern int input_priority;
+extern float input_rate_hz;
 extern char delegate[CHAR_BUF_SIZE];
+extern int interpreter_pool;
+extern char interpreter_pool_delegate[CHAR_BUF_SIZE];
+extern int interpreter_pool_threads;
+extern bool invoke_arbiter;
+extern int model_priority;
+extern float model_deadline_ms;
+extern bool arbiter_shed;
 extern int skip_n_frames;
 extern bool allow_multiple;
 extern char output_pipe_prefix[CHAR_BUF_SIZE];
 extern char labels_in_use[CHAR_BUF_SIZE];
+extern float idle_suspend_s;
+extern float idle_release_s;
+extern char gpu_cache_dir[CHAR_BUF_SIZE];
+extern float overlay_rate_hz;
+extern int overlay_width;
+extern bool overlay_jpeg;
+extern int overlay_jpeg_quality;
+extern char nms_method[CHAR_BUF_SIZE];
+extern bool nms_class_aware;
+extern int nms_top_k;
+extern bool segmentation_mask_rle;
+extern int classification_top_k;
+extern float gate_estimate_rate_hz;
+extern int tracker_detect_interval;
+extern float tracker_min_confidence;
+extern int scene_change_threshold;
+extern float scene_change_max_interval_s;
+extern bool tiled_inference;
+extern float tile_overlap;
+extern int tile_refresh_frames;
+extern char roi_mode[CHAR_BUF_SIZE];
+extern float roi_window[4];
+extern float roi_margin;
+extern float roi_smoothing;
+extern int roi_full_frame_interval;
+extern float latency_budget_ms;
+extern int input_scale_levels;
+extern bool letterbox_input;
+extern bool input_undistort;
+extern int input_rotation;
+extern bool input_flip;
+extern char stereo_mode[CHAR_BUF_SIZE];
+extern bool stereo_triangulate;
+
+// a camera pipe run alongside input_pipe
+typedef struct camera_config_t
+{
+    char input_pipe[CHAR_BUF_SIZE];
+    int priority;
+    float rate_hz;
+} camera_config_t;
+
+extern camera_config_t extra_cameras[MAX_EXTRA_CAMERAS];
+extern int n_extra_cameras;
 extern bool en_debug;
 extern bool en_timing;
 
@@ -0,0 +1,114 @@
+#ifndef DETECTION_DECODER_H
+#define DETECTION_DECODER_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "tensor_data.h"
+#include "ai_detection.h"
+#include "ai_track.h"
+#include "tracker.h"
+#include "yolo_decode.h"
+#include "nms.h"
+#include "resize.h"
+
+// model and camera geometry a layout needs to map boxes back to the input
+typedef struct detector_dims_t
+{
+    int model_width;
+    int model_height;
+    resize_transform_t t; // where the model input came from in the input image
+    int num_classes;
+} detector_dims_t;
+
+// Output layouts for DetectorModelHelper. Each one turns the raw output
+// tensors into detection candidates in input pixels, through dims.t so
+// stretched, cropped and letterboxed inputs all map back exactly and carries the
+// thresholds tuned for that family of models. Layouts without an objectness
+// output report a box_conf of -1.
+
+// YoloV5, one anchor-major [anchors][5 + classes] tensor over three grid scales
+struct YoloV5Layout
+{
+    static constexpr float box_threshold = 0.40f;
+    static constexpr float class_threshold = 0.20f;
+    static constexpr float nms_iou_threshold = 0.50f;
+    static constexpr float nms_score_threshold = 0.0f;
+
+    static void decode(tflite::Interpreter *interpreter, const detector_dims_t &dims,
+                       std::vector<detection_candidate_t> &out);
+};
+
+// YoloV8/V11, one channel-major [4 + classes][anchors] tensor
+struct YoloV8Layout
+{
+    static constexpr float score_threshold = 0.45f;
+    static constexpr float nms_iou_threshold = 0.50f;
+    static constexpr float nms_score_threshold = 0.25f;
+
+    static void decode(tflite::Interpreter *interpreter, const detector_dims_t &dims,
+                       std::vector<detection_candidate_t> &out);
+};
+
+// SSD/MobileNet with the TFLite_Detection_PostProcess op: locations
+// (ymin, xmin, ymax, xmax normalized), classes, scores and count tensors
+struct SsdLayout
+{
+    static constexpr float score_threshold = 0.60f;
+    static constexpr float nms_iou_threshold = 0.50f;
+    static constexpr float nms_score_threshold = 0.60f;
+
+    static void decode(tflite::Interpreter *interpreter, const detector_dims_t &dims,
+                       std::vector<detection_candidate_t> &out);
+};
+
+// Turns the boxes that survived nms into ai_detection_t messages.
+//
+// Label and camera names are sanitized into fixed width buffers once, so
+// emitting a detection is a handful of stores and two fixed size copies. The
+// detection array is reused between frames and only grows.
+class DetectionEmitter
+{
+public:
+    // drops a leading "<index> " from each label, then all whitespace, so
+    // "9  traffic light" and "traffic light" both become "trafficlight"
+    void set_labels(const std::vector<std::string> &labels, size_t label_count);
+    void set_cam(const std::string &cam_name);
+    bool has_labels() { return !names.empty(); }
+
+    // sanitized name, "unknown" for ids the labels file doesn't cover
+    const char *label(int32_t class_id);
+
+    void emit(const std::vector<detection_candidate_t> &candidates,
+              const std::vector<int> &keep, NmsEngine &nms,
+              int32_t frame_id, int64_t timestamp_ns);
+
+    // tracker mode, publishes the live tracks instead of the raw detections:
+    // one ai_detection_t (stamped timestamp_ns like emit) and one ai_track_t
+    // (stamped with the camera frame the tracks were updated to) per track
+    void emit_tracks(const std::vector<track_t> &tracks, int32_t frame_id,
+                     int64_t timestamp_ns, int64_t frame_timestamp_ns);
+
+    // restamps the last emitted messages so they can be published again
+    void restamp(int64_t timestamp_ns, int64_t frame_timestamp_ns);
+
+    const ai_detection_t *data() { return detections.data(); }
+    int size() { return num_detections; }
+
+    const ai_track_t *track_data() { return track_msgs.data(); }
+    int track_size() { return num_tracks; }
+
+private:
+    std::vector<std::array<char, BUF_LEN>> names;
+    std::array<char, BUF_LEN> unknown_name = {"unknown"};
+    std::array<char, BUF_LEN> cam = {};
+
+    std::vector<ai_detection_t> detections;
+    int num_detections = 0;
+
+    std::vector<ai_track_t> track_msgs;
+    int num_tracks = 0;
+};
+
+#endif // DETECTION_DECODER_H
@@ -0,0 +1,134 @@
+#ifndef FRAME_VIEWS_H
+#define FRAME_VIEWS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "resize.h"
+#include "scene_gate.h"
+
+#define TILE_MAX 32
+#define TILE_MOTION_THRESHOLD 12 // gray levels on the scene thumbnail
+#define ROI_SIZE_STEP 32          // crop sizes are quantized so a moving window mostly just shifts its map
+
+// One model input cut from a camera frame. A frame that is only squashed
+// into the model as a whole has no views, tiled detectors have the whole
+// frame plus the tiles that run this frame, stereo detectors one view per
+// eye that runs.
+typedef struct frame_view_t
+{
+    int tile;       // tile index, -1 for the whole frame
+    int x, y, w, h; // region of the input image, input pixels
+    resize_transform_t t; // model input back to input pixels, from the view's map
+    int eye;        // stereo eye the view was cut from, 0 left (or mono) 1 right
+} frame_view_t;
+
+typedef std::vector<frame_view_t> frame_views_t;
+
+// Lays overlapping model sized tiles over frames larger than the model input
+// so small objects are seen at native resolution, and decides which of them
+// are worth running each frame.
+//
+// A tile runs when its last run found something, when its part of the scene
+// thumbnail changed since it last ran, or at least every refresh_frames
+// frames, so a static empty sky costs nothing most frames. select() is
+// called from the preprocess thread, report() from the inference thread.
+class TilePlanner
+{
+public:
+    ~TilePlanner();
+
+    // false if the frame already fits the model and there is nothing to tile
+    bool init(int input_width, int input_height, int model_width, int model_height,
+              float overlap);
+    void release();
+
+    int num_tiles() { return (int)tiles.size(); }
+    undistort_map_t *map(int tile) { return &tiles[tile].map; }
+
+    // appends the tiles to run this frame, all of them for a null thumbnail
+    void select(const uint8_t *thumb, int refresh_frames, frame_views_t &views);
+
+    // whether the tile's last run produced any detection
+    void report(int tile, bool found) { occupied[tile] = found; }
+
+private:
+    struct tile_t
+    {
+        int x, y, w, h;
+        int cx0, cy0, cx1, cy1; // thumbnail cells the tile covers
+        undistort_map_t map;
+        int frames_since_run;
+        bool has_reference;
+        uint8_t reference[SCENE_THUMB_SIZE];
+    };
+
+    bool moved(const tile_t &t, const uint8_t *thumb);
+
+    std::vector<tile_t> tiles;
+    std::atomic<bool> occupied[TILE_MAX];
+};
+
+enum RoiMode
+{
+    ROI_OFF,
+    ROI_STATIC, // fixed window from the config file
+    ROI_FOLLOW  // window follows the last results
+};
+
+// "off", "static" or "follow", returns -1 for anything else
+int roi_mode_from_string(const char *str, RoiMode *mode);
+
+// Crop window the model looks through instead of the whole frame, so a
+// target that fills a small part of the view is seen at a higher resolution
+// for the same inference cost.
+//
+// In follow mode the window is the union of the last results grown by
+// margin on every side, widened to the model's aspect ratio, never smaller
+// than the model input (no upscaling) and smoothed over frames. A full frame
+// pass runs every full_frame_interval frames and whenever the window lost
+// its target, to reacquire.
+//
+// The crop map is rebuilt only when the quantized window size changes, a
+// window that just moves shifts the existing map. set_target() is called by
+// the postprocess thread, next() by the preprocess thread.
+class RoiWindow
+{
+public:
+    ~RoiWindow();
+
+    void init(RoiMode mode, int input_width, int input_height, int model_width,
+              int model_height, const float window[4], float margin, float smoothing,
+              int full_frame_interval);
+
+    // bounding box of the last results in input pixels, found false if
+    // there were none
+    void set_target(bool found, float x_min, float y_min, float x_max, float y_max);
+
+    // map of this frame's crop with the view it covers, null for a full
+    // frame pass
+    undistort_map_t *next(frame_view_t &view);
+
+private:
+    bool window_for_target(frame_view_t &view);
+    bool set_crop(const frame_view_t &view);
+
+    RoiMode mode = ROI_OFF;
+    int input_w = 0, input_h = 0;
+    int model_w = 0, model_h = 0;
+    float margin = 0.0f, smoothing = 0.0f;
+    int full_frame_interval = 0;
+    int frames_since_full = 0;
+
+    // smoothed target box center and size, guarded by mutex
+    std::mutex mutex;
+    bool has_target = false;
+    float cx = 0, cy = 0, w = 0, h = 0;
+
+    frame_view_t crop = {};
+    undistort_map_t map = {};
+};
+
+#endif // FRAME_VIEWS_H
@@ -0,0 +1,61 @@
+#ifndef GATE_ESTIMATOR_H
+#define GATE_ESTIMATOR_H
+
+#include <stdint.h>
+#include <mutex>
+
+#include "gate_state.h"
+#include "kalman_cv.h"
+
+// tuning, position in model output units (m), yaw in rad
+#define GATE_EST_XYZ_SIGMA       0.10f // measurement noise
+#define GATE_EST_XYZ_ACCEL_NOISE 2.0f  // white acceleration noise, units/s^2
+#define GATE_EST_YAW_SIGMA       0.05f
+#define GATE_EST_YAW_ACCEL_NOISE 1.0f
+#define GATE_EST_XYZ_GATE        16.27f // chi2 3 dof 99.9%
+#define GATE_EST_YAW_GATE        10.83f // chi2 1 dof 99.9%
+#define GATE_EST_MAX_REJECTS     5      // consecutive outliers before re-initializing
+#define GATE_EST_MAX_AGE_NS      500000000 // stop predicting this long after the last fix
+
+// Constant velocity Kalman filter over the gate position and yaw.
+//
+// Each axis is an independent [position, velocity] filter, so the 8 state
+// filter reduces to four 2x2 ones. Measurements are applied at the camera
+// timestamp they were taken at and predict() extrapolates to any later time,
+// which is what compensates the camera + inference latency. Measurements
+// whose normalized innovation is outside the chi2 gate are dropped, a run of
+// them means the filter lost the gate and it restarts from the measurement.
+//
+// update() and predict() may be called from different threads.
+class GateEstimator
+{
+public:
+    // fuses the fields flagged in state.valid_fields, returns false if the
+    // measurement was rejected as an outlier or out of order
+    bool update(const gate_state_t &state);
+
+    // fills out with the estimate at timestamp_ns, returns false if there is
+    // no estimate yet or the last fix is older than GATE_EST_MAX_AGE_NS
+    bool predict(int64_t timestamp_ns, gate_state_t &out);
+
+private:
+    enum { X, Y, Z, YAW, NUM_AXES };
+
+    KalmanAxis axes[NUM_AXES];
+    uint16_t initialized = 0; // GATE_STATE_HAS_XYZ / GATE_STATE_HAS_YAW
+    int64_t filter_time_ns = 0;
+    int32_t last_frame_id = 0;
+
+    int xyz_rejects = 0;
+    int yaw_rejects = 0;
+    int64_t xyz_fix_ns = 0;
+    int64_t yaw_fix_ns = 0;
+
+    std::mutex mutex;
+
+    void predict_to(int64_t timestamp_ns);
+    bool update_xyz(const gate_state_t &state);
+    bool update_yaw(const gate_state_t &state);
+};
+
+#endif // GATE_ESTIMATOR_H
@@ -0,0 +1,46 @@
+#ifndef GATE_STATE_H
+#define GATE_STATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define GATE_STATE_MAGIC_NUMBER (0x564F5847)
+#define GATE_STATE_VERSION 1
+
+// which of the fields below a message carries
+#define GATE_STATE_HAS_XYZ (1 << 0)
+#define GATE_STATE_HAS_YAW (1 << 1)
+#define GATE_STATE_HAS_BIN (1 << 2)
+#define GATE_STATE_HAS_VELOCITY (1 << 3) // vx/vy/vz and yaw_rate are set
+#define GATE_STATE_PREDICTED (1 << 4)    // estimator output extrapolated to timestamp_ns
+
+// Output of the gate models on tflite_data and of the gate estimator on
+// tflite_gate_estimate, fixed 56 byte layout so clients can read it straight
+// out of the pipe buffer. Fields not flagged in valid_fields are zero, any
+// layout change bumps GATE_STATE_VERSION.
+typedef struct gate_state_t {
+    uint32_t magic_number;  // GATE_STATE_MAGIC_NUMBER
+    uint16_t version;       // GATE_STATE_VERSION
+    uint16_t valid_fields;  // GATE_STATE_HAS_* bits
+    int64_t timestamp_ns;   // camera frame timestamp, or the prediction time when GATE_STATE_PREDICTED
+    int32_t frame_id;       // camera frame id
+    float x;                // gate position, gate_xyz model
+    float y;
+    float z;
+    float yaw;              // gate yaw, gate_yaw model
+    float bin;              // gate_bin model output
+    float vx;               // gate velocity relative to the camera, estimator only
+    float vy;
+    float vz;
+    float yaw_rate;
+} __attribute__((packed)) gate_state_t;
+
+#ifdef __cplusplus
+static_assert(sizeof(gate_state_t) == 56, "gate_state_t layout changed");
+}
+#endif
+
+#endif // GATE_STATE_H
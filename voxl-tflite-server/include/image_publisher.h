@@ -0,0 +1,54 @@
+#ifndef IMAGE_PUBLISHER_H
+#define IMAGE_PUBLISHER_H
+
+#include <opencv2/opencv.hpp>
+#include <modal_pipe.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "resize.h"
+
+// Publishes the annotated overlay image from a low priority background thread,
+// optionally downscaled to out_width (aspect preserved) and/or jpeg encoded.
+//
+// publish() only hands the latest frame over and returns, if the thread is
+// still busy with an older frame that one is dropped, so the postprocess
+// thread and the detection output never wait on image encoding.
+class ImagePublisher
+{
+public:
+    ImagePublisher(int channel, int out_width, bool en_jpeg, int jpeg_quality);
+    ~ImagePublisher();
+
+    void publish(const camera_image_metadata_t &meta, const cv::Mat &image);
+
+    int get_num_dropped() { return num_dropped; }
+
+private:
+    void run();
+    void write_frame(camera_image_metadata_t meta, const cv::Mat &image);
+
+    int channel;
+    int out_width;
+    bool en_jpeg;
+    int jpeg_quality;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool running = true;
+    bool pending = false;
+    camera_image_metadata_t pending_meta;
+    cv::Mat pending_image;
+    int num_dropped = 0;
+
+    // only touched by the publisher thread
+    undistort_map_t map = {};
+    cv::Mat scaled;
+    cv::Mat bgr;
+    std::vector<uchar> jpeg_buf;
+};
+
+#endif // IMAGE_PUBLISHER_H
@@ -15,27 +15,37 @@
 
 #include "model_helper/model_helper.h"
 #include "model_helper/model_info.h"
+#include "camera_scheduler.h"
+#include "invoke_arbiter.h"
 
 #define QUEUE_LIMIT       1
 
 struct InferenceWorkerArgs
 {
-    ModelHelper *model_helper;
+    CameraScheduler *scheduler;
+    InvokeArbiter *arbiter; // null unless invoke_arbiter is on
 };
 
 void *run_inference_pipeline(void *data);
 
 // Setting up three threads
-void preprocess_worker(ModelHelper *model_helper);
-void inference_worker(ModelHelper *model_helper);
-void postprocess_worker(ModelHelper *model_helper);
+void preprocess_worker(CameraScheduler *scheduler);
+void inference_worker(int slot, InvokeArbiter *arbiter, int arbiter_client);
+void postprocess_worker();
 
 struct PipelineData
 {
+    ModelHelper *helper;              // camera the frame came from
     camera_image_metadata_t metadata;
     std::shared_ptr<cv::Mat> preprocessed_image;
     std::shared_ptr<cv::Mat> output_image;
     double last_inference_time;
+    bool ran_inference = true; // false if the helper skipped the network for this frame
+    bool unchanged = false;    // scene gate hit, nothing to process, republish the last results
+    std::shared_ptr<frame_views_t> views; // model inputs the frame was cut into, null for one
+    int input_generation = 0;  // model input size the frame was preprocessed for
+    uint64_t seq = 0;          // dispatch order, postprocess publishes in this order
+    int slot = 0;              // pool interpreter the frame ran on
 };
 
 
@@ -0,0 +1,88 @@
+#ifndef INVOKE_ARBITER_H
+#define INVOKE_ARBITER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <vector>
+
+#define ARBITER_SHM_NAME "/voxl-tflite-arbiter"
+#define ARBITER_MAGIC 0x41524254     // set once the table is initialized
+#define ARBITER_MAX_CLIENTS 16
+#define ARBITER_NAME_LEN 32
+#define ARBITER_COST_ALPHA 0.1f      // weight of a new invoke time in the cost estimate
+#define ARBITER_POLL_MS 10           // waiters look for crashed processes this often
+#define ARBITER_OPEN_TIMEOUT_MS 1000 // wait for another process to initialize the table
+#define ARBITER_STATS_PERIOD_S 5.0   // en_timing prints the table this often
+
+// one inference thread of a server taking part
+struct arbiter_client_t
+{
+    int32_t pid;         // 0 for a free entry
+    int32_t slot;        // inference thread in its process
+    int32_t priority;
+    char name[ARBITER_NAME_LEN];
+    int64_t deadline_ns; // of the frame waiting for the accelerator, 0 when not waiting
+    float cost_ms;       // smoothed invoke time
+    uint64_t invokes;
+    uint64_t misses;     // invokes that finished after their deadline
+    uint64_t shed;       // frames dropped so higher priority work made its deadline
+};
+
+// lives in shared memory, everything but magic and size guarded by mutex
+struct arbiter_shm_t
+{
+    uint32_t magic;
+    uint32_t size;         // sizeof(arbiter_shm_t) of the server that created it
+    pthread_mutex_t mutex; // process shared and robust
+    pthread_cond_t cond;   // process shared, CLOCK_MONOTONIC
+    int32_t holder;        // client running an invoke, -1 for none
+    arbiter_client_t clients[ARBITER_MAX_CLIENTS];
+};
+
+// Orders accelerator invokes between models, within this server and across
+// every other voxl-tflite-server instance (allow_multiple), through a table
+// in shared memory.
+//
+// Each frame's deadline is its camera timestamp plus the model's deadline.
+// One invoke runs at a time and of the frames waiting, the one with the
+// earliest deadline goes next, priority breaking ties. A waiting frame that
+// can't make its deadline any more, given the measured cost of the invokes
+// ahead of it, is shed if a model of higher priority is competing for the
+// accelerator. Entries of processes that died are reclaimed, along with the
+// token if one died holding it.
+class InvokeArbiter
+{
+public:
+    ~InvokeArbiter();
+
+    // maps the shared table, creating it if this is the first server
+    bool open(const char *name, int priority, float deadline_ms, bool en_shed);
+    bool is_open() const { return shm != nullptr; }
+
+    // an entry for one inference thread, -1 if the table is full
+    int attach(int slot);
+
+    // blocks until the invoke of a frame taken at timestamp_ns may run.
+    // False if the frame was shed or the server is stopping, otherwise
+    // release() has to follow the invoke
+    bool acquire(int client, int64_t timestamp_ns);
+    void release(int client, int64_t timestamp_ns, double invoke_ms);
+
+    // every model in the table, at most every ARBITER_STATS_PERIOD_S
+    void print_stats();
+
+private:
+    void lock();
+    void wait();
+    void reap(); // lock held
+
+    arbiter_shm_t *shm = nullptr;
+    char name[ARBITER_NAME_LEN] = {};
+    int priority = 1;
+    int64_t deadline_ns = 0;
+    bool en_shed = true;
+    std::vector<int> clients; // ours, freed on destruction
+    int64_t stats_start_ns = 0;
+};
+
+#endif // INVOKE_ARBITER_H
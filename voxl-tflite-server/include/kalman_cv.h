@@ -0,0 +1,50 @@
+#ifndef KALMAN_CV_H
+#define KALMAN_CV_H
+
+// One [position, velocity] constant velocity Kalman filter with a position
+// measurement. Independent axes of a larger state (gate xyz/yaw, track box
+// center/size) each get one, which keeps every update a handful of flops.
+struct KalmanAxis
+{
+    float p, v;          // position, velocity
+    float P00, P01, P11; // symmetric covariance
+
+    void init(float z, float r, float v_var = 1.0f)
+    {
+        p = z;
+        v = 0.0f;
+        P00 = r;
+        P01 = 0.0f;
+        P11 = v_var;
+    }
+
+    // F = [1 dt; 0 1], Q from white acceleration noise with std dev q
+    void predict(float dt, float q)
+    {
+        const float dt2 = dt * dt;
+        const float q2 = q * q;
+        p += v * dt;
+        P00 += dt * (2.0f * P01 + dt * P11) + q2 * dt2 * dt2 * 0.25f;
+        P01 += dt * P11 + q2 * dt2 * dt * 0.5f;
+        P11 += q2 * dt2;
+    }
+
+    float innovation_var(float r) const { return P00 + r; }
+
+    // H = [1 0], y is the innovation z - p
+    void correct(float y, float r)
+    {
+        const float s = P00 + r;
+        const float k0 = P00 / s;
+        const float k1 = P01 / s;
+        p += k0 * y;
+        v += k1 * y;
+
+        const float p00 = P00, p01 = P01;
+        P00 -= k0 * p00;
+        P01 -= k0 * p01;
+        P11 -= k1 * p01;
+    }
+};
+
+#endif // KALMAN_CV_H
@@ -0,0 +1,48 @@
+#ifndef LATENCY_GOVERNOR_H
+#define LATENCY_GOVERNOR_H
+
+#include <vector>
+
+#define GOVERNOR_EMA_ALPHA 0.2f // weight of a new latency sample
+#define GOVERNOR_DOWN_FRAMES 5  // frames over budget before dropping a level
+#define GOVERNOR_UP_FRAMES 30   // frames with headroom before raising a level
+#define GOVERNOR_UP_MARGIN 0.8f // the level above has to be predicted under this share of the budget
+#define GOVERNOR_SETTLE_FRAMES 3 // samples ignored after a switch, the first invokes are slow
+
+// Picks which of a few prepared input resolutions the model runs at from
+// the measured inference latency against a budget.
+//
+// Levels are ordered largest first, each with a relative cost (its pixel
+// count). A level is dropped once the smoothed latency has been over the
+// budget for GOVERNOR_DOWN_FRAMES frames in a row. Going back up needs the
+// latency scaled by the cost ratio to the level above to stay under
+// GOVERNOR_UP_MARGIN of the budget for GOVERNOR_UP_FRAMES frames, so a
+// resolution that would land right on the budget doesn't flap.
+class LatencyGovernor
+{
+public:
+    // budget 0 or a single level keeps level 0
+    void configure(float budget_ms, const std::vector<float> &level_cost);
+
+    // feeds one inference latency, returns the level the next frame should
+    // run at
+    int update(double latency_ms);
+
+    int level() const { return current; }
+    float smoothed_ms() const { return ema; }
+
+    // back to the largest level, e.g. after the interpreters were rebuilt
+    void reset();
+
+private:
+    float budget_ms = 0;
+    std::vector<float> cost;
+    int current = 0;
+    float ema = 0;
+    bool has_ema = false;
+    int frames_over = 0;
+    int frames_under = 0;
+    int settle = 0;
+};
+
+#endif // LATENCY_GOVERNOR_H
@@ -0,0 +1,54 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "camera_scheduler.h"
+
+#define LIFECYCLE_TICK_MS 250
+
+enum LifecycleState
+{
+    PIPELINE_ACTIVE,    // camera pipe open, frames flowing through the pipeline
+    PIPELINE_SUSPENDED, // camera pipe paused, interpreter and buffers kept warm
+    PIPELINE_RELEASED   // camera pipe paused, interpreter and buffers freed
+};
+
+// Parks the camera pipes and inference pipeline while nobody is subscribed to
+// any camera's output pipes, and brings them back when a client connects.
+//
+// update() and wait() are driven from the main thread, notify() is safe to
+// call from the pipe server connect callbacks to wake the main thread early.
+class LifecycleManager
+{
+public:
+    LifecycleManager(const std::vector<CameraStream *> &streams,
+                     float idle_suspend_s, float idle_release_s);
+
+    void update();
+    void notify();
+    void wait(int timeout_ms);
+
+    LifecycleState get_state() { return state; }
+
+private:
+    bool has_clients();
+    void suspend();
+    void release();
+    bool resume();
+
+    std::vector<CameraStream *> streams;
+    uint64_t suspend_after_ns;
+    uint64_t release_after_ns;
+
+    LifecycleState state = PIPELINE_ACTIVE;
+    uint64_t last_client_time_ns;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake_cond;
+    bool wake_pending = false;
+};
+
+#endif // LIFECYCLE_H
@@ -2,13 +2,15 @@
 #define DEEP_LAB_H
 
 #include "model_helper/model_helper.h"
+#include "segmentation.h"
 
 class DeepLabModelHelper : public ModelHelper
 {
 public:
     DeepLabModelHelper(char *model_file, char *labels_file,
                        DelegateOpt delegate_choice, bool _en_debug,
-                       bool _en_timing, NormalizationType _do_normalize);
+                       bool _en_timing, NormalizationType _do_normalize,
+                       const helper_init_t &init = helper_init_t());
     bool postprocess(cv::Mat &output_image, double last_inference_time, void *input_params) override;
     bool worker(cv::Mat &output_image, double last_inference_time, camera_image_metadata_t metadata, void *input_params) override;
 
@@ -17,6 +19,19 @@ private:
     std::vector<std::string> labels;
     size_t label_count;
     camera_image_metadata_t new_frame_metadata;
+
+    // row-major class id per model pixel, rebuilt every frame
+    std::vector<uint8_t> class_mask;
+    seg_color_lut_t color_lut;
+    // blended image plus the legend border, reused between frames
+    cv::Mat overlay;
+
+    // set by postprocess when the data pipe has a client this frame
+    bool publish_mask = false;
+    std::vector<uint8_t> mask_rle;
+
+    bool build_class_mask(TfLiteTensor *output);
+    void write_class_mask(const camera_image_metadata_t &meta);
 };
 
 #endif
@@ -0,0 +1,648 @@
+#ifndef DETECTOR_MODEL_HELPER_H
+#define DETECTOR_MODEL_HELPER_H
+
+#include <atomic>
+
+#include "model_helper/model_helper.h"
+#include "detection_decoder.h"
+#include "tracker.h"
+#include "image_utils.h"
+#include "stereo.h"
+
+// Shared postprocess for every object detector: decode the output tensors
+// with Layout, run nms, emit ai_detection_t on the data pipe and draw the
+// overlay. Subclasses only add model specific preprocess/inference.
+//
+// With tiled_inference set, frames larger than the model are run as the
+// whole frame plus overlapping native resolution tiles (see TilePlanner),
+// decoded per view into frame coordinates and merged by the same nms.
+// Otherwise roi_mode can have the model look through a crop of the frame
+// (see RoiWindow) that is mapped back the same way.
+//
+// With tracker_detect_interval set the detections feed a Tracker and the
+// tracks are published instead, with their ids on TRACK_CH. Intervals above
+// 1 skip the network on the frames in between (or until a track's flow
+// confidence drops under tracker_min_confidence) and move the tracks with
+// optical flow.
+//
+// letterbox_input keeps the frame's aspect ratio in the model input, every
+// view carries the transform of its map so boxes land back exactly.
+//
+// latency_budget_ms has the model run at a smaller prepared input size
+// while inference can't keep up. The decoders size their grids from the
+// model dims, so only the views need rebuilding when the size changes.
+//
+// On stereo pipes stereo_mode can run the right eye too, as a second view
+// of the same frame or on every other frame. Each eye is decoded and nms'd
+// on its own and published tagged with its eye, stereo_triangulate pairs
+// the boxes up (see StereoMatcher). The overlay shows the eye that went
+// through the base preprocess.
+template <class Layout>
+class DetectorModelHelper : public ModelHelper
+{
+public:
+    DetectorModelHelper(char *model_file, char *labels_file,
+                        DelegateOpt delegate_choice, bool _en_debug,
+                        bool _en_timing, NormalizationType _do_normalize,
+                        const helper_init_t &init = helper_init_t())
+        : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize, init)
+    {
+        if (!load_labels())
+            exit(-1);
+
+        nms_params.iou_threshold = Layout::nms_iou_threshold;
+        nms_params.score_threshold = Layout::nms_score_threshold;
+
+        frames_since_inference = tracker_detect_interval;
+        letterbox = letterbox_input;
+
+        if (roi_mode_from_string(roi_mode, &roi_setting))
+            fprintf(stderr, "WARNING: unknown roi_mode %s, using off\n", roi_mode);
+
+        if (stereo_mode_from_string(stereo_mode, &stereo))
+            fprintf(stderr, "WARNING: unknown stereo_mode %s, using left\n", stereo_mode);
+        if (stereo != STEREO_LEFT && (tiled_inference || roi_setting != ROI_OFF ||
+                                      tracker_detect_interval > 0 || input_undistort ||
+                                      input_rotation != 0 || input_flip))
+        {
+            fprintf(stderr, "WARNING: stereo_mode %s needs tiling, roi, the tracker and input "
+                            "correction off, using left\n", stereo_mode);
+            stereo = STEREO_LEFT;
+        }
+
+        // every camera runs on the one interpreter, switching it to another
+        // input size would pull it out from under the others
+        if (latency_budget_ms > 0 && input_scale_levels > 1 && n_extra_cameras > 0)
+        {
+            if (!shares_interpreter())
+                fprintf(stderr, "WARNING: input_scale_levels is off with extra_cameras\n");
+        }
+        else if (latency_budget_ms > 0 && input_scale_levels > 1)
+            prepare_input_variants(input_scale_levels);
+    }
+
+    bool preprocess(camera_image_metadata_t &meta,
+                    char *frame, std::shared_ptr<cv::Mat> preprocessed_image,
+                    std::shared_ptr<cv::Mat> output_image) override
+    {
+        // the base preprocess turns meta into the rgb image it produced
+        camera_image_metadata_t frame_meta = meta;
+
+        // roi frames are resized through the crop's map instead of the
+        // whole frame's, same model input size
+        frame_view_t roi_view = {};
+        undistort_map_t *roi_map = roi_ready ? roi.next(roi_view) : nullptr;
+        if (roi_map != nullptr)
+            input_map = roi_map;
+
+        // the base preprocess sees the eye that runs (or the left one of
+        // both) as a mono frame of the same geometry
+        const size_t eye_bytes = stereo != STEREO_LEFT ? stereo_eye_bytes(meta) : 0;
+        int eye = 0;
+        if (eye_bytes > 0 && stereo == STEREO_ALTERNATE)
+        {
+            eye = next_eye;
+            next_eye ^= 1;
+        }
+
+        const bool preprocessed = ModelHelper::preprocess(meta, frame + eye * eye_bytes,
+                                                          preprocessed_image, output_image);
+        input_map = &map;
+        if (!preprocessed)
+            return false;
+
+        // the input size is only known once frames arrive
+        if (!views_ready)
+        {
+            // tiles and crops are cut from the raw frame, not the corrected view
+            if (input_corrected && (tiled_inference || roi_setting != ROI_OFF))
+                fprintf(stderr, "WARNING: tiling and roi are off with a corrected input\n");
+            else if (tiled_inference)
+                tiling = tiles.init(input_width, input_height, model_width, model_height, tile_overlap);
+            else if (roi_setting != ROI_OFF)
+            {
+                roi.init(roi_setting, input_width, input_height, model_width, model_height,
+                         roi_window, roi_margin, roi_smoothing, roi_full_frame_interval);
+                roi_ready = true;
+            }
+            views_ready = true;
+        }
+
+        if (roi_map != nullptr)
+        {
+            preprocess_views = std::make_shared<frame_views_t>(1, roi_view);
+            return true;
+        }
+        if (eye_bytes > 0)
+        {
+            preprocess_stereo(frame_meta.format, (uint8_t *)frame + eye_bytes, eye,
+                              preprocessed_image);
+            return true;
+        }
+        if (!tiling)
+            return true;
+
+        start_time = rc_nanos_monotonic_time();
+
+        auto views = std::make_shared<frame_views_t>();
+        views->push_back({-1, 0, 0, input_width, input_height, map.T, 0});
+        uint8_t thumb[SCENE_THUMB_SIZE];
+        const bool have_thumb = scene_thumbnail(frame_meta, (uint8_t *)frame, thumb);
+        tiles.select(have_thumb ? thumb : nullptr, tile_refresh_frames, *views);
+
+        // every view is one model input, stacked vertically in a fresh image
+        // so the next frame's preprocess can't overwrite them mid-inference
+        cv::Mat stack(model_height * views->size(), model_width, CV_8UC3);
+        cv::Mat whole = stack(cv::Rect(0, 0, model_width, model_height));
+        preprocessed_image->copyTo(whole);
+
+        // yuyv has no fused resize, tiles come from the overlay's rgb
+        // conversion or one of their own
+        const uint8_t *rgb = nullptr;
+        if (frame_meta.format == IMAGE_FORMAT_YUV422 && views->size() > 1)
+        {
+            if (output_image && !output_image->empty())
+                rgb = output_image->data;
+            else
+            {
+                cv::Mat yuv(input_height, input_width, CV_8UC2, (uchar *)frame);
+                cv::cvtColor(yuv, tile_rgb, CV_YUV2RGB_YUYV);
+                rgb = tile_rgb.data;
+            }
+        }
+
+        for (size_t i = 1; i < views->size(); i++)
+        {
+            cv::Mat block = stack(cv::Rect(0, i * model_height, model_width, model_height));
+            resize_tile(frame_meta.format, (uint8_t *)frame, rgb, tiles.map((*views)[i].tile), block);
+        }
+
+        *preprocessed_image = stack;
+        preprocess_views = views;
+
+        if (en_timing)
+            total_preprocess_time += ((rc_nanos_monotonic_time() - start_time) / 1000000.);
+
+        return true;
+    }
+
+    bool run_inference(cv::Mat &preprocessed_image, double *last_inference_time) override
+    {
+        if (!inference_views)
+        {
+            views_decoded = false;
+            return ModelHelper::run_inference(preprocessed_image, last_inference_time);
+        }
+
+        start_time = rc_nanos_monotonic_time();
+
+        // outputs are overwritten by the next view, so each one is decoded
+        // here into frame coordinates for postprocess to merge
+        view_candidates.clear();
+        right_candidates.clear();
+        for (size_t i = 0; i < inference_views->size(); i++)
+        {
+            const frame_view_t &v = (*inference_views)[i];
+            cv::Mat block = preprocessed_image(cv::Rect(0, i * model_height, model_width, model_height));
+            if (!fill_input(block))
+                return false;
+            if (interpreter->Invoke() != kTfLiteOk)
+            {
+                fprintf(stderr, "FATAL: Failed to invoke tflite!\n");
+                return false;
+            }
+
+            std::vector<detection_candidate_t> &out = v.eye ? right_candidates : view_candidates;
+            const size_t first = out.size();
+            detector_dims_t dims = {model_width, model_height, v.t, (int)label_count};
+            Layout::decode(interpreter.get(), dims, out);
+            if (v.tile >= 0)
+                tiles.report(v.tile, out.size() > first);
+        }
+        views_decoded = true;
+
+        int64_t end_time = rc_nanos_monotonic_time();
+        if (en_timing)
+            total_inference_time += ((end_time - start_time) / 1000000.);
+        if (last_inference_time != nullptr)
+            *last_inference_time = ((double)(end_time - start_time) / 1000000.);
+
+        return true;
+    }
+
+    // tiles, roi crops, stereo and the tracker carry state from inference
+    // to postprocess, their frames can't overlap
+    bool can_pool() override
+    {
+        return ModelHelper::can_pool() && !tiled_inference && roi_setting == ROI_OFF &&
+               stereo == STEREO_LEFT && tracker_detect_interval <= 0;
+    }
+
+    // inference thread only, the postprocess thread just raises want_detection
+    bool needs_inference() override
+    {
+        if (tracker_detect_interval <= 1 || want_detection.exchange(false) ||
+            ++frames_since_inference >= tracker_detect_interval)
+        {
+            frames_since_inference = 0;
+            return true;
+        }
+        return false;
+    }
+
+    bool can_republish() override { return true; }
+
+    // tiles and roi maps are model sized, set up again from the next frame
+    void input_size_changed() override
+    {
+        views_ready = false;
+        tiling = false;
+        roi_ready = false;
+        stereo_checked = false;
+    }
+
+    // the last detections (or tracks) again, with fresh timestamps
+    bool republish(const camera_image_metadata_t &meta) override
+    {
+        const int64_t now = rc_nanos_monotonic_time();
+        emitter.restamp(now, meta.timestamp_ns);
+        right_emitter.restamp(now, meta.timestamp_ns);
+        for (ai_stereo_detection_t &s : stereo_results)
+            s.timestamp_ns = meta.timestamp_ns;
+        write_results();
+        return true;
+    }
+
+    bool worker(cv::Mat &output_image, double last_inference_time, camera_image_metadata_t metadata, void *input_params) override
+    {
+        frame_timestamp_ns = metadata.timestamp_ns;
+
+        if (!postprocess(output_image, last_inference_time, input_params))
+            return false;
+
+        write_results();
+        if (roi_ready)
+            follow_results();
+        if (render_output)
+            publish_output_image(metadata, output_image);
+
+        return true;
+    }
+
+    bool postprocess(cv::Mat &output_image, double last_inference_time, void *input_params) override
+    {
+        start_time = rc_nanos_monotonic_time();
+
+        if (!emitter.has_labels() && !load_labels())
+            return false;
+
+        // cam_name is assigned after construction, pick it up on the first frame
+        if (emitter_cam != cam_name)
+        {
+            emitter.set_cam(stereo != STEREO_LEFT ? cam_name + "_left" : cam_name);
+            right_emitter.set_cam(cam_name + "_right");
+            emitter_cam = cam_name;
+        }
+
+        emitted_eyes = 1;
+        stereo_results.clear();
+        if (tracker_detect_interval > 0)
+            return postprocess_tracks(output_image, last_inference_time);
+        if (stereo != STEREO_LEFT && inference_views)
+            return postprocess_stereo(output_image, last_inference_time);
+
+        decode_detections();
+
+        emitter.emit(candidates, nms_keep, nms, num_frames_processed,
+                     rc_nanos_monotonic_time());
+
+        if (en_debug)
+        {
+            for (int idx : nms_keep)
+                printf("Detected: %s, Confidence: %6.2f\n",
+                       emitter.label(candidates[idx].class_id), (double)nms.get_score(idx));
+        }
+
+        if (render_output)
+        {
+            draw_detections(output_image);
+            draw_fps(output_image, last_inference_time, cv::Point(0, 0), 0.5, 2,
+                     cv::Scalar(0, 0, 0), cv::Scalar(180, 180, 180), true);
+        }
+
+        if (en_timing)
+            total_postprocess_time +=
+                ((rc_nanos_monotonic_time() - start_time) / 1000000.);
+
+        return true;
+    }
+
+protected:
+    void write_results()
+    {
+        if ((emitted_eyes & 1) && emitter.size() > 0)
+        {
+            pipe_server_write(out_ch(DETECTION_CH), (char *)emitter.data(),
+                              sizeof(ai_detection_t) * emitter.size());
+        }
+        if ((emitted_eyes & 2) && right_emitter.size() > 0)
+        {
+            pipe_server_write(out_ch(DETECTION_CH), (char *)right_emitter.data(),
+                              sizeof(ai_detection_t) * right_emitter.size());
+        }
+        if (emitter.track_size() > 0)
+        {
+            pipe_server_write(out_ch(TRACK_CH), (char *)emitter.track_data(),
+                              sizeof(ai_track_t) * emitter.track_size());
+        }
+        if (!stereo_results.empty())
+        {
+            pipe_server_write(out_ch(STEREO_CH), (char *)stereo_results.data(),
+                              sizeof(ai_stereo_detection_t) * stereo_results.size());
+        }
+    }
+
+    // boxes that survived nms in candidates
+    void draw_detections(cv::Mat &output_image)
+    {
+        for (int idx : nms_keep)
+        {
+            const detection_candidate_t &c = candidates[idx];
+            cv::rectangle(output_image, cv::Rect(c.x, c.y, c.w, c.h),
+                          get_color_from_id(c.class_id), 2);
+            cv::putText(output_image, emitter.label(c.class_id),
+                        cv::Point(c.x, c.y - 10), cv::FONT_HERSHEY_SIMPLEX, 0.8,
+                        cv::Scalar(0), 2);
+        }
+    }
+
+    // views for the eyes of a stereo frame, the right eye of both is resized
+    // from right below the preprocessed left one like a tile
+    void preprocess_stereo(int format, const uint8_t *right, int eye,
+                           std::shared_ptr<cv::Mat> preprocessed_image)
+    {
+        auto views = std::make_shared<frame_views_t>();
+        views->push_back({-1, 0, 0, input_width, input_height, map.T, eye});
+
+        if (stereo == STEREO_BOTH)
+        {
+            start_time = rc_nanos_monotonic_time();
+
+            views->push_back({-1, 0, 0, input_width, input_height, map.T, 1});
+            cv::Mat stack(model_height * 2, model_width, CV_8UC3);
+            cv::Mat whole = stack(cv::Rect(0, 0, model_width, model_height));
+            preprocessed_image->copyTo(whole);
+            cv::Mat block = stack(cv::Rect(0, model_height, model_width, model_height));
+            resize_tile(format, right, nullptr, &map, block);
+            *preprocessed_image = stack;
+
+            if (en_timing)
+                total_preprocess_time += ((rc_nanos_monotonic_time() - start_time) / 1000000.);
+        }
+
+        preprocess_views = views;
+    }
+
+    // nms and publishing per eye that ran this frame, then the pairs
+    bool postprocess_stereo(cv::Mat &output_image, double last_inference_time)
+    {
+        bool ran[2] = {false, false};
+        for (const frame_view_t &v : *inference_views)
+            ran[v.eye] = true;
+        const int shown = (*inference_views)[0].eye;
+
+        emitted_eyes = 0;
+        for (int eye = 0; eye < 2; eye++)
+        {
+            if (!ran[eye])
+                continue;
+
+            candidates.clear();
+            candidates.swap(eye ? right_candidates : view_candidates);
+            nms.clear();
+            for (const auto &c : candidates)
+                nms.add(c.x, c.y, c.x + c.w, c.y + c.h, c.class_conf, c.class_id);
+            nms.run(nms_params, nms_keep);
+
+            DetectionEmitter &e = eye ? right_emitter : emitter;
+            e.emit(candidates, nms_keep, nms, num_frames_processed, rc_nanos_monotonic_time());
+            emitted_eyes |= 1 << eye;
+
+            if (en_debug)
+            {
+                for (int idx : nms_keep)
+                    printf("Detected (%s): %s, Confidence: %6.2f\n", eye ? "right" : "left",
+                           emitter.label(candidates[idx].class_id), (double)nms.get_score(idx));
+            }
+            if (render_output && eye == shown)
+                draw_detections(output_image);
+        }
+
+        // alternate pairs the right eye with the left results of the frame
+        // before, which is as close as they get
+        if (stereo_triangulate && ran[1])
+        {
+            if (!stereo_checked)
+            {
+                stereo_checked = true;
+                if (!matcher.init(cam_name.c_str(), input_width, input_height))
+                    fprintf(stderr, "WARNING: stereo triangulation disabled\n");
+            }
+            matcher.match(emitter.data(), emitter.size(), right_emitter.data(),
+                          right_emitter.size(), cam_name.c_str(), num_frames_processed,
+                          frame_timestamp_ns, stereo_results);
+
+            if (en_debug)
+            {
+                for (const ai_stereo_detection_t &s : stereo_results)
+                    printf("Stereo: %s, range %.2f (%.2f, %.2f, %.2f)\n", s.class_name,
+                           (double)s.range, (double)s.x, (double)s.y, (double)s.z);
+            }
+        }
+
+        if (render_output)
+            draw_fps(output_image, last_inference_time, cv::Point(0, 0), 0.5, 2,
+                     cv::Scalar(0, 0, 0), cv::Scalar(180, 180, 180), true);
+
+        if (en_timing)
+            total_postprocess_time +=
+                ((rc_nanos_monotonic_time() - start_time) / 1000000.);
+
+        return true;
+    }
+
+    // points the roi window at the union of the published boxes
+    void follow_results()
+    {
+        const ai_detection_t *d = emitter.data();
+        const int n = emitter.size();
+        if (n == 0)
+        {
+            roi.set_target(false, 0, 0, 0, 0);
+            return;
+        }
+
+        float x_min = d[0].x_min, y_min = d[0].y_min, x_max = d[0].x_max, y_max = d[0].y_max;
+        for (int i = 1; i < n; i++)
+        {
+            x_min = std::min(x_min, d[i].x_min);
+            y_min = std::min(y_min, d[i].y_min);
+            x_max = std::max(x_max, d[i].x_max);
+            y_max = std::max(y_max, d[i].y_max);
+        }
+        roi.set_target(true, x_min, y_min, x_max, y_max);
+    }
+
+    void decode_detections()
+    {
+        candidates.clear();
+        if (views_decoded)
+            candidates.swap(view_candidates);
+        else
+        {
+            detector_dims_t dims = {model_width, model_height, map.T, (int)label_count};
+            Layout::decode(interpreter.get(), dims, candidates);
+        }
+
+        nms.clear();
+        for (const auto &c : candidates)
+            nms.add(c.x, c.y, c.x + c.w, c.y + c.h, c.class_conf, c.class_id);
+        nms.run(nms_params, nms_keep);
+    }
+
+    bool postprocess_tracks(cv::Mat &output_image, double last_inference_time)
+    {
+        // flow runs on the gray model input of the first view (the whole
+        // frame or the roi crop), the tracks live in input pixels
+        cv::Mat whole = (*preprocessed_image)(cv::Rect(0, 0, model_width, model_height));
+        cv::Mat &gray = tracker.frame();
+        if (whole.channels() == 1)
+            whole.copyTo(gray);
+        else
+            cv::cvtColor(whole, gray, cv::COLOR_RGB2GRAY);
+        const resize_transform_t t = inference_views ? (*inference_views)[0].t : map.T;
+        tracker.set_view(t.x, t.y, model_width / t.w, model_height / t.h);
+
+        if (ran_inference)
+        {
+            decode_detections();
+            tracker.update(candidates, nms_keep, nms, frame_timestamp_ns);
+        }
+        else
+            tracker.propagate(frame_timestamp_ns);
+
+        if (tracker.min_confidence() < tracker_min_confidence)
+            want_detection = true;
+
+        const std::vector<track_t> &tracks = tracker.get_tracks();
+        emitter.emit_tracks(tracks, num_frames_processed, rc_nanos_monotonic_time(),
+                            frame_timestamp_ns);
+
+        if (en_debug)
+        {
+            for (const track_t &t : tracks)
+                printf("Track %u: %s, Confidence: %6.2f%s\n", t.id, emitter.label(t.class_id),
+                       (double)t.confidence, t.propagated ? " (flow)" : "");
+        }
+
+        if (render_output)
+        {
+            char text[BUF_LEN + 16];
+            for (const track_t &t : tracks)
+            {
+                cv::rectangle(output_image, cv::Rect(t.x_min(), t.y_min(), t.w.p, t.h.p),
+                              get_color_from_id(t.class_id), t.propagated ? 1 : 2);
+                snprintf(text, sizeof(text), "%s #%u", emitter.label(t.class_id), t.id);
+                cv::putText(output_image, text, cv::Point(t.x_min(), t.y_min() - 10),
+                            cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0), 2);
+            }
+            draw_fps(output_image, last_inference_time, cv::Point(0, 0), 0.5, 2,
+                     cv::Scalar(0, 0, 0), cv::Scalar(180, 180, 180), true);
+        }
+
+        if (en_timing)
+            total_postprocess_time +=
+                ((rc_nanos_monotonic_time() - start_time) / 1000000.);
+
+        return true;
+    }
+
+    // resizes one tile of the raw camera frame into an rgb model input, rgb
+    // is the full resolution rgb frame for formats without a fused path
+    void resize_tile(int format, const uint8_t *frame, const uint8_t *rgb,
+                     undistort_map_t *tile_map, cv::Mat &block)
+    {
+        const uint8_t *uv = frame + input_width * input_height;
+
+        switch (format)
+        {
+        case IMAGE_FORMAT_NV12:
+        case IMAGE_FORMAT_STEREO_NV12:
+            mcv_resize_nv12_to_rgb(frame, uv, block.data, tile_map, 0);
+            break;
+        case IMAGE_FORMAT_NV21:
+        case IMAGE_FORMAT_STEREO_NV21:
+            mcv_resize_nv12_to_rgb(frame, uv, block.data, tile_map, 1);
+            break;
+        case IMAGE_FORMAT_RAW8:
+        case IMAGE_FORMAT_STEREO_RAW8:
+            tile_gray.create(model_height, model_width, CV_8UC1);
+            mcv_resize_image(frame, tile_gray.data, tile_map);
+            cv::cvtColor(tile_gray, block, cv::COLOR_GRAY2RGB);
+            break;
+        default:
+            mcv_resize_8uc3_image(rgb, block.data, tile_map);
+            break;
+        }
+    }
+
+    bool load_labels()
+    {
+        std::vector<std::string> labels;
+        if (ReadLabelsFile(labels_location, &labels, &label_count) != kTfLiteOk)
+        {
+            fprintf(stderr, "ERROR: Unable to read labels file\n");
+            return false;
+        }
+        emitter.set_labels(labels, label_count);
+        right_emitter.set_labels(labels, label_count);
+        return true;
+    }
+
+    size_t label_count = 0;
+    DetectionEmitter emitter;
+    std::string emitter_cam;
+    std::vector<detection_candidate_t> candidates;
+    std::vector<int> nms_keep;
+
+    // tiled inference
+    TilePlanner tiles;
+    bool views_ready = false; // tiling or roi set up for the input size
+    bool tiling = false;
+    bool views_decoded = false; // candidates of the current frame come from the views
+    std::vector<detection_candidate_t> view_candidates;
+    cv::Mat tile_gray, tile_rgb; // preprocess thread scratch
+
+    // roi crop
+    RoiMode roi_setting = ROI_OFF;
+    RoiWindow roi;
+    bool roi_ready = false;
+
+    // stereo eyes, the left one (or a mono frame) goes through the members
+    // above. emitted_eyes has a bit per eye that published this frame
+    StereoMode stereo = STEREO_LEFT;
+    int next_eye = 0; // alternate mode, preprocess thread
+    DetectionEmitter right_emitter;
+    std::vector<detection_candidate_t> right_candidates;
+    int emitted_eyes = 1;
+    bool stereo_checked = false; // stereo calibration looked for
+    StereoMatcher matcher;
+    std::vector<ai_stereo_detection_t> stereo_results;
+
+    Tracker tracker;
+    int64_t frame_timestamp_ns = 0;
+    int frames_since_inference;             // inference thread only
+    std::atomic<bool> want_detection{false}; // set by postprocess when tracks get unsure
+};
+
+#endif // DETECTOR_MODEL_HELPER_H
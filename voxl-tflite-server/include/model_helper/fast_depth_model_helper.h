@@ -2,18 +2,38 @@
 #define FAST_DEPTH_H
 
 #include "model_helper/model_helper.h"
+#include "camera_calibration.h"
 
 class FastDepthModelHelper : public ModelHelper
 {
 public:
     FastDepthModelHelper(char *model_file, char *labels_file,
                          DelegateOpt delegate_choice, bool _en_debug,
-                         bool _en_timing, NormalizationType _do_normalize);
+                         bool _en_timing, NormalizationType _do_normalize,
+                         const helper_init_t &init = helper_init_t());
     bool postprocess(cv::Mat &output_image, double last_inference_time, void *input_params) override;
     bool worker(cv::Mat &output_image, double last_inference_time, camera_image_metadata_t metadata, void *input_params) override;
 
 private: 
     camera_image_metadata_t new_frame_metadata;
+
+    // per pixel unit-depth rays, built from the camera calibration the first
+    // time a point cloud client connects
+    bool calibration_checked = false;
+    std::vector<float> ray_x;
+    std::vector<float> ray_y;
+    std::vector<float> points;
+
+    bool build_rays();
+    void input_size_changed() override
+    {
+        // rays follow the model input and the view, check the calibration again
+        ray_x.clear();
+        ray_y.clear();
+        calibration_checked = false;
+    }
+    void write_depth(const camera_image_metadata_t &meta, const float *depth);
+    void write_point_cloud(const camera_image_metadata_t &meta, const float *depth);
 };
 
-#endif
\ No newline at end of file
+#endif
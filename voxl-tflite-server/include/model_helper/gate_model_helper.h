@@ -0,0 +1,63 @@
+// model_helper/gate_model_helper.h
+#ifndef GATE_MODEL_HELPER_H
+#define GATE_MODEL_HELPER_H
+
+#include "model_helper/model_helper.h"
+#include <thread>
+#include <atomic>
+
+#include "async_logger.h"
+#include "gate_estimator.h"
+#include "gate_state.h"
+
+// Shared worker for the gate regression models: each frame's raw output is
+// turned into one gate_state_t stamped with the camera frame and written to
+// the data pipe. Subclasses only say which fields their output fills.
+//
+// Every result is also fused into a GateEstimator, and with
+// gate_estimate_rate_hz set a separate thread publishes its prediction for
+// the current time on the gate estimate pipe at that fixed rate.
+class GateModelHelper : public ModelHelper {
+public:
+    GateModelHelper(char *model_file,
+                    char *labels_file,
+                    DelegateOpt delegate_choice,
+                    bool _en_debug,
+                    bool _en_timing,
+                    NormalizationType _do_normalize,
+                    const helper_init_t &init = helper_init_t());
+    ~GateModelHelper();
+    bool worker(cv::Mat &output_image,
+                double last_inference_time,
+                camera_image_metadata_t metadata,
+                void *input_params) override;
+    bool postprocess(cv::Mat &output_image,
+                     double last_inference_time,
+                     void *input_params) override;
+
+    bool can_republish() override { return true; }
+    bool republish(const camera_image_metadata_t &meta) override;
+
+protected:
+    virtual void fill_state(const float *out, gate_state_t &state) = 0;
+
+private:
+    // writes a state to the detection pipe
+    void publish_state(const gate_state_t &state);
+    // feeds a fresh network output to the estimator
+    void fuse_state(const gate_state_t &state);
+
+    // last network result, republished while the scene is unchanged
+    gate_state_t last_state;
+    bool has_last_state = false;
+
+    static constexpr float log_rate_hz = 1.0f;
+    AsyncLogger logger;
+
+    GateEstimator estimator;
+    std::thread estimate_thread;
+    std::atomic<bool> estimate_running{false};
+    void publish_estimates();
+};
+
+#endif
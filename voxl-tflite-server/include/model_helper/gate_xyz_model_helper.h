@@ -2,23 +2,14 @@
 #ifndef GATE_XYZ_MODEL_HELPER_H
 #define GATE_XYZ_MODEL_HELPER_H
 
-#include "model_helper/model_helper.h"
+#include "model_helper/gate_model_helper.h"
 
-class GateXyzModelHelper : public ModelHelper {
+class GateXyzModelHelper : public GateModelHelper {
 public:
-    GateXyzModelHelper(char *model_file,
-                       char *labels_file,
-                       DelegateOpt delegate_choice,
-                       bool _en_debug,
-                       bool _en_timing,
-                       NormalizationType _do_normalize);
-    bool worker(cv::Mat &output_image,
-                double last_inference_time,
-                camera_image_metadata_t metadata,
-                void *input_params) override;
-    bool postprocess(cv::Mat &output_image,
-                     double last_inference_time,
-                     void *input_params) override;
+    using GateModelHelper::GateModelHelper;
+
+protected:
+    void fill_state(const float *out, gate_state_t &state) override;
 };
 
 #endif
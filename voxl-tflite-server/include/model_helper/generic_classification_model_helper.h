@@ -2,6 +2,7 @@
 #define GENERIC_CLASSIFICATION_H
 
 #include "model_helper/model_helper.h"
+#include "ai_classification.h"
 
 class GenericClassificationModelHelper : public ModelHelper
 {
@@ -9,15 +10,26 @@ class GenericClassificationModelHelper : public ModelHelper
 public:
     GenericClassificationModelHelper(char *model_file, char *labels_file,
                                      DelegateOpt delegate_choice, bool _en_debug,
-                                     bool _en_timing, NormalizationType _do_normalize, int tensor_offset);
+                                     bool _en_timing, NormalizationType _do_normalize,
+                                     const helper_init_t &init = helper_init_t());
 
     bool postprocess(cv::Mat &output_image, double last_inference_time, void *input_params) override;
     bool worker(cv::Mat &output_image, double last_inference_time, camera_image_metadata_t metadata, void *input_params) override;
 
+    bool can_republish() override { return true; }
+    bool republish(const camera_image_metadata_t &meta) override;
+
 private:
     std::vector<std::string> labels;
     size_t label_count;
-    int tensor_offset;
+
+    // results of the last postprocess, best first
+    int num_results = 0;
+    int result_class[AI_CLASSIFICATION_MAX_K];
+    float result_score[AI_CLASSIFICATION_MAX_K];
+
+    bool select_top_k(TfLiteTensor *output);
+    void write_results(const camera_image_metadata_t &meta);
 };
 
 #endif
@@ -8,7 +8,11 @@
 #include <memory>
 #include <opencv2/imgproc/types_c.h>
 #include <mutex>
+#include <shared_mutex>
 #include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include "absl/memory/memory.h"
 #include "tensorflow/lite/delegates/gpu/delegate.h"
@@ -22,6 +26,12 @@
 #include "config_file.h"
 #include "tensor_data.h"
 #include "model_info.h"
+#include "image_publisher.h"
+#include "nms.h"
+#include "scene_gate.h"
+#include "frame_views.h"
+#include "latency_governor.h"
+#include "camera_calibration.h"
 
 #ifdef BUILD_QRB5165
 #include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
@@ -31,10 +41,21 @@
 
 #define DETECTION_CH 1
 #define IMAGE_CH 0
+#define DEPTH_CH 2       // depth models only, float32 metric depth
+#define POINT_CLOUD_CH 3 // depth models only, xyz in the camera frame
+#define GATE_ESTIMATE_CH 4 // gate models only, filtered gate_state_t at a fixed rate
+#define TRACK_CH 5         // detection models with the tracker on, ai_track_t per track
+#define STEREO_CH 6        // detection models with stereo_triangulate, ai_stereo_detection_t per pair
 #define MAX_IMAGE_SIZE 12441600
 #define QUEUE_SIZE 24 // max messages to be stored in queue
+#define EXTRA_CAMERA_QUEUE_SIZE 3 // extra cameras, the scheduler only runs their newest frame
 #define NORMALIZATION_CONST 255.0f
 #define PIXEL_MEAN_GUESS 127.0f
+#define DYNAMIC_INPUT_SIZE 256 // resolution used for models without a fixed input size
+#define LETTERBOX_PAD 114      // gray the letterbox padding is filled with, as in yolo training
+#define INPUT_SCALE_STEP 0.25f // input_scale_levels shrink the model input by this much each
+#define INPUT_SCALE_ALIGN 32   // scaled inputs are a multiple of the largest yolo stride
+#define INPUT_SCALE_MIN 96     // smallest scaled input side
 
 enum DelegateOpt
 {
@@ -53,13 +74,85 @@ enum NormalizationType
 struct TFLiteMessage
 {
     camera_image_metadata_t metadata;     // image metadata information
+    bool has_thumbnail;                   // thumbnail was taken on ingest for the scene gate
+    uint8_t thumbnail[SCENE_THUMB_SIZE];
     uint8_t image_pixels[MAX_IMAGE_SIZE]; // image pixels
 };
 
+// an interpreter of the model resized to one input resolution, with the
+// delegates it was modified with (they can't be shared between graphs)
+struct interpreter_variant_t
+{
+    int width;
+    int height;
+    std::shared_ptr<tflite::Interpreter> interpreter;
+    TfLiteDelegate *gpu_delegate = nullptr;
+#ifdef BUILD_QRB5165
+    TfLiteDelegate *xnnpack_delegate = nullptr;
+    tflite::StatefulNnApiDelegate *nnapi_delegate = nullptr;
+#endif
+};
+
+// one interpreter of the pool the pipeline invokes on side by side. Slot 0
+// is the helper's own interpreter, its delegates stay in the helper's
+// members, the other slots own theirs
+struct pool_slot_t
+{
+    interpreter_variant_t v = {};
+    DelegateOpt backend;
+    uint64_t frames = 0; // invoked by the inference thread of the slot only
+    double total_ms = 0;
+};
+
+// resize map and buffer preprocess needs for one stream geometry, built
+// off the pipeline and swapped in between frames
+struct input_state_t
+{
+    int width = 0;
+    int height = 0;
+    int format = -1;
+    int model_width = 0; // model input size it was built for
+    int model_height = 0;
+    undistort_map_t map = {};
+    uint8_t *resize_output = nullptr;
+    bool corrected = false;
+    bool has_corrected_cal = false;
+    camera_calibration_t corrected_cal = {};
+    cv::Mat overlay_map1, overlay_map2;
+};
+
+// Frames of one camera. The callback never writes the newest complete frame
+// or the one preprocess is reading, so neither changes under its reader,
+// which takes at least 3 slots.
 struct TFLiteCamQueue
 {
-    TFLiteMessage queue[QUEUE_SIZE]; // camera frame queue
-    int insert_idx = 0;              // next element insert location (between 0 - QUEUE_SIZE)
+    TFLiteMessage *queue = nullptr; // camera frame queue of size, null while released
+    int size = QUEUE_SIZE;          // every message is MAX_IMAGE_SIZE, keep it small
+
+    // guarded by mutex, taken after the helper's lifecycle_mutex
+    std::mutex mutex;
+    int newest = -1;      // last complete frame, -1 for none
+    int in_use = -1;      // taken by the scheduler for preprocess, -1 for none
+    uint64_t written = 0; // frames completed so far, the scheduler counts against it
+
+    // camera callback: the slot to copy the next frame into, then mark it
+    // complete
+    int begin_write();
+    void end_write(int slot);
+
+    // preprocess is done with the slot the scheduler gave it
+    void release();
+};
+
+class ModelHelper;
+
+// how create_model_helper sets up the helper of one camera, the defaults
+// are the first camera's
+struct helper_init_t
+{
+    ModelHelper *share_interpreter_of = nullptr; // extra cameras run on that helper's interpreter
+    int queue_size = QUEUE_SIZE;                 // depth of the camera queue
+    int channel_offset = 0;                      // outputs go to the channels from here on
 };
 
 class ModelHelper
@@ -70,19 +163,20 @@ protected:
     int model_height;
     int model_channels;
 
-    // cam properties
-    int input_width;
-    int input_height;
+    // cam properties, of the stream the current resize map was built for
+    int input_width = 0;
+    int input_height = 0;
+    int input_format = -1;
 
     // labels
     char *labels_location;
 
     // delegate ptrs
     DelegateOpt hardware_selection;
-    TfLiteDelegate *gpu_delegate;
+    TfLiteDelegate *gpu_delegate = nullptr;
 #ifdef BUILD_QRB5165
-    TfLiteDelegate *xnnpack_delegate;
-    tflite::StatefulNnApiDelegate *nnapi_delegate;
+    TfLiteDelegate *xnnpack_delegate = nullptr;
+    tflite::StatefulNnApiDelegate *nnapi_delegate = nullptr;
 #endif
 
     // only used if running an object detection model
@@ -97,23 +191,101 @@ protected:
     // timing variables
     float total_preprocess_time = 0;
     float total_inference_time = 0;
+    std::atomic<int64_t> pool_inference_ns{0}; // run_inference_on, every slot's thread adds to it
     float total_postprocess_time = 0;
     uint64_t start_time = 0;
     int num_frames_processed = 0;
+    int64_t last_render_ns = 0;
 
     // tflite
+    std::string model_path;
+    std::string gpu_model_token; // gpu kernel cache key, model file name and input size
     std::unique_ptr<tflite::FlatBufferModel> model;
-    std::unique_ptr<tflite::Interpreter> interpreter;
+    std::shared_ptr<tflite::Interpreter> interpreter;
     tflite::ops::builtin::BuiltinOpResolver resolver;
 
-    // mcv resize vars
-    uint8_t *resize_output;
-    undistort_map_t map;
+    // set on the helpers of extra cameras, they run on this helper's
+    // interpreter and have no model or delegates of their own. The pipeline
+    // never invokes an interpreter before its last frame was postprocessed
+    ModelHelper *interpreter_owner = nullptr;
+
+    // added to every *_CH this helper writes to, each camera has its own
+    // block of output channels. Fixed before any derived constructor runs,
+    // those can start threads that publish
+    int ch_offset = 0;
+
+    // set when the overlay is downscaled and/or jpeg encoded off-thread
+    ImagePublisher *image_publisher = nullptr;
+
+    // writes the annotated overlay to the image pipe, stamped with the
+    // current time, either directly or through the image publisher
+    void publish_output_image(camera_image_metadata_t meta, const cv::Mat &image);
+
+    // shared by the object detectors, method/mode/top_k come from the config
+    // file and each detector fills in its own thresholds
+    NmsEngine nms;
+    nms_params_t nms_params;
+
+    // mcv resize vars, built for the stream geometry by input_ready(). map.T
+    // maps the model input back to input pixels
+    uint8_t *resize_output = nullptr;
+    undistort_map_t map = {};
+
+    // set by helpers that map their results back through map.T, the frame
+    // is fit into the model input with padding instead of stretched
+    bool letterbox = false;
+
+    // input_undistort/rotation/flip are folded into map, results and the
+    // overlay are in the corrected view. corrected_cal is its pinhole
+    // intrinsics when it was undistorted
+    bool input_corrected = false;
+    bool has_corrected_cal = false;
+    camera_calibration_t corrected_cal = {};
+    cv::Mat overlay_map1, overlay_map2;
+
+    // the stream geometry (width/height/format) is checked on every frame.
+    // On a change the input state is built for it on input_build_thread while
+    // frames are dropped, then install_input_state() swaps it in
+    input_state_t pending_input;
+    std::thread input_build_thread;
+    std::atomic<bool> input_build_done{false};
+    std::atomic<bool> input_state_ready{false};
+    bool input_ready(const camera_image_metadata_t &meta);
+    void build_input_state(input_state_t &s);
+    void build_corrected_map(input_state_t &s);
+    void swap_input_state(input_state_t &s);
+    void discard_pending_input();
+
+    // map preprocess resizes the frame through, subclasses may point it at a
+    // crop of the same model size for a frame
+    undistort_map_t *input_map = &map;
+
+    // input resolutions prepared by prepare_input_variants(), largest (the
+    // model's own) first. The active one is moved out into interpreter and
+    // the delegate members, its slot only keeps the size
+    std::vector<interpreter_variant_t> variants;
+    int active_variant = 0;
+    int variant_levels = 0;
+    LatencyGovernor governor;
+
+    // interpreter_pool, built by prepare_interpreter_pool(). The extra
+    // cameras' helpers use the owner's pool
+    std::vector<pool_slot_t> pool;
+    int pool_extra = 0;
+    int64_t pool_start_ns = 0;
+    int num_threads = 0; // cpu threads of the interpreter being built, 0 for the platform default
+    ModelHelper *pool_owner() { return interpreter_owner != nullptr ? interpreter_owner : this; }
 
 public:
     ModelHelper(char *model_file, char *labels_file,
                 DelegateOpt delegate_choice, bool _en_debug,
-                bool _en_timing, NormalizationType _do_normalize);
+                bool _en_timing, NormalizationType _do_normalize,
+                const helper_init_t &init = helper_init_t());
+
+    // decides on ingest whether the annotated output image of a frame will be
+    // published. If not, preprocess gets a null output_image and postprocess
+    // runs with render_output cleared so only the results are decoded
+    bool should_render_output(const camera_image_metadata_t &meta);
 
     // preprocess method, common across most sub classes
     virtual bool preprocess(camera_image_metadata_t &meta,
@@ -125,31 +297,124 @@ public:
     virtual bool run_inference(cv::Mat &preprocessed_image,
                                double *last_inference_time);
 
+    // builds extra interpreters of the model on interpreter_pool_delegate so
+    // the pipeline can invoke frames side by side, called once before it
+    // starts. Only for helpers whose inference is a plain invoke per frame
+    bool prepare_interpreter_pool(int extra);
+    virtual bool can_pool() { return variants.size() < 2; }
+
+    // interpreters the pipeline can invoke on at the same time, 1 without
+    // a pool
+    int pool_slots() { return std::max(1, (int)pool_owner()->pool.size()); }
+
+    // run_inference() on the pool interpreter of slot, any inference thread
+    bool run_inference_on(int slot, const cv::Mat &preprocessed_image,
+                          double *last_inference_time);
+
+    // whether invokes on slot run on the gpu or nnapi, the accelerator the
+    // invoke arbiter orders between models
+    bool slot_on_accelerator(int slot);
+
+    // postprocess thread only, points interpreter at the outputs of the
+    // slot a frame ran on and back to slot 0 once it is decoded. No-op
+    // without a pool
+    void select_interpreter(int slot);
+
+    // asked by the inference thread for every frame, helpers that can carry
+    // their results forward without the network (tracking) return false to
+    // skip run_inference and go straight to postprocess
+    virtual bool needs_inference() { return true; }
+
+    // helpers that keep their last results can republish them, restamped
+    // for a new frame, when the scene gate finds the view hasn't changed
+    virtual bool can_republish() { return false; }
+    virtual bool republish(const camera_image_metadata_t &meta) { return false; }
+
     // post process method, almost never common across classes except for
     // a few generic methods for certain problem types.
     virtual bool postprocess(cv::Mat &output_image, double last_inference_time, void *input_params = nullptr) = 0;
     virtual bool worker(cv::Mat &output_image, double last_inference_time, camera_image_metadata_t metadata, void *input_params = nullptr) = 0;
     void print_summary_stats();
 
-    virtual ~ModelHelper() = default;
+    // drop the interpreter, delegate and frame buffers while the server is
+    // idle, the flatbuffer model stays mapped so restoring is just a rebuild
+    void release_resources();
+    bool restore_resources();
+    bool resources_released = false;
+
+    // called by the postprocess thread after each inferred frame, outside
+    // the lifecycle lock. Switches to the input resolution the governor
+    // picks for the measured latency, between frames, and bumps
+    // input_generation so frames preprocessed for the old size get dropped
+    void adapt_input_size(double last_inference_ms);
+    int input_generation = 0;
+
+    // called by the preprocess thread between frames, outside the lifecycle
+    // lock. Swaps in the input state built for a new stream geometry once
+    // it is done, frames preprocessed for the old one get dropped the same
+    // way as on an input size switch
+    void install_input_state();
+
+    virtual ~ModelHelper();
 
     std::string cam_name;
-    pthread_t thread;                 // model thread handle
-    std::mutex cond_mutex;            // mutex
-    std::condition_variable cond_var; // condition variable
+    std::shared_timed_mutex lifecycle_mutex; // shared by pipeline stages, exclusive for release/restore
+
+    int out_ch(int ch) const { return ch + ch_offset; }
+    // anyone subscribed to any of this helper's outputs
+    bool has_clients() const;
+    bool shares_interpreter() const { return interpreter_owner != nullptr; }
 
     TFLiteCamQueue camera_queue; // camera message queue for the thread
+    SceneGate scene_gate;        // skips inference on unchanged frames, preprocess thread only
 
     std::shared_ptr<cv::Mat> preprocessed_image; // added here mostly for the segmenation model but could be useful elsewhere
+    bool render_output = true;                   // whether the frame being postprocessed gets an overlay published
+    bool ran_inference = true;                   // whether the interpreter outputs belong to the frame being postprocessed
+
+    // views the frame being preprocessed was cut into, handed to the
+    // inference thread along with the frame. Null when the whole frame is
+    // the only model input
+    std::shared_ptr<frame_views_t> preprocess_views; // preprocess thread
+    std::shared_ptr<frame_views_t> inference_views;  // inference thread
 
 protected:
+    // copies a model_width x model_height image into the input tensor,
+    // converting and normalizing for the tensor type. run_inference() is
+    // this plus Invoke()
+    bool fill_input(const cv::Mat &preprocessed_image) { return fill_input(interpreter.get(), preprocessed_image); }
+    bool fill_input(tflite::Interpreter *interp, const cv::Mat &preprocessed_image);
+
     // Function to setup the delegate based on selection
     void setupDelegate(DelegateOpt delegate_choice);
+
+    // interpreter + delegate construction, shared by the constructor and
+    // restore_resources()
+    // width/height > 0 resizes the input before the delegate is applied
+    bool build_interpreter(int width = 0, int height = 0);
+    void release_interpreter();
+
+    // builds, validates and warms up an interpreter per input resolution
+    // for switching under load, levels counts the model's own. Only for
+    // fully convolutional models whose decoding follows model_width/height
+    bool prepare_input_variants(int levels);
+    void stash_interpreter(interpreter_variant_t &v);
+    void load_interpreter(interpreter_variant_t &v);
+    void release_variants();
+
+    // builds up to extra pool interpreters, returns how many it built
+    int build_pool(int extra);
+    void release_pool();
+
+    // the model input size changed, anything built for the old one has to
+    // be rebuilt. Called with the lifecycle lock held exclusively
+    virtual void input_size_changed() {}
 };
 
 ModelHelper *create_model_helper(ModelName model_name,
                                  ModelCategory model_category,
                                  DelegateOpt opt_,
-                                 NormalizationType do_normalize);
+                                 NormalizationType do_normalize,
+                                 const helper_init_t &init = helper_init_t());
 
 #endif // MODEL_HELPER_H
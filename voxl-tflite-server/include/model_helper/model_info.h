@@ -34,7 +34,8 @@ enum ModelCategory
     CLASSIFICATION,
     SEGMENTATION,
     MONO_DEPTH,
-    POSE
+    POSE,
+    GATE
 };
 
 class GenericObjectDetectionModelParams
@@ -2,15 +2,33 @@
 #define POSENET_H
 
 #include "model_helper/model_helper.h"
+#include "ai_pose.h"
 
+// MoveNet SinglePose ([1][1][17][3]) and MultiPose ([1][6][56]) models, told
+// apart by the output shape
 class PoseNetModelHelper : public ModelHelper
 {
 public:
     PoseNetModelHelper(char *model_file, char *labels_file,
                        DelegateOpt delegate_choice, bool _en_debug,
-                       bool _en_timing, NormalizationType _do_normalize);
+                       bool _en_timing, NormalizationType _do_normalize,
+                       const helper_init_t &init = helper_init_t());
     bool postprocess(cv::Mat &output_image, double last_inference_time, void *input_params) override;
     bool worker(cv::Mat &output_image, double last_inference_time, camera_image_metadata_t metadata, void *input_params) override;
+
+    bool can_republish() override { return true; }
+    bool republish(const camera_image_metadata_t &meta) override;
+
+private:
+    static constexpr float confidence_threshold = 0.2f;
+    static constexpr float person_threshold = 0.2f;
+
+    // people found in the last frame, filled straight from the output tensor
+    std::vector<ai_pose_t> poses;
+
+    void write_poses(const camera_image_metadata_t &meta);
+    void decode_single(const float *data);
+    void decode_multi(const float *data, int num_people);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,77 @@
+#ifndef NMS_H
+#define NMS_H
+
+#include <stdint.h>
+#include <vector>
+
+enum NmsMethod
+{
+    NMS_HARD,          // greedy, drop anything overlapping a kept box
+    NMS_GRID,          // same result as NMS_HARD, kept boxes are bucketed on a
+                       // spatial grid so crowded frames only test neighbours
+    NMS_SOFT_LINEAR,   // Soft-NMS, overlapping scores decay by (1 - iou)
+    NMS_SOFT_GAUSSIAN  // Soft-NMS, overlapping scores decay by exp(-iou^2 / sigma)
+};
+
+typedef struct nms_params_t
+{
+    NmsMethod method = NMS_HARD;
+    float iou_threshold = 0.5f;   // suppress (or decay, for linear soft-nms) above this
+    float score_threshold = 0.0f; // drop boxes at or below this score, for
+                                  // soft-nms also applies to decayed scores
+    float sigma = 0.5f;           // gaussian soft-nms only
+    int top_k = 0;                // only the top_k scores enter nms, 0 keeps all
+    int max_detections = 0;       // stop after this many are kept, 0 is unlimited
+    bool class_aware = false;     // boxes only suppress boxes of the same class
+} nms_params_t;
+
+// parses "hard", "grid", "soft_linear" or "soft_gaussian", returns -1 if the
+// string doesn't match any of them
+int nms_method_from_string(const char *str, NmsMethod *method);
+
+// Non-maximum suppression shared by every detector.
+//
+// Boxes are stored struct-of-arrays so the overlap of one box against all
+// kept (or remaining) boxes vectorizes. In class-aware mode the class test is
+// folded into the same vector compare so the inner loop stays branch free.
+// All buffers are reused between frames.
+class NmsEngine
+{
+public:
+    void clear();
+    void add(float x_min, float y_min, float x_max, float y_max,
+             float score, int class_id);
+    int size() { return (int)score.size(); }
+
+    // indices (in add() order) of the boxes that survived, highest score
+    // first. Soft-NMS decays scores, get_score() returns the final value.
+    void run(const nms_params_t &params, std::vector<int> &keep);
+
+    float get_score(int idx) { return score[idx]; }
+
+private:
+    void sort_candidates(const nms_params_t &params);
+    void run_hard(const nms_params_t &params, std::vector<int> &keep);
+    void run_grid(const nms_params_t &params, std::vector<int> &keep);
+    void run_soft(const nms_params_t &params, std::vector<int> &keep);
+
+    // boxes as added
+    std::vector<float> x1, y1, x2, y2, score;
+    std::vector<int> class_id;
+
+    // candidates in descending score order
+    std::vector<uint64_t> keys;
+    std::vector<int> order;
+
+    // working set the overlap kernels run over, kept boxes for hard/grid
+    // (widx holds their class) or live candidates for soft-nms (widx holds
+    // their index)
+    std::vector<float> wx1, wy1, wx2, wy2, warea, wscore;
+    std::vector<int> widx;
+
+    // grid variant buckets and per-box visit stamps
+    std::vector<std::vector<int>> cells;
+    std::vector<int> stamp;
+};
+
+#endif // NMS_H
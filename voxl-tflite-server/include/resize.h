@@ -15,21 +15,66 @@ typedef struct bilinear_lookup_t{
 } bilinear_lookup_t;
 
 
+// where the output of a map sits in the input image, for mapping results
+// on the output back to input pixels: the normalized output position (u, v)
+// in [0, 1] was sampled from input (x + u*w, y + v*h). A letterboxed map
+// covers more than the frame, its padding maps past the frame edges
+typedef struct resize_transform_t{
+    float x;
+    float y;
+    float w;
+    float h;
+} resize_transform_t;
+
+
 typedef struct undistort_map_t{
     int w_in;			    // input image width
     int h_in;			    // input image height
     int w_out;              // output image width
     int h_out;              // output image height
     bilinear_lookup_t* L;   // lookup table
+    resize_transform_t T;   // output to input transform
+    uint8_t pad;            // value written for output pixels outside the input
 } undistort_map_t;
 
 // takes the input and output dimensions and generates a lookup table
 int mcv_init_resize_map(int w_in, int h_in, int w_out, int h_out, undistort_map_t* map);
+// "" but only for the w_crop x h_crop region at (x0, y0) of the input. The
+// table still indexes the full input image, so the resize functions below
+// take the whole frame and only read the crop
+int mcv_init_crop_resize_map(int w_in, int h_in, int x0, int y0, int w_crop, int h_crop,
+                             int w_out, int h_out, undistort_map_t* map);
+// "" but keeps the crop's aspect ratio, the crop is scaled to fit and
+// centered and the rest of the output is filled with pad by the resize
+// functions (letterbox)
+int mcv_init_letterbox_resize_map(int w_in, int h_in, int x0, int y0, int w_crop, int h_crop,
+                                  int w_out, int h_out, uint8_t pad, undistort_map_t* map);
+// the w_fit x h_fit region at (u0, v0) of a w_out x h_out output that a
+// w_crop x h_crop image is scaled into by the letterbox map
+void mcv_letterbox_fit(int w_crop, int h_crop, int w_out, int h_out,
+                       int* u0, int* v0, int* w_fit, int* h_fit);
+// builds a map from any per-output-pixel source position, src_x/src_y are
+// w_out*h_out input pixel coordinates and anything negative, nan or past
+// the input edge is filled with pad. Lets a single map fold lens
+// undistortion, rotation and scaling together. The transform of such a map
+// is only known to whoever made the coordinates, map->T is set to the
+// plain output size for the caller to overwrite
+int mcv_init_remap(int w_in, int h_in, int w_out, int h_out,
+                   const float* src_x, const float* src_y, uint8_t pad,
+                   undistort_map_t* map);
+// moves a crop map by (dx, dy) input pixels without recomputing the weights,
+// the caller keeps the moved crop inside the input image
+void mcv_shift_resize_map(undistort_map_t* map, int dx, int dy);
 
 // resizes the image using the lookup table created by mcv_init_resize_map
 int mcv_resize_image(const uint8_t* input, uint8_t* output, undistort_map_t* map);
 // "" but with 3 channels
 int mcv_resize_8uc3_image(const uint8_t* rgb_input, uint8_t* output, undistort_map_t* map);
+// resizes a semi-planar yuv420 image straight to rgb without a full resolution
+// color conversion. Y is sampled bilinearly, chroma from the nearest sample.
+// swap_uv selects NV21 (VU interleaved) instead of NV12
+int mcv_resize_nv12_to_rgb(const uint8_t* y_plane, const uint8_t* uv_plane,
+                           uint8_t* output, undistort_map_t* map, int swap_uv);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,59 @@
+#ifndef SCENE_GATE_H
+#define SCENE_GATE_H
+
+#include <stdint.h>
+#include <modal_pipe.h>
+
+#define SCENE_THUMB_W 32
+#define SCENE_THUMB_H 24
+#define SCENE_THUMB_SIZE (SCENE_THUMB_W * SCENE_THUMB_H)
+#define SCENE_THUMB_SAMPLES 4 // samples per cell side, averaged
+
+// Fills a SCENE_THUMB_W x SCENE_THUMB_H luma thumbnail of a camera frame,
+// each cell the mean of a sparse SCENE_THUMB_SAMPLES^2 grid of Y samples
+// inside it. Reads ~12k pixels regardless of resolution so it is cheap
+// enough for the camera callback. Returns false for formats without a luma
+// plane the thumbnail can be taken from.
+bool scene_thumbnail(const camera_image_metadata_t &meta, const uint8_t *frame,
+                     uint8_t *thumb);
+
+// largest absolute difference between two thumbnails, in gray levels
+int scene_thumbnail_diff(const uint8_t *a, const uint8_t *b);
+
+// Decides whether a frame is close enough to the last inferred one that its
+// results can be republished instead of running the model again.
+//
+// Frames are compared against the reference (the last frame that was
+// actually inferred), not their predecessor, so a slow drift still adds up
+// to a change. The largest cell difference is used rather than the mean so
+// a small object moving through an otherwise static view is caught. No
+// frame is skipped more than max_interval_s after the reference, which
+// bounds how stale a republished result can get.
+class SceneGate
+{
+public:
+    // threshold in gray levels, 0 never skips
+    void configure(int threshold, float max_interval_s);
+
+    // true if the frame can reuse the results of the reference frame
+    bool unchanged(const uint8_t *thumb, int64_t timestamp_ns);
+
+    // the frame is being inferred and becomes the new reference
+    void set_reference(const uint8_t *thumb, int64_t timestamp_ns);
+
+    void print_stats();
+
+    // counters, preprocess thread only
+    int frames_checked = 0;
+    int frames_skipped = 0;
+    int frames_forced = 0; // unchanged but past max_interval_s
+
+private:
+    int threshold = 0;
+    int64_t max_interval_ns = 0;
+    bool has_reference = false;
+    int64_t reference_ns = 0;
+    uint8_t reference[SCENE_THUMB_SIZE];
+};
+
+#endif // SCENE_GATE_H
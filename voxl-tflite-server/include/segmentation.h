@@ -0,0 +1,45 @@
+#ifndef SEGMENTATION_H
+#define SEGMENTATION_H
+
+#include <stdint.h>
+
+// class ids at or above this draw black in the overlay
+#define SEG_MAX_COLORS 32
+
+// value written to the mask for ids that don't fit in a uint8_t
+#define SEG_INVALID_CLASS 255
+
+// per channel color table, kept planar so the NEON path can use it as a
+// table lookup directly
+typedef struct seg_color_lut_t
+{
+    uint8_t r[SEG_MAX_COLORS];
+    uint8_t g[SEG_MAX_COLORS];
+    uint8_t b[SEG_MAX_COLORS];
+} seg_color_lut_t;
+
+// Builders for a row-major uint8 class mask of n pixels.
+//
+// The *_labels variants take a model that already ends in ArgMax, the
+// *_argmax variants take raw per pixel logits [n][num_classes] and pick the
+// first highest scoring class. Quantized logits don't need dequantizing,
+// the scale is positive so the argmax is the same.
+void seg_mask_from_labels_i64(const int64_t *classes, int n, uint8_t *mask);
+void seg_mask_from_labels_i32(const int32_t *classes, int n, uint8_t *mask);
+void seg_argmax_f32(const float *logits, int n, int num_classes, uint8_t *mask);
+void seg_argmax_u8(const uint8_t *logits, int n, int num_classes, uint8_t *mask);
+void seg_argmax_i8(const int8_t *logits, int n, int num_classes, uint8_t *mask);
+
+// Colorizes the mask through lut and blends it over an rgb image in one pass:
+// out = (3 * img + color + 2) / 4, the same 75/25 mix addWeighted gave us.
+// img and out may be the same buffer.
+void seg_colorize_blend(const uint8_t *img, int img_stride, const uint8_t *mask,
+                        int width, int height, const seg_color_lut_t *lut,
+                        uint8_t *out, int out_stride);
+
+// Run-length encodes n mask pixels as (class id, run length 1-255) byte pairs,
+// see segmentation_mask.h. out must hold 2 * n bytes for the worst case,
+// returns the number of bytes written.
+int seg_rle_encode(const uint8_t *mask, int n, uint8_t *out);
+
+#endif // SEGMENTATION_H
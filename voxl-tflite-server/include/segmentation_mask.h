@@ -0,0 +1,50 @@
+#ifndef SEGMENTATION_MASK_H
+#define SEGMENTATION_MASK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define SEGMENTATION_MASK_MAGIC_NUMBER (0x564F584D)
+
+#define SEGMENTATION_MASK_RAW 0 // width * height class ids, row-major
+#define SEGMENTATION_MASK_RLE 1 // (class id, run length 1-255) byte pairs, row-major
+                                // runs continue across row boundaries
+
+// Header of every message on a segmentation model's data pipe, immediately
+// followed by size_bytes of mask data in the given encoding. Class ids index
+// the labels file of the model, 255 marks pixels with no valid class.
+typedef struct segmentation_mask_t {
+    uint32_t magic_number;
+    int64_t timestamp_ns;   // timestamp of the camera frame the mask came from
+    int32_t frame_id;
+    uint16_t width;         // model resolution
+    uint16_t height;
+    uint16_t num_classes;
+    uint8_t encoding;       // SEGMENTATION_MASK_RAW or SEGMENTATION_MASK_RLE
+    uint8_t reserved;
+    uint32_t size_bytes;    // mask data following this header
+} __attribute__((packed)) segmentation_mask_t;
+
+// expands an rle payload into mask (width * height bytes), returns the number
+// of pixels written or -1 if the payload would overflow the mask
+static inline int segmentation_mask_rle_decode(const uint8_t *data, uint32_t size_bytes,
+                                               uint8_t *mask, int num_pixels)
+{
+    int n = 0;
+    for (uint32_t i = 0; i + 1 < size_bytes; i += 2) {
+        uint8_t id = data[i];
+        int run = data[i + 1];
+        if (n + run > num_pixels) return -1;
+        for (int k = 0; k < run; k++) mask[n++] = id;
+    }
+    return n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SEGMENTATION_MASK_H
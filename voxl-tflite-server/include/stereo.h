@@ -0,0 +1,78 @@
+#ifndef STEREO_H
+#define STEREO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <modal_pipe.h>
+
+#include "ai_detection.h"
+#include "ai_stereo.h"
+#include "camera_calibration.h"
+
+#define STEREO_MAX_EPIPOLAR 0.25f  // distance of a right box center from its epipolar line, fraction of the box height
+#define STEREO_MAX_SIZE_RATIO 1.5f // matched boxes differ in height by less than this
+
+enum StereoMode
+{
+    STEREO_LEFT,     // left eye only, the right image is ignored
+    STEREO_BOTH,     // both eyes every frame
+    STEREO_ALTERNATE // one eye per frame, left first
+};
+
+// "left", "both" or "alternate", returns -1 for anything else
+int stereo_mode_from_string(const char *str, StereoMode *mode);
+
+// bytes of one eye of a stereo frame (the left image comes first, the right
+// one right after it), 0 for mono formats
+size_t stereo_eye_bytes(const camera_image_metadata_t &meta);
+
+// Pairs up the boxes the two eyes of a stereo camera found and triangulates
+// their centers into a rough 3D position.
+//
+// Box centers are undistorted into rays of their eye. A left and a right box
+// of the same class can only be the same object when the right center lies
+// close to the epipolar line of the left one and the boxes are about the
+// same height, the pairs are then taken greedily by epipolar distance. The
+// position is the midpoint of the closest approach of the two rays, which
+// doesn't need rectified images. Box centers are only a rough stand-in for
+// the same point on the object, so the range is a cue, not a depth map.
+class StereoMatcher
+{
+public:
+    // false without a stereo calibration for the camera
+    bool init(const char *cam_name, int input_width, int input_height);
+    bool ready() const { return calibrated; }
+
+    // boxes are in input pixels of their eye, out is replaced with the
+    // matched pairs tagged with cam
+    void match(const ai_detection_t *left, int n_left, const ai_detection_t *right,
+               int n_right, const char *cam, int32_t frame_id, int64_t timestamp_ns,
+               std::vector<ai_stereo_detection_t> &out);
+
+private:
+    struct pair_t
+    {
+        int l, r;
+        float cost;
+    };
+
+    void centers(const camera_calibration_t &c, const ai_detection_t *d, int n,
+                 std::vector<float> &rx, std::vector<float> &ry);
+    bool triangulate(float xl, float yl, float xr, float yr, float p[3]);
+
+    bool calibrated = false;
+    stereo_calibration_t cal = {};
+    int width = 0, height = 0;
+    float focal_right = 0; // right eye focal length in input pixels
+    double E[9];           // essential matrix, [T]x R
+    double C2[3];          // right camera center in the left frame
+    double Rt[9];          // R transposed, right rays into the left frame
+
+    // scratch reused between frames
+    std::vector<float> px, py, lx, ly, rx, ry;
+    std::vector<pair_t> pairs;
+    std::vector<bool> used_l, used_r;
+};
+
+#endif // STEREO_H
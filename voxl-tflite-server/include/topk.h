@@ -0,0 +1,17 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <stdint.h>
+
+// Picks the k highest values of x[0..n) into idx/val, highest first. Equal
+// values keep the lower index first. Returns the number picked, min(k, n).
+//
+// Blocks of 16 scores are compared against the current k-th best with one
+// vector max and skipped as a whole, so for k << n nearly every score is
+// touched once and never sorted. Quantized scores can be ranked raw, the
+// scale is positive so the order is the same as after dequantizing.
+int topk_f32(const float *x, int n, int k, int *idx, float *val);
+int topk_u8(const uint8_t *x, int n, int k, int *idx, uint8_t *val);
+int topk_i8(const int8_t *x, int n, int k, int *idx, int8_t *val);
+
+#endif // TOPK_H
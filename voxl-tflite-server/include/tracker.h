@@ -0,0 +1,96 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "kalman_cv.h"
+#include "yolo_decode.h"
+#include "nms.h"
+
+#define TRACK_IOU_THRESHOLD    0.30f  // min overlap to associate a detection with a track
+#define TRACK_MAX_MISSES       1      // network frames a track survives without a match
+#define TRACK_GRID             5      // flow points per box side
+#define TRACK_MIN_FLOW_RATIO   0.50f  // fraction of flow points that must agree
+#define TRACK_DROP_CONFIDENCE  0.10f  // tracks below this are removed
+#define TRACK_POS_ACCEL_NOISE  400.0f // box center, input pixels/s^2
+#define TRACK_SIZE_ACCEL_NOISE 100.0f // box size, input pixels/s^2
+#define TRACK_DET_SIGMA        4.0f   // detection box noise, input pixels
+#define TRACK_FLOW_SIGMA       8.0f   // flow box noise, input pixels
+
+typedef struct track_t
+{
+    uint32_t id;
+    int32_t class_id;
+    float confidence; // detection score, decayed by every flow update since
+    uint32_t age;     // frames since creation
+    int misses;       // consecutive network frames without a match
+    bool propagated;  // last update came from flow rather than the network
+    KalmanAxis cx, cy, w, h; // box center and size in input pixels
+
+    float x_min() const { return cx.p - 0.5f * w.p; }
+    float y_min() const { return cy.p - 0.5f * h.p; }
+    float x_max() const { return cx.p + 0.5f * w.p; }
+    float y_max() const { return cy.p + 0.5f * h.p; }
+} track_t;
+
+// SORT style multi object tracker with optical flow in between detections.
+//
+// On frames the network ran, every track is predicted to the frame time and
+// greedily matched to the same class detection it overlaps most, unmatched
+// detections start new tracks. On frames without inference the tracks are
+// carried by pyramidal Lucas-Kanade flow of a grid of points inside each box
+// on the gray model-resolution frame: the median motion and scale of the
+// points that agree move the box, and the agreeing fraction decays the track
+// confidence, so drifting tracks ask for a fresh detection on their own.
+//
+// The caller writes the gray frame into frame(), says which part of the
+// input it shows with set_view() and then calls update() or propagate(),
+// the previous frame is kept without a copy.
+class Tracker
+{
+public:
+    // region of the input the current frame() shows and its model pixels
+    // per input pixel, flow runs at model resolution. Frames showing
+    // different regions (roi crops) aren't compared, tracks coast instead
+    void set_view(float x, float y, float model_per_input_x, float model_per_input_y);
+
+    cv::Mat &frame() { return frames[cur]; }
+
+    void update(const std::vector<detection_candidate_t> &candidates,
+                const std::vector<int> &keep, NmsEngine &nms, int64_t timestamp_ns);
+    void propagate(int64_t timestamp_ns);
+
+    const std::vector<track_t> &get_tracks() const { return tracks; }
+
+    // lowest confidence of the live tracks, 1 without tracks
+    float min_confidence() const;
+
+private:
+    void predict(int64_t timestamp_ns);
+    void start_track(const detection_candidate_t &c, float score);
+
+    std::vector<track_t> tracks;
+    uint32_t next_id = 1;
+    int64_t last_ns = 0;
+    struct view_t
+    {
+        float x, y;
+        float sx, sy;
+    };
+
+    cv::Mat frames[2];
+    view_t views[2] = {};
+    int cur = 0;
+
+    // reused between frames
+    std::vector<cv::Point2f> prev_pts, next_pts;
+    std::vector<uchar> status;
+    std::vector<float> err;
+    std::vector<float> dx, dy, ratio, scratch;
+    std::vector<std::pair<float, std::pair<int, int>>> pairs;
+    std::vector<char> track_matched, det_matched;
+};
+
+#endif // TRACKER_H
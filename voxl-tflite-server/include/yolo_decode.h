@@ -0,0 +1,42 @@
+#ifndef YOLO_DECODE_H
+#define YOLO_DECODE_H
+
+#include <stdint.h>
+#include <vector>
+
+// a single box that survived the decoder thresholds, box is in input image
+// pixels (top left corner + size). Shared by every detector output layout.
+typedef struct detection_candidate_t
+{
+    int32_t class_id;
+    float class_conf;
+    float box_conf;
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+} detection_candidate_t;
+
+// YoloV5 output, anchor-major [num_anchors][5 + num_classes] with every grid
+// scale concatenated: x, y, w, h, box confidence, class confidences.
+//
+// Anchors below box_thresh are rejected before the class scan, survivors
+// keep the highest scoring class if it reaches class_thresh.
+void yolov5_decode(const float *data, int num_anchors, int num_classes,
+                   float box_thresh, float class_thresh,
+                   float scale_x, float scale_y,
+                   std::vector<detection_candidate_t> &out);
+
+// YoloV8/V11 output, channel-major [4 + num_channels][num_anchors]:
+// x, y, w, h rows followed by one row per class. Scanned in place, no
+// transpose. Anchors whose best class score is above score_thresh are kept,
+// box_conf is set to -1 since these models have no objectness output.
+//
+// num_classes may be less than num_channels (short labels file), only the
+// first num_classes rows are considered.
+void yolov8_decode(const float *data, int num_anchors, int num_channels,
+                   int num_classes, float score_thresh,
+                   float scale_x, float scale_y,
+                   std::vector<detection_candidate_t> &out);
+
+#endif // YOLO_DECODE_H
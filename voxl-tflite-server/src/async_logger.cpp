@@ -0,0 +1,73 @@
+#include "async_logger.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "utils.h"
+
+AsyncLogger::AsyncLogger(float max_rate_hz)
+{
+    min_interval_ns = max_rate_hz > 0 ? (uint64_t)(1e9 / max_rate_hz) : 0;
+    thread = std::thread(&AsyncLogger::run, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cond.notify_one();
+    thread.join();
+}
+
+void AsyncLogger::log(const char *fmt, ...)
+{
+    const uint64_t now = rc_nanos_monotonic_time();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (now - last_log_ns < min_interval_ns || count == ASYNC_LOGGER_QUEUE)
+    {
+        num_dropped++;
+        return;
+    }
+    last_log_ns = now;
+
+    char *line = lines[(head + count) % ASYNC_LOGGER_QUEUE];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, ASYNC_LOGGER_LINE_LEN, fmt, args);
+    va_end(args);
+    count++;
+
+    lock.unlock();
+    cond.notify_one();
+}
+
+void AsyncLogger::run()
+{
+    char line[ASYNC_LOGGER_LINE_LEN];
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait(lock, [this] { return count > 0 || !running; });
+        if (count == 0)
+            break;
+
+        memcpy(line, lines[head], ASYNC_LOGGER_LINE_LEN);
+        head = (head + 1) % ASYNC_LOGGER_QUEUE;
+        count--;
+        const int dropped = num_dropped;
+        num_dropped = 0;
+
+        // print without holding the lock so log() never waits on stdout
+        lock.unlock();
+        if (dropped > 0)
+            printf("%s (%d skipped)\n", line, dropped);
+        else
+            printf("%s\n", line);
+        fflush(stdout);
+        lock.lock();
+    }
+}
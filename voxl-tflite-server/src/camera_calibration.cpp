@@ -0,0 +1,379 @@
+#include "camera_calibration.h"
+#include <opencv2/opencv.hpp>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+// eye is "" for mono files, "1" or "2" for the M1/D1 and M2/D2 of stereo ones
+static int load_file(const std::string &path, camera_calibration_t *cal,
+                     const std::string &eye = "")
+{
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened())
+        return -1;
+
+    cv::Mat K, D;
+    std::string model;
+    fs["M" + eye] >> K;
+    fs["D" + eye] >> D;
+    fs["distortion_model"] >> model;
+
+    if (K.rows != 3 || K.cols != 3)
+    {
+        fprintf(stderr, "ERROR: no camera matrix in %s\n", path.c_str());
+        return -1;
+    }
+    K.convertTo(K, CV_64F);
+    if (!D.empty())
+        D.convertTo(D, CV_64F);
+
+    *cal = {};
+    cal->fx = K.at<double>(0, 0);
+    cal->fy = K.at<double>(1, 1);
+    cal->cx = K.at<double>(0, 2);
+    cal->cy = K.at<double>(1, 2);
+    cal->fisheye = (model == "fisheye");
+    cal->n_dist = std::min((int)D.total(), CAMERA_CALIBRATION_MAX_DIST);
+    for (int i = 0; i < cal->n_dist; i++)
+        cal->dist[i] = D.ptr<double>()[i];
+
+    // older calibration files don't record the resolution
+    if (!fs["width"].empty() && !fs["height"].empty())
+    {
+        fs["width"] >> cal->width;
+        fs["height"] >> cal->height;
+    }
+
+    return 0;
+}
+
+int camera_calibration_load(const char *cam_name, camera_calibration_t *cal)
+{
+    std::string name(cam_name);
+
+    while (!name.empty())
+    {
+        std::string path = CAMERA_CALIBRATION_DIR "opencv_" + name + "_intrinsics.yml";
+        if (access(path.c_str(), F_OK) == 0)
+        {
+            if (load_file(path, cal))
+                return -1;
+            printf("Loaded camera calibration %s\n", path.c_str());
+            return 0;
+        }
+
+        size_t split = name.find_last_of('_');
+        if (split == std::string::npos)
+            break;
+        name.resize(split);
+    }
+
+    fprintf(stderr, "WARNING: no camera calibration found for %s in %s\n",
+            cam_name, CAMERA_CALIBRATION_DIR);
+    return -1;
+}
+
+int stereo_calibration_load(const char *cam_name, stereo_calibration_t *cal)
+{
+    std::string name(cam_name);
+
+    while (!name.empty())
+    {
+        std::string intrinsics = CAMERA_CALIBRATION_DIR "opencv_" + name + "_intrinsics.yml";
+        std::string extrinsics = CAMERA_CALIBRATION_DIR "opencv_" + name + "_extrinsics.yml";
+        if (access(intrinsics.c_str(), F_OK) == 0 && access(extrinsics.c_str(), F_OK) == 0)
+        {
+            if (load_file(intrinsics, &cal->left, "1") || load_file(intrinsics, &cal->right, "2"))
+                return -1;
+
+            cv::FileStorage fs(extrinsics, cv::FileStorage::READ);
+            cv::Mat R, T;
+            fs["R"] >> R;
+            fs["T"] >> T;
+            if (R.total() != 9 || T.total() != 3)
+            {
+                fprintf(stderr, "ERROR: no R and T in %s\n", extrinsics.c_str());
+                return -1;
+            }
+            R.convertTo(R, CV_64F);
+            T.convertTo(T, CV_64F);
+            memcpy(cal->R, R.ptr<double>(), sizeof(cal->R));
+            memcpy(cal->T, T.ptr<double>(), sizeof(cal->T));
+
+            printf("Loaded stereo calibration %s\n", intrinsics.c_str());
+            return 0;
+        }
+
+        size_t split = name.find_last_of('_');
+        if (split == std::string::npos)
+            break;
+        name.resize(split);
+    }
+
+    fprintf(stderr, "WARNING: no stereo calibration found for %s in %s\n",
+            cam_name, CAMERA_CALIBRATION_DIR);
+    return -1;
+}
+
+// unit-depth rays of pixels of an input_width x input_height stream
+static void undistort_points(const camera_calibration_t *cal, int input_width,
+                             int input_height, std::vector<cv::Point2f> &pixels,
+                             float *ray_x, float *ray_y)
+{
+    if (pixels.empty())
+        return;
+
+    // the calibration may be for a larger stream of the same camera
+    const double sx = cal->width > 0 ? (double)cal->width / input_width : 1.0;
+    const double sy = cal->height > 0 ? (double)cal->height / input_height : 1.0;
+    for (cv::Point2f &p : pixels)
+        p = cv::Point2f(p.x * sx, p.y * sy);
+
+    double k[9] = {cal->fx, 0, cal->cx, 0, cal->fy, cal->cy, 0, 0, 1};
+    cv::Mat K(3, 3, CV_64F, k);
+    cv::Mat D(1, cal->n_dist, CV_64F, (void *)cal->dist);
+
+    // undistortPoints gives normalized coordinates, which is the ray at z = 1
+    std::vector<cv::Point2f> rays;
+    if (cal->fisheye && cal->n_dist == 4)
+        cv::fisheye::undistortPoints(pixels, rays, K, D);
+    else if (cal->n_dist > 0)
+        cv::undistortPoints(pixels, rays, K, D);
+    else
+    {
+        rays.resize(pixels.size());
+        for (size_t i = 0; i < pixels.size(); i++)
+            rays[i] = cv::Point2f((pixels[i].x - cal->cx) / cal->fx,
+                                  (pixels[i].y - cal->cy) / cal->fy);
+    }
+
+    for (size_t i = 0; i < rays.size(); i++)
+    {
+        ray_x[i] = rays[i].x;
+        ray_y[i] = rays[i].y;
+    }
+}
+
+void camera_calibration_build_rays(const camera_calibration_t *cal,
+                                   int input_width, int input_height,
+                                   int width, int height,
+                                   float *ray_x, float *ray_y)
+{
+    // same sample positions as the mcv resize map the model input came from
+    const double x_r = (double)(input_width - 1) / width;
+    const double y_r = (double)(input_height - 1) / height;
+
+    std::vector<cv::Point2f> pixels(width * height);
+    for (int v = 0; v < height; v++)
+        for (int u = 0; u < width; u++)
+            pixels[v * width + u] = cv::Point2f(u * x_r, v * y_r);
+
+    undistort_points(cal, input_width, input_height, pixels, ray_x, ray_y);
+}
+
+void camera_calibration_undistort_points(const camera_calibration_t *cal,
+                                         int input_width, int input_height,
+                                         const float *x, const float *y, int n,
+                                         float *ray_x, float *ray_y)
+{
+    std::vector<cv::Point2f> pixels(n);
+    for (int i = 0; i < n; i++)
+        pixels[i] = cv::Point2f(x[i], y[i]);
+    undistort_points(cal, input_width, input_height, pixels, ray_x, ray_y);
+}
+
+void camera_correction_size(const input_correction_t *corr, int input_width,
+                            int input_height, int *width, int *height)
+{
+    const bool swap = corr->rotation == 90 || corr->rotation == 270;
+    *width = swap ? input_height : input_width;
+    *height = swap ? input_width : input_height;
+}
+
+// pinhole intrinsics of the unrotated undistorted view, input sized, turned
+// into the ones of the rotated and flipped view
+static void correct_intrinsics(const input_correction_t *corr, int input_width,
+                               int input_height, double fx, double fy, double cx,
+                               double cy, camera_calibration_t *out)
+{
+    *out = {};
+    camera_correction_size(corr, input_width, input_height, &out->width, &out->height);
+
+    switch (corr->rotation)
+    {
+    case 90:
+        out->fx = fy;
+        out->fy = fx;
+        out->cx = (input_height - 1) - cy;
+        out->cy = cx;
+        break;
+    case 180:
+        out->fx = fx;
+        out->fy = fy;
+        out->cx = (input_width - 1) - cx;
+        out->cy = (input_height - 1) - cy;
+        break;
+    case 270:
+        out->fx = fy;
+        out->fy = fx;
+        out->cx = cy;
+        out->cy = (input_width - 1) - cx;
+        break;
+    default:
+        out->fx = fx;
+        out->fy = fy;
+        out->cx = cx;
+        out->cy = cy;
+        break;
+    }
+
+    if (corr->flip)
+    {
+        out->fx = -out->fx;
+        out->cx = (out->width - 1) - out->cx;
+    }
+}
+
+void camera_calibration_build_remap(const camera_calibration_t *cal,
+                                    const input_correction_t *corr,
+                                    int input_width, int input_height,
+                                    int width, int height,
+                                    float *src_x, float *src_y,
+                                    camera_calibration_t *corrected)
+{
+    int cw, ch;
+    camera_correction_size(corr, input_width, input_height, &cw, &ch);
+
+    // same sample positions as an mcv resize map of the corrected view
+    const double x_r = (double)(cw - 1) / width;
+    const double y_r = (double)(ch - 1) / height;
+
+    // undo the flip and rotation, giving pixels of the upright view
+    std::vector<cv::Point2f> pixels(width * height);
+    for (int v = 0; v < height; v++)
+    {
+        for (int u = 0; u < width; u++)
+        {
+            double xc = u * x_r;
+            double yc = v * y_r;
+            if (corr->flip)
+                xc = (cw - 1) - xc;
+
+            double x, y;
+            switch (corr->rotation)
+            {
+            case 90:
+                x = yc;
+                y = (input_height - 1) - xc;
+                break;
+            case 180:
+                x = (input_width - 1) - xc;
+                y = (input_height - 1) - yc;
+                break;
+            case 270:
+                x = (input_width - 1) - yc;
+                y = xc;
+                break;
+            default:
+                x = xc;
+                y = yc;
+                break;
+            }
+            pixels[v * width + u] = cv::Point2f(x, y);
+        }
+    }
+
+    if (corr->undistort && cal != nullptr)
+    {
+        // the calibration may be for a larger stream of the same camera
+        const double sx = cal->width > 0 ? (double)cal->width / input_width : 1.0;
+        const double sy = cal->height > 0 ? (double)cal->height / input_height : 1.0;
+        const cv::Size cal_size((int)lround(input_width * sx), (int)lround(input_height * sy));
+
+        double k[9] = {cal->fx, 0, cal->cx, 0, cal->fy, cal->cy, 0, 0, 1};
+        cv::Mat K(3, 3, CV_64F, k);
+        cv::Mat D(1, cal->n_dist, CV_64F, (void *)cal->dist);
+        const bool fisheye = cal->fisheye && cal->n_dist == 4;
+
+        // pinhole view keeping only pixels the lens actually saw
+        cv::Mat K_new;
+        if (fisheye)
+            cv::fisheye::estimateNewCameraMatrixForUndistortRectify(
+                K, D, cal_size, cv::Mat::eye(3, 3, CV_64F), K_new, 0.0);
+        else
+            K_new = cv::getOptimalNewCameraMatrix(K, D, cal_size, 0.0);
+        const double fx = K_new.at<double>(0, 0);
+        const double fy = K_new.at<double>(1, 1);
+        const double cx = K_new.at<double>(0, 2);
+        const double cy = K_new.at<double>(1, 2);
+
+        // upright view pixel -> ray -> distorted calibration pixel
+        std::vector<cv::Point2f> distorted;
+        if (fisheye)
+        {
+            for (cv::Point2f &p : pixels)
+                p = cv::Point2f((p.x * sx - cx) / fx, (p.y * sy - cy) / fy);
+            cv::fisheye::distortPoints(pixels, distorted, K, D);
+        }
+        else
+        {
+            std::vector<cv::Point3f> rays(pixels.size());
+            for (size_t i = 0; i < pixels.size(); i++)
+                rays[i] = cv::Point3f((pixels[i].x * sx - cx) / fx,
+                                      (pixels[i].y * sy - cy) / fy, 1.0f);
+            cv::Mat zero = cv::Mat::zeros(3, 1, CV_64F);
+            cv::projectPoints(rays, zero, zero, K, D, distorted);
+        }
+
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = cv::Point2f(distorted[i].x / sx, distorted[i].y / sy);
+
+        if (corrected != nullptr)
+            correct_intrinsics(corr, input_width, input_height, fx / sx, fy / sy,
+                               cx / sx, cy / sy, corrected);
+    }
+
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        src_x[i] = pixels[i].x;
+        src_y[i] = pixels[i].y;
+    }
+}
+
+void depth_to_points(const float *depth, const float *ray_x, const float *ray_y,
+                     int n, float *xyz)
+{
+    int i = 0;
+
+#ifdef __ARM_NEON
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t nan = vdupq_n_f32(NAN);
+    for (; i + 4 <= n; i += 4)
+    {
+        float32x4_t z = vld1q_f32(depth + i);
+        // also false for nan depth so those stay nan
+        z = vbslq_f32(vcgtq_f32(z, zero), z, nan);
+
+        float32x4x3_t p;
+        p.val[0] = vmulq_f32(z, vld1q_f32(ray_x + i));
+        p.val[1] = vmulq_f32(z, vld1q_f32(ray_y + i));
+        p.val[2] = z;
+        vst3q_f32(xyz + 3 * i, p);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        const float z = depth[i] > 0.0f ? depth[i] : NAN;
+        xyz[3 * i + 0] = z * ray_x[i];
+        xyz[3 * i + 1] = z * ray_y[i];
+        xyz[3 * i + 2] = z;
+    }
+}
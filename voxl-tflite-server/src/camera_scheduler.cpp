@@ -0,0 +1,139 @@
+#include "camera_scheduler.h"
+#include <algorithm>
+#include <chrono>
+
+void CameraScheduler::add(CameraStream *stream)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stream->pass = vtime;
+    streams.push_back(stream);
+}
+
+void CameraScheduler::notify()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending = true;
+    cond.notify_all();
+}
+
+CameraStream *CameraScheduler::next(int *slot)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (main_running)
+    {
+        const int64_t now = rc_nanos_monotonic_time();
+        CameraStream *best = nullptr;
+        double best_pass = 0;
+        int64_t best_ts = 0;
+        int64_t wake_ns = 0; // earliest frame held back by its rate
+
+        for (CameraStream *s : streams)
+        {
+            // the queue was released while idle, anything left in it is gone.
+            // Held while the newest frame's timestamp is read
+            TFLiteCamQueue &q = s->helper->camera_queue;
+            std::shared_lock<std::shared_timed_mutex> lifecycle_lock(s->helper->lifecycle_mutex);
+            std::lock_guard<std::mutex> queue_lock(q.mutex);
+            const uint64_t queued = q.written - s->read_count;
+            if (queued == 0)
+                continue;
+            if (q.queue == nullptr || q.newest < 0)
+            {
+                s->read_count = q.written;
+                continue;
+            }
+
+            const int64_t ts = q.queue[q.newest].metadata.timestamp_ns;
+            if (now - ts > SCHEDULER_MAX_FRAME_AGE_MS * 1000000LL)
+            {
+                s->frames_dropped += queued;
+                s->read_count = q.written;
+                continue;
+            }
+
+            if (s->rate_hz > 0 && now < s->next_due_ns)
+            {
+                if (wake_ns == 0 || s->next_due_ns < wake_ns)
+                    wake_ns = s->next_due_ns;
+                continue;
+            }
+
+            const double pass = std::max(s->pass, vtime);
+            if (best == nullptr || pass < best_pass || (pass == best_pass && ts < best_ts))
+            {
+                best = s;
+                best_pass = pass;
+                best_ts = ts;
+            }
+        }
+
+        if (best != nullptr)
+        {
+            // reserve the newest frame for preprocess, the callback writes
+            // around it until it is released. Frames may have come in since
+            // the scan, the newest one is taken
+            TFLiteCamQueue &q = best->helper->camera_queue;
+            {
+                std::shared_lock<std::shared_timed_mutex> lifecycle_lock(best->helper->lifecycle_mutex);
+                std::lock_guard<std::mutex> queue_lock(q.mutex);
+                if (q.queue == nullptr || q.newest < 0)
+                {
+                    best->read_count = q.written;
+                    continue;
+                }
+                best->frames_dropped += q.written - best->read_count - 1;
+                best->read_count = q.written;
+                q.in_use = q.newest;
+                *slot = q.newest;
+            }
+            best->frames_run++;
+            best->total_wait_ms += (now - best_ts) / 1000000.;
+
+            vtime = best_pass;
+            best->pass = best_pass + 1.0 / std::max(best->priority, 1);
+
+            // keep the cadence unless the camera fell more than a period behind
+            if (best->rate_hz > 0)
+            {
+                const int64_t period = (int64_t)(1e9 / best->rate_hz);
+                best->next_due_ns = now - best->next_due_ns > period ? now + period
+                                                                     : best->next_due_ns + period;
+            }
+
+            return best;
+        }
+
+        pending = false;
+        if (wake_ns > 0)
+            cond.wait_for(lock, std::chrono::nanoseconds(wake_ns - now),
+                          [this] { return pending || !main_running; });
+        else
+            cond.wait(lock, [this] { return pending || !main_running; });
+    }
+
+    return nullptr;
+}
+
+void CameraScheduler::print_stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const int64_t now = rc_nanos_monotonic_time();
+    if (stats_start_ns == 0)
+        stats_start_ns = now;
+    const double elapsed_s = (now - stats_start_ns) / 1e9;
+    if (elapsed_s < SCHEDULER_STATS_PERIOD_S)
+        return;
+
+    for (CameraStream *s : streams)
+    {
+        printf("%-24s %5.1f fps, %4llu dropped, waited %6.2fms\n", s->helper->cam_name.c_str(),
+               s->frames_run / elapsed_s, (unsigned long long)s->frames_dropped,
+               s->frames_run > 0 ? s->total_wait_ms / s->frames_run : 0.0);
+        s->frames_run = 0;
+        s->frames_dropped = 0;
+        s->total_wait_ms = 0;
+    }
+    stats_start_ns = now;
+}
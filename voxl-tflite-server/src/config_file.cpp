@@ -2,11 +2,55 @@
 
 char model[CHAR_BUF_SIZE];
 char input_pipe[CHAR_BUF_SIZE];
+int input_priority;
+float input_rate_hz;
+camera_config_t extra_cameras[MAX_EXTRA_CAMERAS];
+int n_extra_cameras;
 char delegate[CHAR_BUF_SIZE];
+int interpreter_pool;
+char interpreter_pool_delegate[CHAR_BUF_SIZE];
+int interpreter_pool_threads;
+bool invoke_arbiter;
+int model_priority;
+float model_deadline_ms;
+bool arbiter_shed;
 int skip_n_frames;
 bool allow_multiple;
 char output_pipe_prefix[CHAR_BUF_SIZE];
 char labels_in_use[CHAR_BUF_SIZE];
+float idle_suspend_s;
+float idle_release_s;
+char gpu_cache_dir[CHAR_BUF_SIZE];
+float overlay_rate_hz;
+int overlay_width;
+bool overlay_jpeg;
+int overlay_jpeg_quality;
+char nms_method[CHAR_BUF_SIZE];
+bool nms_class_aware;
+int nms_top_k;
+bool segmentation_mask_rle;
+int classification_top_k;
+float gate_estimate_rate_hz;
+int tracker_detect_interval;
+float tracker_min_confidence;
+int scene_change_threshold;
+float scene_change_max_interval_s;
+bool tiled_inference;
+float tile_overlap;
+int tile_refresh_frames;
+char roi_mode[CHAR_BUF_SIZE];
+float roi_window[4];
+float roi_margin;
+float roi_smoothing;
+int roi_full_frame_interval;
+float latency_budget_ms;
+int input_scale_levels;
+bool letterbox_input;
+bool input_undistort;
+int input_rotation;
+bool input_flip;
+char stereo_mode[CHAR_BUF_SIZE];
+bool stereo_triangulate;
 
 void config_file_print(void)
 {
@@ -16,8 +60,56 @@ void config_file_print(void)
     printf("model:                            %s\n", model);
     printf("=================================================================\n");
     printf("input_pipe:                       %s\n", input_pipe);
+    printf("input_priority:                   %d\n", input_priority);
+    printf("input_rate_hz:                    %.1f\n", (double)input_rate_hz);
+    for (int i = 0; i < n_extra_cameras; i++)
+        printf("extra_cameras[%d]:                 %s priority %d rate %.1fHz\n", i,
+               extra_cameras[i].input_pipe, extra_cameras[i].priority,
+               (double)extra_cameras[i].rate_hz);
     printf("=================================================================\n");
     printf("delegate:                         %s\n", delegate);
+    printf("interpreter_pool:                 %d\n", interpreter_pool);
+    printf("interpreter_pool_delegate:        %s\n", interpreter_pool_delegate);
+    printf("interpreter_pool_threads:         %d\n", interpreter_pool_threads);
+    printf("invoke_arbiter:                   %s\n", invoke_arbiter ? "true" : "false");
+    printf("model_priority:                   %d\n", model_priority);
+    printf("model_deadline_ms:                %.1f\n", (double)model_deadline_ms);
+    printf("arbiter_shed:                     %s\n", arbiter_shed ? "true" : "false");
+    printf("=================================================================\n");
+    printf("idle_suspend_s:                   %.1f\n", (double)idle_suspend_s);
+    printf("idle_release_s:                   %.1f\n", (double)idle_release_s);
+    printf("gpu_cache_dir:                    %s\n", gpu_cache_dir);
+    printf("overlay_rate_hz:                  %.1f\n", (double)overlay_rate_hz);
+    printf("overlay_width:                    %d\n", overlay_width);
+    printf("overlay_jpeg:                     %s\n", overlay_jpeg ? "true" : "false");
+    printf("overlay_jpeg_quality:             %d\n", overlay_jpeg_quality);
+    printf("nms_method:                       %s\n", nms_method);
+    printf("nms_class_aware:                  %s\n", nms_class_aware ? "true" : "false");
+    printf("nms_top_k:                        %d\n", nms_top_k);
+    printf("segmentation_mask_rle:            %s\n", segmentation_mask_rle ? "true" : "false");
+    printf("classification_top_k:             %d\n", classification_top_k);
+    printf("gate_estimate_rate_hz:            %.1f\n", (double)gate_estimate_rate_hz);
+    printf("tracker_detect_interval:          %d\n", tracker_detect_interval);
+    printf("tracker_min_confidence:           %.2f\n", (double)tracker_min_confidence);
+    printf("scene_change_threshold:           %d\n", scene_change_threshold);
+    printf("scene_change_max_interval_s:      %.2f\n", (double)scene_change_max_interval_s);
+    printf("tiled_inference:                  %s\n", tiled_inference ? "true" : "false");
+    printf("tile_overlap:                     %.2f\n", (double)tile_overlap);
+    printf("tile_refresh_frames:              %d\n", tile_refresh_frames);
+    printf("roi_mode:                         %s\n", roi_mode);
+    printf("roi_window:                       %.2f %.2f %.2f %.2f\n", (double)roi_window[0],
+           (double)roi_window[1], (double)roi_window[2], (double)roi_window[3]);
+    printf("roi_margin:                       %.2f\n", (double)roi_margin);
+    printf("roi_smoothing:                    %.2f\n", (double)roi_smoothing);
+    printf("roi_full_frame_interval:          %d\n", roi_full_frame_interval);
+    printf("latency_budget_ms:                %.1f\n", (double)latency_budget_ms);
+    printf("input_scale_levels:               %d\n", input_scale_levels);
+    printf("letterbox_input:                  %s\n", letterbox_input ? "true" : "false");
+    printf("input_undistort:                  %s\n", input_undistort ? "true" : "false");
+    printf("input_rotation:                   %d\n", input_rotation);
+    printf("input_flip:                       %s\n", input_flip ? "true" : "false");
+    printf("stereo_mode:                      %s\n", stereo_mode);
+    printf("stereo_triangulate:               %s\n", stereo_triangulate ? "true" : "false");
     printf("=================================================================\n");
 #ifdef BUILD_QRB5165
     printf("allow_multiple:                   %s\n", allow_multiple ? "true" : "false");
@@ -44,7 +136,101 @@ int config_file_read(void)
     json_fetch_int_with_default(parent, "skip_n_frames", &skip_n_frames, 0);
     json_fetch_string_with_default(parent, "model", model, CHAR_BUF_SIZE, "/usr/bin/dnn/ssdlite_mobilenet_v2_coco.tflite");
     json_fetch_string_with_default(parent, "input_pipe", input_pipe, CHAR_BUF_SIZE, "/run/mpa/hires_small_color/");
+    json_fetch_int_with_default(parent, "input_priority", &input_priority, 1);
+    json_fetch_float_with_default(parent, "input_rate_hz", &input_rate_hz, 0.0f);
+    int n_cameras = 0;
+    cJSON *cameras = json_fetch_array_of_objects_and_add_if_missing(parent, "extra_cameras", &n_cameras);
+    if (n_cameras > MAX_EXTRA_CAMERAS)
+    {
+        fprintf(stderr, "WARNING: only the first %d extra_cameras are used\n", MAX_EXTRA_CAMERAS);
+        n_cameras = MAX_EXTRA_CAMERAS;
+    }
+    n_extra_cameras = 0;
+    for (int i = 0; i < n_cameras; i++)
+    {
+        cJSON *item = cJSON_GetArrayItem(cameras, i);
+        camera_config_t *c = &extra_cameras[n_extra_cameras];
+        if (json_fetch_string(item, "input_pipe", c->input_pipe, CHAR_BUF_SIZE))
+        {
+            fprintf(stderr, "WARNING: extra_cameras[%d] has no input_pipe\n", i);
+            continue;
+        }
+        json_fetch_int_with_default(item, "priority", &c->priority, 1);
+        json_fetch_float_with_default(item, "rate_hz", &c->rate_hz, 0.0f);
+        n_extra_cameras++;
+    }
     json_fetch_string_with_default(parent, "delegate", delegate, CHAR_BUF_SIZE, "gpu");
+    json_fetch_int_with_default(parent, "interpreter_pool", &interpreter_pool, 0);
+    if (interpreter_pool < 0 || interpreter_pool > MAX_POOL_INTERPRETERS)
+    {
+        fprintf(stderr, "WARNING: interpreter_pool must be 0 to %d, using 0\n", MAX_POOL_INTERPRETERS);
+        interpreter_pool = 0;
+    }
+    json_fetch_string_with_default(parent, "interpreter_pool_delegate", interpreter_pool_delegate, CHAR_BUF_SIZE, "cpu");
+    json_fetch_int_with_default(parent, "interpreter_pool_threads", &interpreter_pool_threads, 2);
+    int tmp_invoke_arbiter;
+    json_fetch_bool_with_default(parent, "invoke_arbiter", &tmp_invoke_arbiter, 0);
+    invoke_arbiter = tmp_invoke_arbiter;
+    json_fetch_int_with_default(parent, "model_priority", &model_priority, 1);
+    json_fetch_float_with_default(parent, "model_deadline_ms", &model_deadline_ms, 100.0f);
+    int tmp_arbiter_shed;
+    json_fetch_bool_with_default(parent, "arbiter_shed", &tmp_arbiter_shed, 1);
+    arbiter_shed = tmp_arbiter_shed;
+    json_fetch_float_with_default(parent, "idle_suspend_s", &idle_suspend_s, 2.0f);
+    json_fetch_float_with_default(parent, "idle_release_s", &idle_release_s, 0.0f);
+    json_fetch_string_with_default(parent, "gpu_cache_dir", gpu_cache_dir, CHAR_BUF_SIZE, "/data/modalai/tflite_cache/");
+    json_fetch_float_with_default(parent, "overlay_rate_hz", &overlay_rate_hz, 0.0f);
+    json_fetch_int_with_default(parent, "overlay_width", &overlay_width, 0);
+    int tmp_overlay_jpeg;
+    json_fetch_bool_with_default(parent, "overlay_jpeg", &tmp_overlay_jpeg, 0);
+    overlay_jpeg = tmp_overlay_jpeg;
+    json_fetch_int_with_default(parent, "overlay_jpeg_quality", &overlay_jpeg_quality, 75);
+    json_fetch_string_with_default(parent, "nms_method", nms_method, CHAR_BUF_SIZE, "hard");
+    int tmp_nms_class_aware;
+    json_fetch_bool_with_default(parent, "nms_class_aware", &tmp_nms_class_aware, 0);
+    nms_class_aware = tmp_nms_class_aware;
+    json_fetch_int_with_default(parent, "nms_top_k", &nms_top_k, 0);
+    int tmp_segmentation_mask_rle;
+    json_fetch_bool_with_default(parent, "segmentation_mask_rle", &tmp_segmentation_mask_rle, 1);
+    segmentation_mask_rle = tmp_segmentation_mask_rle;
+    json_fetch_int_with_default(parent, "classification_top_k", &classification_top_k, 5);
+    json_fetch_float_with_default(parent, "gate_estimate_rate_hz", &gate_estimate_rate_hz, 50.0f);
+    json_fetch_int_with_default(parent, "tracker_detect_interval", &tracker_detect_interval, 0);
+    json_fetch_float_with_default(parent, "tracker_min_confidence", &tracker_min_confidence, 0.5f);
+    json_fetch_int_with_default(parent, "scene_change_threshold", &scene_change_threshold, 0);
+    json_fetch_float_with_default(parent, "scene_change_max_interval_s", &scene_change_max_interval_s, 1.0f);
+    int tmp_tiled_inference;
+    json_fetch_bool_with_default(parent, "tiled_inference", &tmp_tiled_inference, 0);
+    tiled_inference = tmp_tiled_inference;
+    json_fetch_float_with_default(parent, "tile_overlap", &tile_overlap, 0.2f);
+    json_fetch_int_with_default(parent, "tile_refresh_frames", &tile_refresh_frames, 10);
+    json_fetch_string_with_default(parent, "roi_mode", roi_mode, CHAR_BUF_SIZE, "off");
+    float default_roi_window[4] = {0.25f, 0.25f, 0.5f, 0.5f};
+    json_fetch_fixed_vector_float_with_default(parent, "roi_window", roi_window, 4, default_roi_window);
+    json_fetch_float_with_default(parent, "roi_margin", &roi_margin, 0.5f);
+    json_fetch_float_with_default(parent, "roi_smoothing", &roi_smoothing, 0.5f);
+    json_fetch_int_with_default(parent, "roi_full_frame_interval", &roi_full_frame_interval, 15);
+    json_fetch_float_with_default(parent, "latency_budget_ms", &latency_budget_ms, 0.0f);
+    json_fetch_int_with_default(parent, "input_scale_levels", &input_scale_levels, 3);
+    int tmp_letterbox_input;
+    json_fetch_bool_with_default(parent, "letterbox_input", &tmp_letterbox_input, 0);
+    letterbox_input = tmp_letterbox_input;
+    int tmp_input_undistort;
+    json_fetch_bool_with_default(parent, "input_undistort", &tmp_input_undistort, 0);
+    input_undistort = tmp_input_undistort;
+    json_fetch_int_with_default(parent, "input_rotation", &input_rotation, 0);
+    if (input_rotation != 0 && input_rotation != 90 && input_rotation != 180 && input_rotation != 270)
+    {
+        fprintf(stderr, "WARNING: input_rotation must be 0, 90, 180 or 270, using 0\n");
+        input_rotation = 0;
+    }
+    int tmp_input_flip;
+    json_fetch_bool_with_default(parent, "input_flip", &tmp_input_flip, 0);
+    input_flip = tmp_input_flip;
+    json_fetch_string_with_default(parent, "stereo_mode", stereo_mode, CHAR_BUF_SIZE, "left");
+    int tmp_stereo_triangulate;
+    json_fetch_bool_with_default(parent, "stereo_triangulate", &tmp_stereo_triangulate, 0);
+    stereo_triangulate = tmp_stereo_triangulate;
 
     int requires_labels = 0;
     json_fetch_bool_with_default(parent, "requires_labels", &requires_labels, 1);
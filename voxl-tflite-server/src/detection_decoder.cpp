@@ -0,0 +1,207 @@
+#include "detection_decoder.h"
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+
+// yolov5 grid strides and anchors per grid cell
+static const int32_t yolov5_grid_scales[3] = {8, 16, 32};
+#define YOLOV5_GRID_CHANNEL 3
+
+// the yolo decoders scale normalized boxes by the transform's size, this
+// adds its origin to the ones they just appended
+static void offset_candidates(std::vector<detection_candidate_t> &out, size_t first,
+                              const resize_transform_t &t)
+{
+    const int32_t dx = (int32_t)lroundf(t.x);
+    const int32_t dy = (int32_t)lroundf(t.y);
+    if (dx == 0 && dy == 0)
+        return;
+    for (size_t i = first; i < out.size(); i++)
+    {
+        out[i].x += dx;
+        out[i].y += dy;
+    }
+}
+
+void YoloV5Layout::decode(tflite::Interpreter *interpreter, const detector_dims_t &dims,
+                          std::vector<detection_candidate_t> &out)
+{
+    // yolo has just one fat float output tensor
+    TfLiteTensor *output = interpreter->tensor(interpreter->outputs()[0]);
+    const float *data = TensorData<float>(output, 0);
+
+    // every grid scale is laid out back to back with the same anchor format
+    int num_anchors = 0;
+    for (const auto &scale : yolov5_grid_scales)
+        num_anchors += (dims.model_width / scale) * (dims.model_height / scale) *
+                       YOLOV5_GRID_CHANNEL;
+
+    const size_t first = out.size();
+    yolov5_decode(data, num_anchors, dims.num_classes, box_threshold, class_threshold,
+                  dims.t.w, dims.t.h, out);
+    offset_candidates(out, first, dims.t);
+}
+
+void YoloV8Layout::decode(tflite::Interpreter *interpreter, const detector_dims_t &dims,
+                          std::vector<detection_candidate_t> &out)
+{
+    int output_index = interpreter->outputs()[0];
+    TfLiteTensor *output = interpreter->tensor(output_index);
+    const int channels = output->dims->data[1];
+    const int anchors = output->dims->data[2];
+
+    // decode straight from the channel-major [4 + classes][anchors] layout
+    const size_t first = out.size();
+    yolov8_decode(interpreter->typed_tensor<float>(output_index), anchors, channels - 4,
+                  dims.num_classes, score_threshold, dims.t.w, dims.t.h, out);
+    offset_candidates(out, first, dims.t);
+}
+
+void SsdLayout::decode(tflite::Interpreter *interpreter, const detector_dims_t &dims,
+                       std::vector<detection_candidate_t> &out)
+{
+    // https://www.tensorflow.org/lite/models/object_detection/overview#starter_model
+    const float *locations = TensorData<float>(interpreter->tensor(interpreter->outputs()[0]), 0);
+    const float *classes = TensorData<float>(interpreter->tensor(interpreter->outputs()[1]), 0);
+    const float *scores = TensorData<float>(interpreter->tensor(interpreter->outputs()[2]), 0);
+    const int count = (int)(*TensorData<float>(interpreter->tensor(interpreter->outputs()[3]), 0));
+
+    for (int i = 0; i < count; i++)
+    {
+        if (scores[i] <= score_threshold)
+            continue;
+
+        // scale bboxes back to input resolution
+        const int top = dims.t.y + locations[4 * i + 0] * dims.t.h;
+        const int left = dims.t.x + locations[4 * i + 1] * dims.t.w;
+        const int bottom = dims.t.y + locations[4 * i + 2] * dims.t.h;
+        const int right = dims.t.x + locations[4 * i + 3] * dims.t.w;
+
+        out.push_back({(int32_t)classes[i], scores[i], -1.0f,
+                       left, top, right - left, bottom - top});
+    }
+}
+
+void DetectionEmitter::set_labels(const std::vector<std::string> &labels,
+                                  size_t label_count)
+{
+    names.assign(label_count, std::array<char, BUF_LEN>());
+
+    for (size_t i = 0; i < label_count && i < labels.size(); i++)
+    {
+        const std::string &label = labels[i];
+        size_t start = 0;
+
+        // skip a leading "<index>" column if the labels file has one
+        while (start < label.size() && isdigit((unsigned char)label[start]))
+            start++;
+        if (start == 0 || start == label.size() || !isspace((unsigned char)label[start]))
+            start = 0;
+
+        size_t n = 0;
+        for (size_t c = start; c < label.size() && n < BUF_LEN - 1; c++)
+            if (!isspace((unsigned char)label[c]))
+                names[i][n++] = label[c];
+        names[i][n] = '\0';
+    }
+}
+
+void DetectionEmitter::set_cam(const std::string &cam_name)
+{
+    cam.fill('\0');
+    strncpy(cam.data(), cam_name.c_str(), BUF_LEN - 1);
+}
+
+const char *DetectionEmitter::label(int32_t class_id)
+{
+    if (class_id < 0 || class_id >= (int32_t)names.size())
+        return unknown_name.data();
+    return names[class_id].data();
+}
+
+void DetectionEmitter::emit(const std::vector<detection_candidate_t> &candidates,
+                            const std::vector<int> &keep, NmsEngine &nms,
+                            int32_t frame_id, int64_t timestamp_ns)
+{
+    num_detections = (int)keep.size();
+    if (detections.size() < keep.size())
+        detections.resize(keep.size());
+
+    for (int i = 0; i < num_detections; i++)
+    {
+        const int idx = keep[i];
+        const detection_candidate_t &c = candidates[idx];
+        ai_detection_t &d = detections[i];
+
+        d.magic_number = AI_DETECTION_MAGIC_NUMBER;
+        d.timestamp_ns = timestamp_ns;
+        d.class_id = c.class_id;
+        d.frame_id = frame_id;
+        memcpy(d.class_name, label(c.class_id), BUF_LEN);
+        memcpy(d.cam, cam.data(), BUF_LEN);
+
+        // nms may have decayed the score (soft-nms)
+        d.class_confidence = nms.get_score(idx);
+        d.detection_confidence = c.box_conf;
+        d.x_min = c.x;
+        d.y_min = c.y;
+        d.x_max = c.x + c.w;
+        d.y_max = c.y + c.h;
+    }
+}
+
+void DetectionEmitter::emit_tracks(const std::vector<track_t> &tracks, int32_t frame_id,
+                                   int64_t timestamp_ns, int64_t frame_timestamp_ns)
+{
+    num_detections = num_tracks = (int)tracks.size();
+    if (detections.size() < tracks.size())
+        detections.resize(tracks.size());
+    if (track_msgs.size() < tracks.size())
+        track_msgs.resize(tracks.size());
+
+    for (int i = 0; i < num_tracks; i++)
+    {
+        const track_t &t = tracks[i];
+        ai_detection_t &d = detections[i];
+        ai_track_t &m = track_msgs[i];
+
+        d.magic_number = AI_DETECTION_MAGIC_NUMBER;
+        d.timestamp_ns = timestamp_ns;
+        d.class_id = t.class_id;
+        d.frame_id = frame_id;
+        memcpy(d.class_name, label(t.class_id), BUF_LEN);
+        memcpy(d.cam, cam.data(), BUF_LEN);
+        d.class_confidence = t.confidence;
+        d.detection_confidence = -1;
+        d.x_min = t.x_min();
+        d.y_min = t.y_min();
+        d.x_max = t.x_max();
+        d.y_max = t.y_max();
+
+        m.magic_number = AI_TRACK_MAGIC_NUMBER;
+        m.timestamp_ns = frame_timestamp_ns;
+        m.frame_id = frame_id;
+        m.track_id = t.id;
+        m.class_id = t.class_id;
+        m.age_frames = t.age;
+        m.source = t.propagated ? AI_TRACK_PROPAGATED : AI_TRACK_DETECTED;
+        memset(m.reserved, 0, sizeof(m.reserved));
+        memcpy(m.class_name, d.class_name, BUF_LEN);
+        memcpy(m.cam, d.cam, BUF_LEN);
+        m.confidence = t.confidence;
+        m.x_min = d.x_min;
+        m.y_min = d.y_min;
+        m.x_max = d.x_max;
+        m.y_max = d.y_max;
+        m.vx = t.cx.v;
+        m.vy = t.cy.v;
+    }
+}
+
+void DetectionEmitter::restamp(int64_t timestamp_ns, int64_t frame_timestamp_ns)
+{
+    for (int i = 0; i < num_detections; i++)
+        detections[i].timestamp_ns = timestamp_ns;
+    for (int i = 0; i < num_tracks; i++)
+        track_msgs[i].timestamp_ns = frame_timestamp_ns;
+}
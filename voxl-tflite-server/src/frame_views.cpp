@@ -0,0 +1,279 @@
+#include "frame_views.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// evenly spread start positions of n tiles of size t over length len
+static int tile_start(int i, int n, int len, int t)
+{
+    return n > 1 ? (int)lroundf((float)i * (len - t) / (n - 1)) : 0;
+}
+
+TilePlanner::~TilePlanner()
+{
+    release();
+}
+
+void TilePlanner::release()
+{
+    for (tile_t &t : tiles)
+        free(t.map.L);
+    tiles.clear();
+}
+
+bool TilePlanner::init(int input_width, int input_height, int model_width, int model_height,
+                       float overlap)
+{
+    release();
+
+    if (input_width <= model_width && input_height <= model_height)
+        return false;
+
+    // tiles are model sized at native resolution, overlapping by at least
+    // overlap so an object cut by one tile edge is whole in its neighbour
+    const int tw = std::min(model_width, input_width);
+    const int th = std::min(model_height, input_height);
+    const float keep = 1.0f - std::min(std::max(overlap, 0.0f), 0.9f);
+    const int cols = input_width > tw ? (int)ceilf((input_width - tw) / (tw * keep)) + 1 : 1;
+    const int rows = input_height > th ? (int)ceilf((input_height - th) / (th * keep)) + 1 : 1;
+
+    if (cols * rows > TILE_MAX)
+    {
+        fprintf(stderr, "ERROR: %dx%d frame needs %d tiles of %dx%d, max is %d\n",
+                input_width, input_height, cols * rows, tw, th, TILE_MAX);
+        return false;
+    }
+
+    tiles.resize(cols * rows);
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < cols; c++)
+        {
+            tile_t &t = tiles[r * cols + c];
+            t.x = tile_start(c, cols, input_width, tw);
+            t.y = tile_start(r, rows, input_height, th);
+            t.w = tw;
+            t.h = th;
+
+            t.cx0 = t.x * SCENE_THUMB_W / input_width;
+            t.cy0 = t.y * SCENE_THUMB_H / input_height;
+            t.cx1 = std::min(SCENE_THUMB_W, ((t.x + tw) * SCENE_THUMB_W + input_width - 1) / input_width);
+            t.cy1 = std::min(SCENE_THUMB_H, ((t.y + th) * SCENE_THUMB_H + input_height - 1) / input_height);
+
+            t.frames_since_run = 0;
+            t.has_reference = false;
+            occupied[r * cols + c] = false;
+
+            if (mcv_init_crop_resize_map(input_width, input_height, t.x, t.y, tw, th,
+                                         model_width, model_height, &t.map))
+            {
+                release();
+                return false;
+            }
+        }
+    }
+
+    printf("Tiling %dx%d frames into %d %dx%d tiles (%d x %d)\n",
+           input_width, input_height, cols * rows, tw, th, cols, rows);
+    return true;
+}
+
+bool TilePlanner::moved(const tile_t &t, const uint8_t *thumb)
+{
+    if (!t.has_reference)
+        return true;
+
+    for (int y = t.cy0; y < t.cy1; y++)
+    {
+        for (int x = t.cx0; x < t.cx1; x++)
+        {
+            const int i = y * SCENE_THUMB_W + x;
+            if (abs(thumb[i] - t.reference[i]) >= TILE_MOTION_THRESHOLD)
+                return true;
+        }
+    }
+    return false;
+}
+
+void TilePlanner::select(const uint8_t *thumb, int refresh_frames, frame_views_t &views)
+{
+    for (size_t i = 0; i < tiles.size(); i++)
+    {
+        tile_t &t = tiles[i];
+        t.frames_since_run++;
+
+        const bool run = thumb == nullptr || refresh_frames <= 0 ||
+                         t.frames_since_run >= refresh_frames ||
+                         occupied[i] || moved(t, thumb);
+        if (!run)
+            continue;
+
+        t.frames_since_run = 0;
+        if (thumb != nullptr)
+        {
+            memcpy(t.reference, thumb, SCENE_THUMB_SIZE);
+            t.has_reference = true;
+        }
+        views.push_back({(int)i, t.x, t.y, t.w, t.h, t.map.T, 0});
+    }
+}
+
+int roi_mode_from_string(const char *str, RoiMode *mode)
+{
+    if (!strcmp(str, "off"))
+        *mode = ROI_OFF;
+    else if (!strcmp(str, "static"))
+        *mode = ROI_STATIC;
+    else if (!strcmp(str, "follow"))
+        *mode = ROI_FOLLOW;
+    else
+        return -1;
+
+    return 0;
+}
+
+RoiWindow::~RoiWindow()
+{
+    free(map.L);
+}
+
+void RoiWindow::init(RoiMode _mode, int input_width, int input_height, int model_width,
+                     int model_height, const float window[4], float _margin, float _smoothing,
+                     int _full_frame_interval)
+{
+    mode = _mode;
+    input_w = input_width;
+    input_h = input_height;
+    model_w = model_width;
+    model_h = model_height;
+    margin = std::max(_margin, 0.0f);
+    smoothing = std::min(std::max(_smoothing, 0.0f), 0.95f);
+    full_frame_interval = _full_frame_interval;
+    frames_since_full = 0;
+
+    // re-initialized when the model input size changes, the old crop's map
+    // is the wrong size
+    free(map.L);
+    map = {};
+    crop = {};
+
+    if (mode == ROI_STATIC)
+    {
+        frame_view_t v = {};
+        v.tile = -1;
+        v.x = std::min(std::max((int)(window[0] * input_w), 0), input_w - 2);
+        v.y = std::min(std::max((int)(window[1] * input_h), 0), input_h - 2);
+        v.w = std::min(std::max((int)(window[2] * input_w), 2), input_w - v.x);
+        v.h = std::min(std::max((int)(window[3] * input_h), 2), input_h - v.y);
+        if (!set_crop(v))
+            mode = ROI_OFF;
+        else
+            printf("Static roi %dx%d at (%d,%d)\n", v.w, v.h, v.x, v.y);
+    }
+}
+
+void RoiWindow::set_target(bool found, float x_min, float y_min, float x_max, float y_max)
+{
+    if (mode != ROI_FOLLOW)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!found)
+    {
+        has_target = false;
+        return;
+    }
+
+    const float ncx = 0.5f * (x_min + x_max);
+    const float ncy = 0.5f * (y_min + y_max);
+    const float nw = x_max - x_min;
+    const float nh = y_max - y_min;
+
+    // a new target snaps, a known one moves smoothly
+    const float s = has_target ? smoothing : 0.0f;
+    cx = s * cx + (1.0f - s) * ncx;
+    cy = s * cy + (1.0f - s) * ncy;
+    w = s * w + (1.0f - s) * nw;
+    h = s * h + (1.0f - s) * nh;
+    has_target = true;
+}
+
+bool RoiWindow::window_for_target(frame_view_t &view)
+{
+    float tcx, tcy, tw, th;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!has_target)
+            return false;
+        tcx = cx;
+        tcy = cy;
+        tw = w * (1.0f + 2.0f * margin);
+        th = h * (1.0f + 2.0f * margin);
+    }
+
+    // model aspect ratio so the crop isn't stretched, at least model sized
+    const float aspect = (float)model_w / model_h;
+    if (tw < th * aspect)
+        tw = th * aspect;
+    tw = std::max(tw, (float)model_w);
+
+    int cw = ((int)ceilf(tw) + ROI_SIZE_STEP - 1) / ROI_SIZE_STEP * ROI_SIZE_STEP;
+    int ch = (int)lroundf(cw / aspect);
+    if (cw >= input_w || ch >= input_h)
+        return false;
+
+    view.tile = -1;
+    view.w = cw;
+    view.h = ch;
+    view.x = std::min(std::max((int)lroundf(tcx - 0.5f * cw), 0), input_w - cw);
+    view.y = std::min(std::max((int)lroundf(tcy - 0.5f * ch), 0), input_h - ch);
+    return true;
+}
+
+bool RoiWindow::set_crop(const frame_view_t &view)
+{
+    if (map.L != nullptr && view.w == crop.w && view.h == crop.h)
+    {
+        mcv_shift_resize_map(&map, view.x - crop.x, view.y - crop.y);
+        crop = view;
+        return true;
+    }
+
+    free(map.L);
+    map.L = nullptr;
+    if (mcv_init_crop_resize_map(input_w, input_h, view.x, view.y, view.w, view.h,
+                                 model_w, model_h, &map))
+        return false;
+    crop = view;
+    return true;
+}
+
+undistort_map_t *RoiWindow::next(frame_view_t &view)
+{
+    if (mode == ROI_STATIC)
+    {
+        view = crop;
+        view.t = map.T;
+        return &map;
+    }
+    if (mode != ROI_FOLLOW)
+        return nullptr;
+
+    // periodic full frame pass to pick up anything outside the window
+    if (++frames_since_full >= full_frame_interval && full_frame_interval > 0)
+    {
+        frames_since_full = 0;
+        return nullptr;
+    }
+
+    if (!window_for_target(view) || !set_crop(view))
+    {
+        frames_since_full = 0;
+        return nullptr;
+    }
+
+    view.t = map.T;
+    return &map;
+}
@@ -0,0 +1,150 @@
+#include "gate_estimator.h"
+#include <math.h>
+#include <string.h>
+
+static float wrap_pi(float a)
+{
+    while (a > (float)M_PI)
+        a -= 2.0f * (float)M_PI;
+    while (a < -(float)M_PI)
+        a += 2.0f * (float)M_PI;
+    return a;
+}
+
+void GateEstimator::predict_to(int64_t timestamp_ns)
+{
+    if (timestamp_ns <= filter_time_ns)
+        return;
+
+    const float dt = (timestamp_ns - filter_time_ns) * 1e-9f;
+    axes[X].predict(dt, GATE_EST_XYZ_ACCEL_NOISE);
+    axes[Y].predict(dt, GATE_EST_XYZ_ACCEL_NOISE);
+    axes[Z].predict(dt, GATE_EST_XYZ_ACCEL_NOISE);
+    axes[YAW].predict(dt, GATE_EST_YAW_ACCEL_NOISE);
+    axes[YAW].p = wrap_pi(axes[YAW].p);
+    filter_time_ns = timestamp_ns;
+}
+
+bool GateEstimator::update_xyz(const gate_state_t &state)
+{
+    const float r = GATE_EST_XYZ_SIGMA * GATE_EST_XYZ_SIGMA;
+    const float z[3] = {state.x, state.y, state.z};
+
+    if (!(initialized & GATE_STATE_HAS_XYZ) || xyz_rejects >= GATE_EST_MAX_REJECTS)
+    {
+        for (int i = X; i <= Z; i++)
+            axes[i].init(z[i], r);
+        initialized |= GATE_STATE_HAS_XYZ;
+        xyz_rejects = 0;
+        xyz_fix_ns = state.timestamp_ns;
+        return true;
+    }
+
+    // the axes are independent so the joint nis is a plain sum
+    float y[3];
+    float nis = 0.0f;
+    for (int i = X; i <= Z; i++)
+    {
+        y[i] = z[i] - axes[i].p;
+        nis += y[i] * y[i] / axes[i].innovation_var(r);
+    }
+    if (nis > GATE_EST_XYZ_GATE)
+    {
+        xyz_rejects++;
+        return false;
+    }
+
+    for (int i = X; i <= Z; i++)
+        axes[i].correct(y[i], r);
+    xyz_rejects = 0;
+    xyz_fix_ns = state.timestamp_ns;
+    return true;
+}
+
+bool GateEstimator::update_yaw(const gate_state_t &state)
+{
+    const float r = GATE_EST_YAW_SIGMA * GATE_EST_YAW_SIGMA;
+    KalmanAxis &a = axes[YAW];
+
+    if (!(initialized & GATE_STATE_HAS_YAW) || yaw_rejects >= GATE_EST_MAX_REJECTS)
+    {
+        a.init(wrap_pi(state.yaw), r);
+        initialized |= GATE_STATE_HAS_YAW;
+        yaw_rejects = 0;
+        yaw_fix_ns = state.timestamp_ns;
+        return true;
+    }
+
+    const float y = wrap_pi(state.yaw - a.p);
+    if (y * y / a.innovation_var(r) > GATE_EST_YAW_GATE)
+    {
+        yaw_rejects++;
+        return false;
+    }
+
+    a.correct(y, r);
+    a.p = wrap_pi(a.p);
+    yaw_rejects = 0;
+    yaw_fix_ns = state.timestamp_ns;
+    return true;
+}
+
+bool GateEstimator::update(const gate_state_t &state)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // frames arrive in order from one camera, anything older is stale
+    if (initialized && state.timestamp_ns < filter_time_ns)
+        return false;
+
+    if (!initialized)
+        filter_time_ns = state.timestamp_ns;
+    predict_to(state.timestamp_ns);
+    last_frame_id = state.frame_id;
+
+    bool ok = true;
+    if (state.valid_fields & GATE_STATE_HAS_XYZ)
+        ok &= update_xyz(state);
+    if (state.valid_fields & GATE_STATE_HAS_YAW)
+        ok &= update_yaw(state);
+    return ok;
+}
+
+bool GateEstimator::predict(int64_t timestamp_ns, gate_state_t &out)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint16_t fresh = 0;
+    if ((initialized & GATE_STATE_HAS_XYZ) && timestamp_ns - xyz_fix_ns < GATE_EST_MAX_AGE_NS)
+        fresh |= GATE_STATE_HAS_XYZ;
+    if ((initialized & GATE_STATE_HAS_YAW) && timestamp_ns - yaw_fix_ns < GATE_EST_MAX_AGE_NS)
+        fresh |= GATE_STATE_HAS_YAW;
+    if (!fresh)
+        return false;
+
+    // extrapolate a copy, the filter itself only moves on measurements
+    const float dt = timestamp_ns > filter_time_ns ? (timestamp_ns - filter_time_ns) * 1e-9f : 0.0f;
+
+    memset(&out, 0, sizeof(out));
+    out.magic_number = GATE_STATE_MAGIC_NUMBER;
+    out.version = GATE_STATE_VERSION;
+    out.timestamp_ns = timestamp_ns;
+    out.frame_id = last_frame_id;
+    out.valid_fields = fresh | GATE_STATE_HAS_VELOCITY | GATE_STATE_PREDICTED;
+
+    if (fresh & GATE_STATE_HAS_XYZ)
+    {
+        out.x = axes[X].p + axes[X].v * dt;
+        out.y = axes[Y].p + axes[Y].v * dt;
+        out.z = axes[Z].p + axes[Z].v * dt;
+        out.vx = axes[X].v;
+        out.vy = axes[Y].v;
+        out.vz = axes[Z].v;
+    }
+    if (fresh & GATE_STATE_HAS_YAW)
+    {
+        out.yaw = wrap_pi(axes[YAW].p + axes[YAW].v * dt);
+        out.yaw_rate = axes[YAW].v;
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+#include "image_publisher.h"
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// lowest priority for the encoder thread, it only ever competes with itself
+#define PUBLISHER_NICE 19
+
+ImagePublisher::ImagePublisher(int channel, int out_width, bool en_jpeg,
+                               int jpeg_quality)
+    : channel(channel), out_width(out_width), en_jpeg(en_jpeg),
+      jpeg_quality(jpeg_quality)
+{
+    thread = std::thread(&ImagePublisher::run, this);
+}
+
+ImagePublisher::~ImagePublisher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cond.notify_all();
+    thread.join();
+    free(map.L);
+}
+
+void ImagePublisher::publish(const camera_image_metadata_t &meta,
+                             const cv::Mat &image)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending)
+        num_dropped++;
+
+    // images allocated by opencv are reference counted so handing them over
+    // is free, anything wrapping a buffer we reuse (camera queue, resize
+    // output) has to be copied before the next frame overwrites it
+    pending_image = image.u ? image : image.clone();
+    pending_meta = meta;
+    pending = true;
+    cond.notify_one();
+}
+
+void ImagePublisher::run()
+{
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), PUBLISHER_NICE);
+
+    while (true)
+    {
+        camera_image_metadata_t meta;
+        cv::Mat image;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]
+                      { return pending || !running; });
+            if (!running)
+                break;
+            meta = pending_meta;
+            image = pending_image;
+            pending_image.release();
+            pending = false;
+        }
+        write_frame(meta, image);
+    }
+}
+
+void ImagePublisher::write_frame(camera_image_metadata_t meta,
+                                 const cv::Mat &image)
+{
+    const int channels = (meta.format == IMAGE_FORMAT_RAW8) ? 1 : 3;
+    const cv::Mat *out = &image;
+
+    // downscale with the same lookup table resize used for model inputs
+    if (out_width > 0 && out_width < meta.width)
+    {
+        // keep the aspect ratio and an even height
+        int out_height = ((meta.height * out_width / meta.width) + 1) & ~1;
+
+        if (map.L == nullptr || map.w_in != meta.width || map.h_in != meta.height ||
+            map.h_out != out_height)
+        {
+            free(map.L);
+            map.L = nullptr;
+            if (mcv_init_resize_map(meta.width, meta.height, out_width,
+                                    out_height, &map))
+                return;
+        }
+
+        scaled.create(out_height, out_width, channels == 1 ? CV_8UC1 : CV_8UC3);
+        if (channels == 1)
+            mcv_resize_image(image.data, scaled.data, &map);
+        else
+            mcv_resize_8uc3_image(image.data, scaled.data, &map);
+
+        out = &scaled;
+        meta.width = out_width;
+        meta.height = out_height;
+        meta.stride = out_width * channels;
+        meta.size_bytes = out_width * out_height * channels;
+    }
+
+    if (!en_jpeg)
+    {
+        pipe_server_write_camera_frame(channel, meta, out->data);
+        return;
+    }
+
+    // imencode expects bgr channel order
+    const cv::Mat *enc = out;
+    if (channels == 3)
+    {
+        cv::cvtColor(*out, bgr, cv::COLOR_RGB2BGR);
+        enc = &bgr;
+    }
+
+    std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, jpeg_quality};
+    if (!cv::imencode(".jpg", *enc, jpeg_buf, params))
+    {
+        fprintf(stderr, "ERROR: failed to jpeg encode output image\n");
+        return;
+    }
+
+    meta.format = IMAGE_FORMAT_JPG;
+    meta.size_bytes = jpeg_buf.size();
+    pipe_server_write_camera_frame(channel, meta, jpeg_buf.data());
+}
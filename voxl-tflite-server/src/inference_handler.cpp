@@ -1,6 +1,8 @@
 #include "inference_handler.h"
 #include <chrono>
 #include <atomic>
+#include <map>
+#include <set>
 
 // Global variables to track frames and timing
 static std::atomic<int> frames_processed{0};
@@ -9,11 +11,25 @@ static std::chrono::time_point<std::chrono::high_resolution_clock> pipeline_star
 // the preprocess step is around 3.2x faster (as tested on yolov8)
 // and therefore the queue is only be of about length 4
 static std::queue<std::shared_ptr<PipelineData>> preprocess_inference_queue; // queue to handle the output of the preprocess step
-static std::queue<std::shared_ptr<PipelineData>> inference_postprocess_queue;
 
-static std::mutex preprocess_inference_mutex, inference_postprocess_mutex, postprocess_mutex;
+// an inference thread per pool interpreter. Frames come out of them in the
+// order they finish, the reorder buffer holds each one until no older frame
+// is still being invoked so postprocess publishes in dispatch order. A slot
+// takes its next frame once postprocess is done with its outputs
+static std::map<uint64_t, std::shared_ptr<PipelineData>> reorder_buffer;
+static std::set<uint64_t> frames_invoking;
+static std::vector<bool> slot_outputs_pending;
+static uint64_t next_seq = 0; // preprocess thread only
+
+static std::mutex preprocess_inference_mutex, inference_postprocess_mutex;
 static std::condition_variable preprocess_inference_cond, inference_postprocess_cond, postprocess_cond;
-bool postprocess_finish = false;
+
+// guarded by inference_postprocess_mutex
+static bool next_in_order()
+{
+    return !reorder_buffer.empty() &&
+           (frames_invoking.empty() || reorder_buffer.begin()->first < *frames_invoking.begin());
+}
 
 static inline void set_core_affinity()
 {
@@ -49,13 +65,27 @@ void *run_inference_pipeline(void *args)
 
     pipeline_start_time = std::chrono::high_resolution_clock::now();
 
-    std::thread preprocess_thread(preprocess_worker, worker_args->model_helper);
-    std::thread inference_thread(inference_worker, worker_args->model_helper);
-    std::thread postprocess_thread(postprocess_worker, worker_args->model_helper);
+    // the extra cameras share the first one's pool
+    const int slots = worker_args->scheduler->get_streams()[0]->helper->pool_slots();
+    slot_outputs_pending.assign(slots, false);
+
+    std::thread preprocess_thread(preprocess_worker, worker_args->scheduler);
+    std::vector<std::thread> inference_threads;
+    for (int i = 0; i < slots; i++)
+    {
+        // cpu interpreters don't compete for the accelerator
+        InvokeArbiter *arbiter = worker_args->arbiter;
+        int client = -1;
+        if (arbiter != nullptr && worker_args->scheduler->get_streams()[0]->helper->slot_on_accelerator(i))
+            client = arbiter->attach(i);
+        inference_threads.emplace_back(inference_worker, i, arbiter, client);
+    }
+    std::thread postprocess_thread(postprocess_worker);
 
     // Wait for threads to finish or handle cleanup
     preprocess_thread.join();
-    inference_thread.join();
+    for (std::thread &t : inference_threads)
+        t.join();
     postprocess_thread.join();
 
     return nullptr;
@@ -66,43 +96,79 @@ void *run_inference_pipeline(void *args)
     the inference queue for the inference_postprocess worker to deal with
     */
 }
-void preprocess_worker(ModelHelper *model_helper)
+void preprocess_worker(CameraScheduler *scheduler)
 {
 
 #ifdef BUILD_QRB5165
     set_core_affinity();
 #endif
 
-    int queue_index = 0;
-
     while (main_running)
     {
         // this is the only place where the camera queue data is extracted
-        // the queue is populated by the camera helper function meanwhile
-        if (queue_index == model_helper->camera_queue.insert_idx)
+        // the queues are populated by the camera helper function meanwhile,
+        // the scheduler picks which camera goes next
+        int queue_index = 0;
+        CameraStream *stream = scheduler->next(&queue_index);
+        if (stream == nullptr || !main_running) {
+            break; // Exit if main loop has stopped
+        }
+        ModelHelper *model_helper = stream->helper;
+
+        // a resize map built for a new stream geometry goes in between frames
+        model_helper->install_input_state();
+
+        std::shared_lock<std::shared_timed_mutex> lifecycle_lock(model_helper->lifecycle_mutex);
+
+        // the queue was released while idle, anything left in it is gone
+        if (model_helper->camera_queue.queue == nullptr)
         {
-            std::unique_lock<std::mutex> lock(model_helper->cond_mutex);
-            model_helper->cond_var.wait(lock);
+            model_helper->camera_queue.release();
             continue;
         }
-        
-        // grab the frame and bump our queue index, making sure its within queue
-        // size
+
+        // grab the frame the scheduler picked
         TFLiteMessage *new_frame = &model_helper->camera_queue.queue[queue_index];
-        queue_index = ((queue_index + 1) % QUEUE_SIZE);
 
+        // left null when the overlay won't be published for this frame
+        std::shared_ptr<cv::Mat> output_image;
+        if (model_helper->should_render_output(new_frame->metadata))
+            output_image = std::make_shared<cv::Mat>();
 
-        if (!main_running) {
-            break; // Exit if main loop has stopped
+        // frames that look like the last inferred one skip the whole pipeline
+        // and just have its results republished, unless an overlay is due
+        if (new_frame->has_thumbnail)
+        {
+            if (!output_image && model_helper->can_republish() &&
+                model_helper->scene_gate.unchanged(new_frame->thumbnail, new_frame->metadata.timestamp_ns))
+            {
+                lifecycle_lock.unlock();
+
+                std::lock_guard<std::mutex> inference_lock(preprocess_inference_mutex);
+                auto pipeline_data = std::make_shared<PipelineData>();
+                pipeline_data->helper = model_helper;
+                pipeline_data->seq = next_seq++;
+                pipeline_data->metadata = new_frame->metadata;
+                pipeline_data->unchanged = true;
+                preprocess_inference_queue.push(pipeline_data);
+                preprocess_inference_cond.notify_one();
+                model_helper->camera_queue.release();
+                continue;
+            }
+            model_helper->scene_gate.set_reference(new_frame->thumbnail, new_frame->metadata.timestamp_ns);
         }
 
-        auto output_image = std::make_shared<cv::Mat>();
-
-        // points to the same resize_output memory buffer created in the 
-        // preprocess method
+        // owns its memory, frames waiting for a pool slot or for their turn
+        // in the reorder buffer outlive the next preprocess
         auto preprocessed_image = std::make_shared<cv::Mat>();
 
-        if (!model_helper->preprocess(new_frame->metadata, (char *)new_frame->image_pixels, preprocessed_image, output_image)) {
+        model_helper->preprocess_views.reset();
+        bool preprocessed = model_helper->preprocess(new_frame->metadata, (char *)new_frame->image_pixels, preprocessed_image, output_image);
+        const int input_generation = model_helper->input_generation;
+        lifecycle_lock.unlock();
+
+        if (!preprocessed) {
+            model_helper->camera_queue.release();
             continue;
         }
         else
@@ -110,23 +176,37 @@ void preprocess_worker(ModelHelper *model_helper)
             std::lock_guard<std::mutex> inference_lock(preprocess_inference_mutex);
 
             auto pipeline_data = std::make_shared<PipelineData>();
+            pipeline_data->helper = model_helper;
+            pipeline_data->seq = next_seq++;
             pipeline_data->preprocessed_image = preprocessed_image;
             pipeline_data->metadata = new_frame->metadata;
             pipeline_data->output_image = output_image;
+            pipeline_data->views = model_helper->preprocess_views;
+            pipeline_data->input_generation = input_generation;
             // last_inferenence_time is not initialized for now
 
             preprocess_inference_queue.push(pipeline_data);
             preprocess_inference_cond.notify_one();
         }
+        model_helper->camera_queue.release();
     }
+
+    // wake the other stages so they see main_running cleared
+    {
+        std::lock_guard<std::mutex> lock(preprocess_inference_mutex);
+        preprocess_inference_cond.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(inference_postprocess_mutex);
+    inference_postprocess_cond.notify_all();
+    postprocess_cond.notify_all();
 }
 
-void inference_worker(ModelHelper *model_helper)
+void inference_worker(int slot, InvokeArbiter *arbiter, int arbiter_client)
 {
+    double last_inference_time = 0;
 
     while (main_running)
     {
-        postprocess_finish = false;
         std::unique_lock<std::mutex> lock(preprocess_inference_mutex);
         preprocess_inference_cond.wait(lock, []
                                        { return !preprocess_inference_queue.empty() || !main_running; });
@@ -138,36 +218,82 @@ void inference_worker(ModelHelper *model_helper)
         pipeline_data = preprocess_inference_queue.front();
         preprocess_inference_queue.pop();
 
+        // registered before the queue is let go so postprocess can't get a
+        // newer frame ahead of this one
+        {
+            std::lock_guard<std::mutex> reorder_lock(inference_postprocess_mutex);
+            frames_invoking.insert(pipeline_data->seq);
+        }
         lock.unlock();
 
-        double last_inference_time = 0;
-
-        if (!model_helper->run_inference(*pipeline_data->preprocessed_image, &last_inference_time)) {
-            continue;
+        ModelHelper *model_helper = pipeline_data->helper;
+        pipeline_data->slot = slot;
+        std::shared_lock<std::shared_timed_mutex> lifecycle_lock(model_helper->lifecycle_mutex);
+        bool inferred = false;
+        if (pipeline_data->unchanged)
+            inferred = true;
+        // frames preprocessed before an input size switch are dropped
+        else if (!model_helper->resources_released &&
+                 pipeline_data->input_generation == model_helper->input_generation)
+        {
+            // frames the helper can handle without the network keep the
+            // timing of the last real inference for the overlay
+            pipeline_data->ran_inference = model_helper->needs_inference();
+            if (!pipeline_data->ran_inference)
+                inferred = true;
+            // the arbiter holds the invoke back for other models' earlier
+            // deadlines, a frame it sheds is dropped
+            else if (arbiter_client < 0 || arbiter->acquire(arbiter_client, pipeline_data->metadata.timestamp_ns))
+            {
+                if (model_helper->pool_slots() > 1)
+                    inferred = model_helper->run_inference_on(slot, *pipeline_data->preprocessed_image, &last_inference_time);
+                else
+                {
+                    model_helper->inference_views = pipeline_data->views;
+                    inferred = model_helper->run_inference(*pipeline_data->preprocessed_image, &last_inference_time);
+                }
+                if (arbiter_client >= 0)
+                    arbiter->release(arbiter_client, pipeline_data->metadata.timestamp_ns, last_inference_time);
+            }
         }
-        else
+        lifecycle_lock.unlock();
+
         {
-            pipeline_data->last_inference_time = last_inference_time;
-            std::lock_guard<std::mutex> inference_postprocess_lock(inference_postprocess_mutex);
-            inference_postprocess_queue.push(pipeline_data);
+            // a dropped frame can let a newer one through as well
+            std::lock_guard<std::mutex> reorder_lock(inference_postprocess_mutex);
+            frames_invoking.erase(pipeline_data->seq);
+            if (inferred)
+            {
+                pipeline_data->last_inference_time = last_inference_time;
+                reorder_buffer[pipeline_data->seq] = pipeline_data;
+                slot_outputs_pending[slot] = true;
+            }
             inference_postprocess_cond.notify_one();
         }
 
+        lock.lock();
         while (preprocess_inference_queue.size() > QUEUE_LIMIT) {
             preprocess_inference_queue.pop();
         }
+        lock.unlock();
 
-        while (inference_postprocess_queue.size() > QUEUE_LIMIT) {
-            inference_postprocess_queue.pop();
-        }
-
-        std::unique_lock<std::mutex> lock_postprocess(postprocess_mutex);
-        postprocess_cond.wait(lock_postprocess, []
-                                        { return postprocess_finish; });
+        // the outputs stay in the interpreter until postprocess is done
+        // with the frame
+        std::unique_lock<std::mutex> lock_postprocess(inference_postprocess_mutex);
+        postprocess_cond.wait(lock_postprocess, [slot]
+                              { return !slot_outputs_pending[slot] || !main_running; });
     }
 }
 
-void postprocess_worker(ModelHelper *model_helper)
+// postprocess is done with the frame, its slot can take the next one
+static void release_slot(int slot)
+{
+    std::lock_guard<std::mutex> lock(inference_postprocess_mutex);
+    slot_outputs_pending[slot] = false;
+    postprocess_cond.notify_all();
+}
+
+void postprocess_worker()
 {
 #ifdef BUILD_QRB5165
     set_core_affinity();
@@ -177,38 +303,70 @@ void postprocess_worker(ModelHelper *model_helper)
     {
         std::unique_lock<std::mutex> lock(inference_postprocess_mutex);
         inference_postprocess_cond.wait(lock, []
-                                        { return !inference_postprocess_queue.empty() || !main_running; });
+                                        { return next_in_order() || !main_running; });
         if (!main_running) {
             break;
         }
 
         std::shared_ptr<PipelineData> pipeline_data;
-        pipeline_data = inference_postprocess_queue.front();
-        inference_postprocess_queue.pop();
+        pipeline_data = reorder_buffer.begin()->second;
+        reorder_buffer.erase(reorder_buffer.begin());
 
         lock.unlock();
 
+        ModelHelper *model_helper = pipeline_data->helper;
+        if (pipeline_data->unchanged)
+        {
+            std::shared_lock<std::shared_timed_mutex> lifecycle_lock(model_helper->lifecycle_mutex);
+            if (!model_helper->resources_released)
+                model_helper->republish(pipeline_data->metadata);
+            lifecycle_lock.unlock();
+
+            release_slot(pipeline_data->slot);
+            continue;
+        }
+
         // set this field here to allow the deep lab post processer to use it
         model_helper->preprocessed_image = pipeline_data->preprocessed_image;
+        model_helper->render_output = pipeline_data->output_image != nullptr;
+        model_helper->ran_inference = pipeline_data->ran_inference;
         std::shared_ptr<cv::Mat> output_image = pipeline_data->output_image;
-        // sets up post processing and related operations
-        if (!model_helper->worker(*output_image, pipeline_data->last_inference_time, pipeline_data->metadata)) {
-            postprocess_finish = true;
-            postprocess_cond.notify_one();
+        if (!output_image)
+            output_image = std::make_shared<cv::Mat>();
+        // sets up post processing and related operations, decoding the
+        // outputs of the interpreter the frame ran on
+        std::shared_lock<std::shared_timed_mutex> lifecycle_lock(model_helper->lifecycle_mutex);
+        bool processed = false;
+        // a frame that waited out an input size switch in the reorder buffer
+        // would be mapped back through the new geometry, drop it
+        if (!model_helper->resources_released &&
+            pipeline_data->input_generation == model_helper->input_generation)
+        {
+            model_helper->select_interpreter(pipeline_data->slot);
+            processed = model_helper->worker(*output_image, pipeline_data->last_inference_time, pipeline_data->metadata);
+            model_helper->select_interpreter(0);
+        }
+        lifecycle_lock.unlock();
+
+        if (!processed) {
+            release_slot(pipeline_data->slot);
             continue;
         }
-        else
+
+        // the inference thread is waiting on us, so this is between frames
+        if (pipeline_data->ran_inference)
         {
-            frames_processed++;
-            if (frames_processed % 10 == 0)
-            {
-                auto now = std::chrono::high_resolution_clock::now();
-                double elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(now - pipeline_start_time).count();
-                double throughput = frames_processed / elapsed_seconds; // frames per second
-                std::cout << "Current pipeline throughput: " << throughput << " frames per second" << std::endl;
-            }
+            model_helper->adapt_input_size(pipeline_data->last_inference_time);
+        }
+
+        frames_processed++;
+        if (frames_processed % 10 == 0)
+        {
+            auto now = std::chrono::high_resolution_clock::now();
+            double elapsed_seconds = std::chrono::duration_cast<std::chrono::seconds>(now - pipeline_start_time).count();
+            double throughput = frames_processed / elapsed_seconds; // frames per second
+            std::cout << "Current pipeline throughput: " << throughput << " frames per second" << std::endl;
         }
-        postprocess_finish = true;
-        postprocess_cond.notify_one();
+        release_slot(pipeline_data->slot);
     }
 }
@@ -0,0 +1,298 @@
+#include "invoke_arbiter.h"
+#include "utils.h"
+#include <modal_start_stop.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+InvokeArbiter::~InvokeArbiter()
+{
+    if (shm == nullptr)
+        return;
+
+    lock();
+    for (int i : clients)
+    {
+        if (shm->holder == i)
+            shm->holder = -1;
+        memset(&shm->clients[i], 0, sizeof(arbiter_client_t));
+    }
+    pthread_cond_broadcast(&shm->cond);
+    pthread_mutex_unlock(&shm->mutex);
+
+    // the table stays for the other servers, stale entries get reaped
+    munmap(shm, sizeof(arbiter_shm_t));
+}
+
+bool InvokeArbiter::open(const char *_name, int _priority, float deadline_ms, bool _en_shed)
+{
+    strncpy(name, _name, ARBITER_NAME_LEN - 1);
+    priority = _priority;
+    deadline_ns = (int64_t)(deadline_ms * 1e6);
+    en_shed = _en_shed;
+
+    // the first server creates and initializes the table, the others wait
+    // for it to be marked ready
+    bool creator = true;
+    int fd = shm_open(ARBITER_SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd < 0 && errno == EEXIST)
+    {
+        creator = false;
+        fd = shm_open(ARBITER_SHM_NAME, O_RDWR, 0666);
+    }
+    if (fd < 0)
+    {
+        perror("ERROR: failed to open the invoke arbiter table");
+        return false;
+    }
+
+    int waited_ms = 0;
+    if (creator)
+    {
+        fchmod(fd, 0666); // not limited by our umask
+        if (ftruncate(fd, sizeof(arbiter_shm_t)))
+        {
+            perror("ERROR: failed to size the invoke arbiter table");
+            close(fd);
+            shm_unlink(ARBITER_SHM_NAME);
+            return false;
+        }
+    }
+    else
+    {
+        struct stat st = {};
+        while (fstat(fd, &st) == 0 && st.st_size < (off_t)sizeof(arbiter_shm_t) &&
+               waited_ms < ARBITER_OPEN_TIMEOUT_MS)
+        {
+            usleep(1000);
+            waited_ms++;
+        }
+        if (st.st_size < (off_t)sizeof(arbiter_shm_t))
+        {
+            fprintf(stderr, "ERROR: invoke arbiter table %s has the wrong size, remove it "
+                            "from /dev/shm if no server is running\n", ARBITER_SHM_NAME);
+            close(fd);
+            return false;
+        }
+    }
+
+    void *p = mmap(nullptr, sizeof(arbiter_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        perror("ERROR: failed to map the invoke arbiter table");
+        return false;
+    }
+    arbiter_shm_t *table = (arbiter_shm_t *)p;
+
+    if (creator)
+    {
+        // a holder that dies leaves the mutex to the next locker instead
+        // of deadlocking every server
+        pthread_mutexattr_t mutex_attr;
+        pthread_mutexattr_init(&mutex_attr);
+        pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&table->mutex, &mutex_attr);
+        pthread_mutexattr_destroy(&mutex_attr);
+
+        pthread_condattr_t cond_attr;
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&table->cond, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+
+        table->holder = -1;
+        table->size = sizeof(arbiter_shm_t);
+        __atomic_store_n(&table->magic, ARBITER_MAGIC, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        while (__atomic_load_n(&table->magic, __ATOMIC_ACQUIRE) != ARBITER_MAGIC &&
+               waited_ms < ARBITER_OPEN_TIMEOUT_MS)
+        {
+            usleep(1000);
+            waited_ms++;
+        }
+        if (table->magic != ARBITER_MAGIC || table->size != sizeof(arbiter_shm_t))
+        {
+            fprintf(stderr, "ERROR: invoke arbiter table %s isn't initialized or is from "
+                            "another version, remove it from /dev/shm if no server is running\n",
+                    ARBITER_SHM_NAME);
+            munmap(p, sizeof(arbiter_shm_t));
+            return false;
+        }
+    }
+
+    shm = table;
+    return true;
+}
+
+void InvokeArbiter::lock()
+{
+    // a process died holding the mutex, reap() cleans up its entries
+    if (pthread_mutex_lock(&shm->mutex) == EOWNERDEAD)
+        pthread_mutex_consistent(&shm->mutex);
+}
+
+void InvokeArbiter::wait()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_nsec += ARBITER_POLL_MS * 1000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    if (pthread_cond_timedwait(&shm->cond, &shm->mutex, &ts) == EOWNERDEAD)
+        pthread_mutex_consistent(&shm->mutex);
+}
+
+void InvokeArbiter::reap()
+{
+    for (int i = 0; i < ARBITER_MAX_CLIENTS; i++)
+    {
+        arbiter_client_t &c = shm->clients[i];
+        if (c.pid == 0 || kill(c.pid, 0) == 0 || errno != ESRCH)
+            continue;
+        if (shm->holder == i)
+            shm->holder = -1;
+        memset(&c, 0, sizeof(c));
+    }
+}
+
+int InvokeArbiter::attach(int slot)
+{
+    lock();
+    reap();
+    for (int i = 0; i < ARBITER_MAX_CLIENTS; i++)
+    {
+        arbiter_client_t &c = shm->clients[i];
+        if (c.pid != 0)
+            continue;
+
+        memset(&c, 0, sizeof(c));
+        c.pid = getpid();
+        c.slot = slot;
+        c.priority = priority;
+        strncpy(c.name, name, ARBITER_NAME_LEN - 1);
+        pthread_mutex_unlock(&shm->mutex);
+        clients.push_back(i);
+        return i;
+    }
+    pthread_mutex_unlock(&shm->mutex);
+
+    fprintf(stderr, "WARNING: invoke arbiter table is full, %s runs unarbitrated\n", name);
+    return -1;
+}
+
+bool InvokeArbiter::acquire(int client, int64_t timestamp_ns)
+{
+    const int64_t due = timestamp_ns + deadline_ns;
+
+    lock();
+    arbiter_client_t &me = shm->clients[client];
+    me.deadline_ns = due;
+
+    bool run = false;
+    while (main_running)
+    {
+        reap();
+
+        // the invokes that go before ours and whether anything of higher
+        // priority is competing
+        bool first = true;
+        bool outranked = false;
+        float ahead_ms = 0;
+        for (int i = 0; i < ARBITER_MAX_CLIENTS; i++)
+        {
+            const arbiter_client_t &c = shm->clients[i];
+            if (i == client || c.pid == 0 || c.deadline_ns == 0)
+                continue;
+            if (c.priority > me.priority)
+                outranked = true;
+            if (c.deadline_ns < due || (c.deadline_ns == due && c.priority > me.priority))
+            {
+                first = false;
+                ahead_ms += c.cost_ms;
+            }
+        }
+        if (shm->holder >= 0)
+        {
+            const arbiter_client_t &h = shm->clients[shm->holder];
+            if (h.priority > me.priority)
+                outranked = true;
+            ahead_ms += h.cost_ms;
+        }
+        else if (first)
+        {
+            shm->holder = client;
+            run = true;
+            break;
+        }
+
+        const int64_t finish = rc_nanos_monotonic_time() + (int64_t)((ahead_ms + me.cost_ms) * 1e6);
+        if (en_shed && outranked && finish > due)
+        {
+            me.shed++;
+            break;
+        }
+        wait();
+    }
+
+    // leaving the queue may put another waiter first
+    me.deadline_ns = 0;
+    pthread_cond_broadcast(&shm->cond);
+    pthread_mutex_unlock(&shm->mutex);
+    return run;
+}
+
+void InvokeArbiter::release(int client, int64_t timestamp_ns, double invoke_ms)
+{
+    lock();
+    arbiter_client_t &me = shm->clients[client];
+    if (shm->holder == client)
+        shm->holder = -1;
+
+    if (me.invokes == 0)
+        me.cost_ms = (float)invoke_ms;
+    else
+        me.cost_ms += ARBITER_COST_ALPHA * ((float)invoke_ms - me.cost_ms);
+    me.invokes++;
+    if ((int64_t)rc_nanos_monotonic_time() > timestamp_ns + deadline_ns)
+        me.misses++;
+
+    pthread_cond_broadcast(&shm->cond);
+    pthread_mutex_unlock(&shm->mutex);
+}
+
+void InvokeArbiter::print_stats()
+{
+    const int64_t now = rc_nanos_monotonic_time();
+    if (stats_start_ns == 0)
+        stats_start_ns = now;
+    if ((now - stats_start_ns) / 1e9 < ARBITER_STATS_PERIOD_S)
+        return;
+    stats_start_ns = now;
+
+    lock();
+    reap();
+    for (int i = 0; i < ARBITER_MAX_CLIENTS; i++)
+    {
+        const arbiter_client_t &c = shm->clients[i];
+        if (c.pid == 0)
+            continue;
+        printf("%-24s pid %6d slot %d priority %2d: %7llu invokes, %5llu missed, %5llu shed, cost %6.2fms\n",
+               c.name, c.pid, c.slot, c.priority, (unsigned long long)c.invokes,
+               (unsigned long long)c.misses, (unsigned long long)c.shed, (double)c.cost_ms);
+    }
+    pthread_mutex_unlock(&shm->mutex);
+}
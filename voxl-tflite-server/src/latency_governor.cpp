@@ -0,0 +1,65 @@
+#include "latency_governor.h"
+
+void LatencyGovernor::configure(float _budget_ms, const std::vector<float> &level_cost)
+{
+    budget_ms = _budget_ms;
+    cost = level_cost;
+    reset();
+}
+
+void LatencyGovernor::reset()
+{
+    current = 0;
+    has_ema = false;
+    ema = 0;
+    frames_over = frames_under = 0;
+    settle = 0;
+}
+
+int LatencyGovernor::update(double latency_ms)
+{
+    if (budget_ms <= 0 || cost.size() < 2)
+        return current;
+
+    if (settle > 0)
+    {
+        settle--;
+        return current;
+    }
+
+    if (has_ema)
+        ema += GOVERNOR_EMA_ALPHA * ((float)latency_ms - ema);
+    else
+        ema = (float)latency_ms;
+    has_ema = true;
+
+    if (ema > budget_ms)
+    {
+        frames_over++;
+        frames_under = 0;
+    }
+    else
+    {
+        frames_over = 0;
+        if (current > 0 && ema * cost[current - 1] / cost[current] < GOVERNOR_UP_MARGIN * budget_ms)
+            frames_under++;
+        else
+            frames_under = 0;
+    }
+
+    int next = current;
+    if (frames_over >= GOVERNOR_DOWN_FRAMES && current + 1 < (int)cost.size())
+        next = current + 1;
+    else if (frames_under >= GOVERNOR_UP_FRAMES)
+        next = current - 1;
+
+    // latency at the new level starts from scratch
+    if (next != current)
+    {
+        current = next;
+        has_ema = false;
+        frames_over = frames_under = 0;
+        settle = GOVERNOR_SETTLE_FRAMES;
+    }
+    return current;
+}
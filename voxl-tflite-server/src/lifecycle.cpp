@@ -0,0 +1,113 @@
+#include "lifecycle.h"
+#include <chrono>
+
+LifecycleManager::LifecycleManager(const std::vector<CameraStream *> &streams,
+                                   float idle_suspend_s, float idle_release_s)
+    : streams(streams)
+{
+    suspend_after_ns = (uint64_t)(idle_suspend_s * 1e9);
+    release_after_ns = (uint64_t)(idle_release_s * 1e9);
+    last_client_time_ns = rc_nanos_monotonic_time();
+}
+
+bool LifecycleManager::has_clients()
+{
+    // debug and timing modes process every frame regardless of clients
+    if (en_debug || en_timing)
+        return true;
+
+    for (CameraStream *s : streams)
+    {
+        if (s->helper->has_clients())
+            return true;
+    }
+    return false;
+}
+
+void LifecycleManager::update()
+{
+    uint64_t now = rc_nanos_monotonic_time();
+
+    if (has_clients())
+    {
+        last_client_time_ns = now;
+        if (state != PIPELINE_ACTIVE && !resume())
+            fprintf(stderr, "ERROR: failed to resume inference pipeline\n");
+        return;
+    }
+
+    uint64_t idle_ns = now - last_client_time_ns;
+
+    if (state == PIPELINE_ACTIVE && suspend_after_ns > 0 &&
+        idle_ns >= suspend_after_ns)
+        suspend();
+
+    if (state == PIPELINE_SUSPENDED && release_after_ns > 0 &&
+        idle_ns >= release_after_ns)
+        release();
+}
+
+void LifecycleManager::suspend()
+{
+    if (en_debug)
+        printf("No clients connected, suspending camera pipes\n");
+
+    // stops the camera callbacks, the pipeline threads drain whatever is
+    // queued and then sleep on their condition variables
+    for (CameraStream *s : streams)
+        pipe_client_pause(s->client_ch);
+    state = PIPELINE_SUSPENDED;
+}
+
+void LifecycleManager::release()
+{
+    if (en_debug)
+        printf("Idle timeout reached, releasing interpreter and buffers\n");
+
+    // the cameras sharing the first one's interpreter let go of it before
+    // its delegates are deleted
+    for (size_t i = streams.size(); i-- > 0;)
+        streams[i]->helper->release_resources();
+    state = PIPELINE_RELEASED;
+}
+
+bool LifecycleManager::resume()
+{
+    if (state == PIPELINE_RELEASED)
+    {
+        uint64_t start = rc_nanos_monotonic_time();
+        // the first camera rebuilds the interpreter the others pick up
+        for (CameraStream *s : streams)
+            if (!s->helper->restore_resources())
+                return false;
+        if (en_debug)
+            printf("Rebuilt interpreter in %6.2fms\n",
+                   (rc_nanos_monotonic_time() - start) / 1000000.);
+    }
+
+    if (en_debug)
+        printf("Client connected, resuming camera pipes\n");
+
+    for (CameraStream *s : streams)
+        if (pipe_client_resume(s->client_ch))
+            return false;
+
+    state = PIPELINE_ACTIVE;
+    return true;
+}
+
+void LifecycleManager::notify()
+{
+    std::lock_guard<std::mutex> lock(wake_mutex);
+    wake_pending = true;
+    wake_cond.notify_all();
+}
+
+void LifecycleManager::wait(int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    wake_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                       [this]
+                       { return wake_pending; });
+    wake_pending = false;
+}
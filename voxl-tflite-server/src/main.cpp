@@ -2,13 +2,14 @@
 #include "utils.h"
 #include "model_helper/model_info.h"
 #include "inference_handler.h"
+#include "lifecycle.h"
 
 #define PROCESS_NAME "voxl-tflite-server"
 #define HIRES_PIPE "/run/mpa/hires_small_color/"
-#define TFLITE_IMAGE_PATH (MODAL_PIPE_DEFAULT_BASE_DIR "tflite/")
-#define TFLITE_DETECTION_PATH (MODAL_PIPE_DEFAULT_BASE_DIR "tflite_data/")
 
-ModelHelper *model_helper;
+CameraScheduler scheduler;
+InvokeArbiter arbiter;
+LifecycleManager *lifecycle;
 
 bool en_debug = false;
 bool en_timing = false;
@@ -27,7 +28,14 @@ static void _camera_disconnect_cb(__attribute__((unused)) int ch,
                                   __attribute__((unused)) void *context);
 static void _camera_connect_cb(__attribute__((unused)) int ch,
                                __attribute__((unused)) void *context);
+static void _server_connect_cb(__attribute__((unused)) int ch,
+                               __attribute__((unused)) int client_id,
+                               __attribute__((unused)) char *name,
+                               __attribute__((unused)) void *context);
 static void set_delegate(DelegateOpt *opt);
+static int _create_output_pipe(int ch, const char *name, const char *type, int size_bytes);
+static void _create_output_pipes(ModelCategory model_category, int offset, const std::string &suffix);
+static std::string _cam_name(const char *pipe);
 static void initialize_model_settings(char *model, char *delegate, ModelName *model_name, ModelCategory *model_category, NormalizationType *norm_type);
 
 int main(int argc, char *argv[])
@@ -87,15 +95,41 @@ int main(int argc, char *argv[])
     set_delegate(&opt_);
     initialize_model_settings(model, delegate, &model_name, &model_category, &do_normalize);
 
-    model_helper = create_model_helper(model_name, model_category, opt_, do_normalize);
+    // the main input pipe and any extra cameras, every camera after the
+    // first runs on the first one's interpreter with its own output pipes
+    std::vector<CameraStream> streams(1 + n_extra_cameras);
+    streams[0].pipe = input_pipe;
+    streams[0].priority = input_priority;
+    streams[0].rate_hz = input_rate_hz;
+    for (int i = 0; i < n_extra_cameras; i++)
+    {
+        streams[i + 1].pipe = extra_cameras[i].input_pipe;
+        streams[i + 1].priority = extra_cameras[i].priority;
+        streams[i + 1].rate_hz = extra_cameras[i].rate_hz;
+    }
 
-    // store cam name
-    std::string full_path(input_pipe);
-    std::string cam_name(
-        full_path.substr(full_path.rfind("/", full_path.size() - 2) + 1));
-    cam_name.pop_back();
+    for (size_t i = 0; i < streams.size(); i++)
+    {
+        CameraStream &stream = streams[i];
+        helper_init_t init;
+        if (i > 0)
+        {
+            init.share_interpreter_of = streams[0].helper;
+            init.queue_size = EXTRA_CAMERA_QUEUE_SIZE;
+            init.channel_offset = i * CAMERA_CHANNELS;
+        }
+        stream.helper = create_model_helper(model_name, model_category, opt_, do_normalize, init);
+        if (stream.helper == nullptr)
+            return -1;
 
-    model_helper->cam_name = cam_name;
+        // store cam name
+        stream.helper->cam_name = _cam_name(stream.pipe.c_str());
+        scheduler.add(&stream);
+    }
+
+    // the extra cameras run on the first one's pool too
+    if (interpreter_pool > 0)
+        streams[0].helper->prepare_interpreter_pool(interpreter_pool);
 
     main_running = 1;
 
@@ -107,87 +141,75 @@ int main(int argc, char *argv[])
     pthread_attr_init(&thread_attributes);
     pthread_attr_setdetachstate(&thread_attributes, PTHREAD_CREATE_JOINABLE);
 
+    // the model file name identifies us to the other servers
+    if (invoke_arbiter)
+    {
+        const char *model_file = strrchr(model, '/');
+        if (!arbiter.open(model_file != nullptr ? model_file + 1 : model, model_priority,
+                          model_deadline_ms, arbiter_shed))
+            fprintf(stderr, "WARNING: invoke arbiter unavailable, running unarbitrated\n");
+    }
+
     InferenceWorkerArgs *args = new InferenceWorkerArgs;
-    args->model_helper = model_helper;
+    args->scheduler = &scheduler;
+    args->arbiter = arbiter.is_open() ? &arbiter : nullptr;
 
-    int ret = pthread_create(&(model_helper->thread), &thread_attributes, run_inference_pipeline, args);
+    pthread_t pipeline_thread;
+    int ret = pthread_create(&pipeline_thread, &thread_attributes, run_inference_pipeline, args);
     if (ret != 0)
     {
         fprintf(stderr, "Error creating inference worker thread: %d\n", ret);
         delete args; // Clean up in case of failure
     }
 
-    // fire up our camera server connection
-    int ch = pipe_client_get_next_available_channel();
-
-    pipe_client_set_connect_cb(ch, _camera_connect_cb, NULL);
-    pipe_client_set_disconnect_cb(ch, _camera_disconnect_cb, NULL);
-    pipe_client_set_camera_helper_cb(ch, _camera_helper_cb, NULL);
-
-    if (pipe_client_open(ch, input_pipe, PROCESS_NAME,
-                         CLIENT_FLAG_EN_CAMERA_HELPER, 0))
+    // fire up our camera server connections
+    for (CameraStream &stream : streams)
     {
-        fprintf(stderr, "Failed to open pipe: %s\n", input_pipe);
-        return -1;
-    }
+        int ch = pipe_client_get_next_available_channel();
+        stream.client_ch = ch;
 
-    if (!allow_multiple)
-    {
-        // open our output pipes using default names
-        pipe_info_t image_pipe = {
-            "tflite", TFLITE_IMAGE_PATH, "camera_image_metadata_t",
-            PROCESS_NAME, 16 * 1024 * 1024, 0};
-        pipe_server_create(IMAGE_CH, image_pipe, 0);
-        if (model_category == OBJECT_DETECTION)
+        pipe_client_set_connect_cb(ch, _camera_connect_cb, NULL);
+        pipe_client_set_disconnect_cb(ch, _camera_disconnect_cb, NULL);
+        pipe_client_set_camera_helper_cb(ch, _camera_helper_cb, &stream);
+
+        if (pipe_client_open(ch, (char *)stream.pipe.c_str(), PROCESS_NAME,
+                             CLIENT_FLAG_EN_CAMERA_HELPER, 0))
         {
-            pipe_info_t detection_pipe = {
-                "tflite_data", TFLITE_DETECTION_PATH,
-                "ai_detection_t", PROCESS_NAME,
-                16 * 1024, 0};
-            pipe_server_create(DETECTION_CH, detection_pipe, 0);
+            fprintf(stderr, "Failed to open pipe: %s\n", stream.pipe.c_str());
+            return -1;
         }
     }
-    else
-    {
-        // set up a string to hold our custom pipe name
-        std::string output_pipe_holder = MODAL_PIPE_DEFAULT_BASE_DIR;
-        output_pipe_holder.append(output_pipe_prefix);
-        output_pipe_holder.append("_tflite");
-
-        // get c ptr to string
-        const char *buf_ptr = output_pipe_holder.c_str();
-
-        // create our output pipe
-        pipe_info_t image_pipe = {
-            "tflite", "unknown", "camera_image_metadata_t",
-            PROCESS_NAME, 16 * 1024 * 1024, 0};
-        // set the location to our new strings ptr
-        memcpy(image_pipe.location, buf_ptr, MODAL_PIPE_MAX_NAME_LEN);
-        // create the server pipe
-        pipe_server_create(IMAGE_CH, image_pipe, 0);
-
-        if (model_category == OBJECT_DETECTION)
-        {
-            // initialize the detection pipe only if we are running a detection
-            // model
-            pipe_info_t detection_pipe = {"tflite_data", "unknown",
-                                          "ai_detection_t", PROCESS_NAME,
-                                          16 * 1024, 0};
-            output_pipe_holder = MODAL_PIPE_DEFAULT_BASE_DIR;
-            output_pipe_holder.append(output_pipe_prefix);
-            output_pipe_holder.append("_tflite_data");
 
-            buf_ptr = output_pipe_holder.c_str();
+    // the first camera keeps the plain pipe names, the extra ones get their
+    // camera name appended
+    for (size_t i = 0; i < streams.size(); i++)
+        _create_output_pipes(model_category, streams[i].helper->out_ch(0),
+                             i > 0 ? "_" + streams[i].helper->cam_name : "");
 
-            memcpy(detection_pipe.location, buf_ptr, MODAL_PIPE_MAX_NAME_LEN);
-
-            pipe_server_create(DETECTION_CH, detection_pipe, 0);
-        }
+    // wake the lifecycle manager as soon as a client shows up so a suspended
+    // pipeline resumes without waiting for the next tick
+    lifecycle = new LifecycleManager(scheduler.get_streams(), idle_suspend_s, idle_release_s);
+    for (CameraStream &stream : streams)
+    {
+        ModelHelper *h = stream.helper;
+        pipe_server_set_connect_cb(h->out_ch(IMAGE_CH), _server_connect_cb, NULL);
+        pipe_server_set_connect_cb(h->out_ch(DETECTION_CH), _server_connect_cb, NULL);
+        pipe_server_set_connect_cb(h->out_ch(DEPTH_CH), _server_connect_cb, NULL);
+        pipe_server_set_connect_cb(h->out_ch(POINT_CLOUD_CH), _server_connect_cb, NULL);
+        pipe_server_set_connect_cb(h->out_ch(GATE_ESTIMATE_CH), _server_connect_cb, NULL);
+        pipe_server_set_connect_cb(h->out_ch(TRACK_CH), _server_connect_cb, NULL);
+        pipe_server_set_connect_cb(h->out_ch(STEREO_CH), _server_connect_cb, NULL);
     }
 
     while (main_running)
     {
-        usleep(5000000);
+        lifecycle->update();
+        lifecycle->wait(LIFECYCLE_TICK_MS);
+
+        if (en_timing && streams.size() > 1)
+            scheduler.print_stats();
+        if (en_timing && arbiter.is_open())
+            arbiter.print_stats();
     }
 
     pipe_client_close_all();
@@ -195,18 +217,17 @@ int main(int argc, char *argv[])
 
     fprintf(stderr, "\nStopping the application\n");
 
-    model_helper->cond_var.notify_all();
-    pthread_join(model_helper->thread, NULL);
+    scheduler.notify();
+    pthread_join(pipeline_thread, NULL);
 
     delete (args);
-    delete (model_helper);
+    delete (lifecycle);
+    // the extra cameras borrow the first one's interpreter
+    for (size_t i = streams.size(); i-- > 0;)
+        delete (streams[i].helper);
     return 0;
 }
 
-// offset for classification models only (as of now), used for addressing same
-// tensor data with varied offsets i.e. efficient net has 0 offset [0,1000],
-// mobilenetv1 has +1 offset [1, 1001], etc...
-
 static void _camera_connect_cb(__attribute__((unused)) int ch,
                                __attribute__((unused)) void *context)
 {
@@ -219,22 +240,33 @@ static void _camera_disconnect_cb(__attribute__((unused)) int ch,
     fprintf(stderr, "Disonnected from camera server\n");
 }
 
+static void _server_connect_cb(__attribute__((unused)) int ch,
+                               __attribute__((unused)) int client_id,
+                               __attribute__((unused)) char *name,
+                               __attribute__((unused)) void *context)
+{
+    if (lifecycle != nullptr)
+        lifecycle->notify();
+}
+
 static void _camera_helper_cb(__attribute__((unused)) int ch,
                               camera_image_metadata_t meta, char *frame,
                               void *context)
 {
-    static int n_skipped = 0;
-    if (n_skipped < skip_n_frames)
+    CameraStream *stream = (CameraStream *)context;
+    ModelHelper *model_helper = stream->helper;
+
+    if (stream->n_skipped < skip_n_frames)
     {
-        n_skipped++;
+        stream->n_skipped++;
         return;
     }
     else
-        n_skipped = 0;
+        stream->n_skipped = 0;
 
     if (pipe_client_bytes_in_pipe(ch) > 0)
     {
-        n_skipped++;
+        stream->n_skipped++;
         if (en_debug)
             fprintf(
                 stderr,
@@ -242,12 +274,10 @@ static void _camera_helper_cb(__attribute__((unused)) int ch,
                 ch);
         return;
     }
-    if (!en_debug && !en_timing)
-    {
-        if (!pipe_server_get_num_clients(IMAGE_CH) &&
-            !pipe_server_get_num_clients(DETECTION_CH))
-            return;
-    }
+    // same check the lifecycle manager suspends on, so a depth, track or
+    // gate estimate client alone keeps frames coming
+    if (!en_debug && !en_timing && !model_helper->has_clients())
+        return;
 
     if (meta.size_bytes > MAX_IMAGE_SIZE)
     {
@@ -256,15 +286,27 @@ static void _camera_helper_cb(__attribute__((unused)) int ch,
         return;
     }
 
-    int queue_ind = model_helper->camera_queue.insert_idx;
+    // queue is freed while the lifecycle manager has released our resources,
+    // hold it off until the frame is in
+    std::shared_lock<std::shared_timed_mutex> lifecycle_lock(model_helper->lifecycle_mutex);
+    if (model_helper->camera_queue.queue == nullptr)
+        return;
+
+    int queue_ind = model_helper->camera_queue.begin_write();
 
     TFLiteMessage *camera_message = &model_helper->camera_queue.queue[queue_ind];
 
     camera_message->metadata = meta;
     memcpy(camera_message->image_pixels, (uint8_t *)frame, meta.size_bytes);
 
-    model_helper->camera_queue.insert_idx = ((queue_ind + 1) % QUEUE_SIZE);
-    model_helper->cond_var.notify_all();
+    // a few thousand reads, the scene gate decides on it in preprocess
+    camera_message->has_thumbnail =
+        scene_change_threshold > 0 &&
+        scene_thumbnail(meta, (uint8_t *)frame, camera_message->thumbnail);
+
+    model_helper->camera_queue.end_write(queue_ind);
+    lifecycle_lock.unlock();
+    scheduler.notify();
 
     // print timing if requested
     if (en_timing)
@@ -275,6 +317,89 @@ static void _camera_helper_cb(__attribute__((unused)) int ch,
     return;
 }
 
+// camera name from its pipe path, the last directory
+static std::string _cam_name(const char *pipe)
+{
+    std::string full_path(pipe);
+    std::string cam_name(
+        full_path.substr(full_path.rfind("/", full_path.size() - 2) + 1));
+    if (!cam_name.empty() && cam_name.back() == '/')
+        cam_name.pop_back();
+    return cam_name;
+}
+
+// opens the output pipes of one camera on the channels from offset on, every
+// model gets the overlay image pipe
+static void _create_output_pipes(ModelCategory model_category, int offset, const std::string &suffix)
+{
+    auto create = [&](int ch, const char *name, const char *type, int size_bytes)
+    {
+        _create_output_pipe(offset + ch, (name + suffix).c_str(), type, size_bytes);
+    };
+
+    create(IMAGE_CH, "tflite", "camera_image_metadata_t", 16 * 1024 * 1024);
+
+    // detectors publish ai_detection_t, segmentation publishes its class mask
+    // as segmentation_mask_t + payload, classifiers their top k classes, pose
+    // models one ai_pose_t per person and gate models one gate_state_t
+    if (model_category == OBJECT_DETECTION)
+        create(DETECTION_CH, "tflite_data", "ai_detection_t", 16 * 1024);
+    else if (model_category == SEGMENTATION)
+        create(DETECTION_CH, "tflite_data", "segmentation_mask_t", 1024 * 1024);
+    else if (model_category == CLASSIFICATION)
+        create(DETECTION_CH, "tflite_data", "ai_classification_t", 16 * 1024);
+    else if (model_category == POSE)
+        create(DETECTION_CH, "tflite_data", "ai_pose_t", 64 * 1024);
+    else if (model_category == GATE)
+        create(DETECTION_CH, "tflite_data", "gate_state_t", 16 * 1024);
+
+    // the gate estimator publishes on its own pipe at gate_estimate_rate_hz
+    if (model_category == GATE && gate_estimate_rate_hz > 0)
+        create(GATE_ESTIMATE_CH, "tflite_gate_estimate", "gate_state_t", 64 * 1024);
+
+    // tracked detectors also publish their tracks with persistent ids
+    if (model_category == OBJECT_DETECTION && tracker_detect_interval > 0)
+        create(TRACK_CH, "tflite_tracks", "ai_track_t", 64 * 1024);
+
+    // stereo detectors publish the boxes matched between the eyes with their range
+    if (model_category == OBJECT_DETECTION && stereo_triangulate)
+        create(STEREO_CH, "tflite_stereo", "ai_stereo_detection_t", 64 * 1024);
+
+    // depth models publish metric depth and the matching point cloud
+    if (model_category == MONO_DEPTH)
+    {
+        create(DEPTH_CH, "tflite_depth", "camera_image_metadata_t", 4 * 1024 * 1024);
+        create(POINT_CLOUD_CH, "tflite_point_cloud", "point_cloud_metadata_t", 16 * 1024 * 1024);
+    }
+}
+
+// creates an output pipe under its default name, or prefixed with
+// output_pipe_prefix when allow_multiple is set so several instances can run
+static int _create_output_pipe(int ch, const char *name, const char *type, int size_bytes)
+{
+    std::string location = MODAL_PIPE_DEFAULT_BASE_DIR;
+    if (allow_multiple)
+    {
+        location.append(output_pipe_prefix);
+        location.append("_");
+        location.append(name);
+    }
+    else
+    {
+        location.append(name);
+        location.append("/");
+    }
+
+    pipe_info_t info = {};
+    strncpy(info.name, name, MODAL_PIPE_MAX_NAME_LEN - 1);
+    strncpy(info.location, location.c_str(), MODAL_PIPE_MAX_DIR_LEN - 1);
+    strncpy(info.type, type, MODAL_PIPE_MAX_TYPE_LEN - 1);
+    strncpy(info.server_name, PROCESS_NAME, MODAL_PIPE_MAX_NAME_LEN - 1);
+    info.size_bytes = size_bytes;
+
+    return pipe_server_create(ch, info, 0);
+}
+
 static void set_delegate(DelegateOpt *opt)
 {
     *opt = GPU; // default for MAI models
@@ -340,6 +465,15 @@ static void initialize_model_settings(char *model, char *delegate, ModelName *mo
         *model_category = POSE;
         *norm_type = NONE;
     }
+    else if (!strcmp(model,
+                     "/usr/bin/dnn/"
+                     "lite-model_movenet_multipose_lightning_tflite_float16_"
+                     "1.tflite"))
+    {
+        *model_name = POSENET;
+        *model_category = POSE;
+        *norm_type = NONE;
+    }
     else if (!strcmp(model, "/usr/bin/dnn/yolov5_float16_quant.tflite"))
     {
         *model_name = YOLOV5;
@@ -361,19 +495,19 @@ static void initialize_model_settings(char *model, char *delegate, ModelName *mo
     else if (!strcmp(model, "/usr/bin/dnn/gate_xyz.tflite"))
     {
         *model_name     = GATE_XYZ;
-        *model_category = OBJECT_DETECTION;
+        *model_category = GATE;
         *norm_type      = NONE;
     }
     else if (!strcmp(model, "/usr/bin/dnn/gate_yaw.tflite"))
     {
         *model_name     = GATE_YAW;
-        *model_category = OBJECT_DETECTION;
+        *model_category = GATE;
         *norm_type      = NONE;
     }
     else if (!strcmp(model, "/usr/bin/dnn/gate_bin.tflite"))
     {
         *model_name     = GATE_BIN;
-        *model_category = OBJECT_DETECTION;
+        *model_category = GATE;
         *norm_type      = NONE;
     }
     else
@@ -1,6 +1,8 @@
 #include "model_helper/deep_lab_model_helper.h"
 #include "tensor_data.h"
 #include "image_utils.h"
+#include "segmentation.h"
+#include "segmentation_mask.h"
 
 // pre-defined color map for each class, corresponds to cityscapes_labels.txt
 static const uint8_t color_map[57] = {
@@ -11,8 +13,9 @@ static const uint8_t color_map[57] = {
 
 DeepLabModelHelper::DeepLabModelHelper(char *model_file, char *labels_file,
                                        DelegateOpt delegate_choice, bool _en_debug,
-                                       bool _en_timing, NormalizationType _do_normalize)
-    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize)
+                                       bool _en_timing, NormalizationType _do_normalize,
+                                       const helper_init_t &init)
+    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize, init)
 {
     if (labels.empty())
     {
@@ -23,6 +26,15 @@ DeepLabModelHelper::DeepLabModelHelper(char *model_file, char *labels_file,
             exit(-1);
         }
     }
+
+    // colors past the cityscapes table stay black
+    color_lut = {};
+    for (int i = 0; i < (int)(sizeof(color_map) / 3) && i < SEG_MAX_COLORS; i++)
+    {
+        color_lut.r[i] = color_map[i * 3];
+        color_lut.g[i] = color_map[i * 3 + 1];
+        color_lut.b[i] = color_map[i * 3 + 2];
+    }
 }
 
 bool DeepLabModelHelper::worker(cv::Mat &output_image, double last_inference_time, camera_image_metadata_t metadata, void *input_params)
@@ -37,55 +49,137 @@ bool DeepLabModelHelper::worker(cv::Mat &output_image, double last_inference_tim
     DeepLabModelParams* params = new DeepLabModelParams(metadata);
 
     if (!postprocess(output_image, last_inference_time, params)) {
+        delete params;
         return false;
     }
 
-    params->meta.timestamp_ns = rc_nanos_monotonic_time();
-    pipe_server_write_camera_frame(IMAGE_CH, params->meta,
-                                   (char *)preprocessed_image->data);
+    if (publish_mask)
+        write_class_mask(metadata);
+    // the publisher keeps a reference to opencv allocated images instead of
+    // copying them, and the overlay is blended into again by the next frame
+    if (render_output)
+        publish_output_image(params->meta, overlay.clone());
+    delete params;
     return true;
 }
 
+bool DeepLabModelHelper::build_class_mask(TfLiteTensor *output)
+{
+    const TfLiteIntArray *dims = output->dims;
+    if (dims->size < 3 || dims->data[1] != model_height || dims->data[2] != model_width)
+    {
+        fprintf(stderr, "ERROR: unexpected segmentation output shape\n");
+        return false;
+    }
+
+    const int n = model_width * model_height;
+    const int num_classes = (dims->size == 4) ? dims->data[3] : 1;
+    class_mask.resize(n);
+
+    // models either end in ArgMax and give us class ids, or give raw logits
+    // per pixel and we take the argmax ourselves
+    switch (output->type)
+    {
+    case kTfLiteInt64:
+        seg_mask_from_labels_i64(TensorData<int64_t>(output, 0), n, class_mask.data());
+        break;
+    case kTfLiteInt32:
+        seg_mask_from_labels_i32(TensorData<int32_t>(output, 0), n, class_mask.data());
+        break;
+    case kTfLiteFloat32:
+        seg_argmax_f32(TensorData<float>(output, 0), n, num_classes, class_mask.data());
+        break;
+    case kTfLiteUInt8:
+        seg_argmax_u8(TensorData<uint8_t>(output, 0), n, num_classes, class_mask.data());
+        break;
+    case kTfLiteInt8:
+        seg_argmax_i8(TensorData<int8_t>(output, 0), n, num_classes, class_mask.data());
+        break;
+    default:
+        fprintf(stderr, "ERROR: unsupported segmentation output type %d\n", output->type);
+        return false;
+    }
+
+    return true;
+}
+
+void DeepLabModelHelper::write_class_mask(const camera_image_metadata_t &meta)
+{
+    segmentation_mask_t header;
+    header.magic_number = SEGMENTATION_MASK_MAGIC_NUMBER;
+    header.timestamp_ns = meta.timestamp_ns;
+    header.frame_id = meta.frame_id;
+    header.width = model_width;
+    header.height = model_height;
+    header.num_classes = label_count;
+    header.reserved = 0;
+
+    const void *payload = class_mask.data();
+    header.encoding = SEGMENTATION_MASK_RAW;
+    header.size_bytes = class_mask.size();
+
+    if (segmentation_mask_rle)
+    {
+        mask_rle.resize(2 * class_mask.size());
+        header.encoding = SEGMENTATION_MASK_RLE;
+        header.size_bytes = seg_rle_encode(class_mask.data(), class_mask.size(),
+                                           mask_rle.data());
+        payload = mask_rle.data();
+    }
+
+    const void *bufs[] = {&header, payload};
+    size_t lens[] = {sizeof(header), header.size_bytes};
+    pipe_server_write_list(out_ch(DETECTION_CH), 2, bufs, lens);
+}
+
 bool DeepLabModelHelper::postprocess(cv::Mat& output_image, double last_inference_time, void *input_params)
 {
     DeepLabModelParams* params = static_cast<DeepLabModelParams*>(input_params);
 
     start_time = rc_nanos_monotonic_time();
 
+    // the mask goes out on the data pipe and/or blended into the overlay,
+    // skip it entirely when neither has a client
+    publish_mask = pipe_server_get_num_clients(out_ch(DETECTION_CH)) > 0;
+    if (!publish_mask && !render_output)
+        return true;
+
     TfLiteTensor *output_locations =
         interpreter->tensor(interpreter->outputs()[0]);
 
-    int64_t *classes = TensorData<int64_t>(output_locations, 0);
+    if (!build_class_mask(output_locations))
+    {
+        publish_mask = false;
+        return false;
+    }
 
-    cv::Mat temp(model_height, model_width, CV_8UC3, cv::Scalar(0, 0, 0));
+    if (!render_output)
+    {
+        if (en_timing)
+            total_postprocess_time +=
+                ((rc_nanos_monotonic_time() - start_time) / 1000000.);
+        return true;
+    }
 
-    for (int i = 0; i < model_width; i++)
+    // the legend in the right border never changes, draw it once
+    if (overlay.empty())
     {
-        for (int j = 0; j < model_height; j++)
-        {
-            cv::Vec3b color = temp.at<cv::Vec3b>(cv::Point(j, i));
+        overlay = cv::Mat::zeros(model_height, model_width + right_pixel_border, CV_8UC3);
 
-            color[0] = color_map[classes[(i * model_width) + j] * 3];
-            color[1] = color_map[classes[(i * model_width) + j] * 3 + 1];
-            color[2] = color_map[classes[(i * model_width) + j] * 3 + 2];
-            temp.at<cv::Vec3b>(cv::Point(j, i)) = color;
+        for (unsigned int i = 0; i < label_count; i++)
+        {
+            cv::putText(overlay, labels[i], cv::Point(325, 16 * (i + 1)),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.4,
+                        cv::Scalar(color_map[(i * 3)], color_map[(i * 3) + 1],
+                                   color_map[(i * 3) + 2]),
+                        1);
         }
     }
 
-    // now blend the model input and output
-    cv::addWeighted(*preprocessed_image, 0.75, temp, 0.25, 0, *preprocessed_image);
-    // add key overlay
-    cv::copyMakeBorder(*preprocessed_image, *preprocessed_image, 0, 0, 0, right_pixel_border,
-                       cv::BORDER_CONSTANT);
-
-    for (unsigned int i = 0; i < labels.size(); i++)
-    {
-        cv::putText(*preprocessed_image, labels[i], cv::Point(325, 16 * (i + 1)),
-                    cv::FONT_HERSHEY_SIMPLEX, 0.4,
-                    cv::Scalar(color_map[(i * 3)], color_map[(i * 3) + 1],
-                               color_map[(i * 3) + 2]),
-                    1);
-    }
+    // colorize and blend the model input with the mask straight into the overlay
+    seg_colorize_blend(preprocessed_image->data, preprocessed_image->step,
+                       class_mask.data(), model_width, model_height, &color_lut,
+                       overlay.data, overlay.step);
 
     // now, setup metadata since we modified the output image
     params->meta.format = IMAGE_FORMAT_RGB;
@@ -94,7 +188,7 @@ bool DeepLabModelHelper::postprocess(cv::Mat& output_image, double last_inferenc
     params->meta.stride = params->meta.width * 3;
     params->meta.size_bytes = params->meta.height * params->meta.width * 3;
 
-    draw_fps(*preprocessed_image, last_inference_time, cv::Point(0, 0), 0.25, 0.4,
+    draw_fps(overlay, last_inference_time, cv::Point(0, 0), 0.25, 0.4,
              cv::Scalar(0, 0, 0), cv::Scalar(180, 180, 180), true);
 
     if (en_timing)
@@ -4,8 +4,74 @@
 
 FastDepthModelHelper::FastDepthModelHelper(char *model_file, char *labels_file,
                                            DelegateOpt delegate_choice, bool _en_debug,
-                                           bool _en_timing, NormalizationType _do_normalize)
-    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize) {}
+                                           bool _en_timing, NormalizationType _do_normalize,
+                                           const helper_init_t &init)
+    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize, init) {}
+
+bool FastDepthModelHelper::build_rays()
+{
+    if (!ray_x.empty())
+        return true;
+
+    // only try once, without a calibration there is no point cloud
+    if (calibration_checked)
+        return false;
+    calibration_checked = true;
+
+    // a corrected input is a pinhole view of its own, without undistortion
+    // its rays aren't known
+    camera_calibration_t cal;
+    int width = input_width, height = input_height;
+    if (input_corrected)
+    {
+        cal = corrected_cal;
+        width = corrected_cal.width;
+        height = corrected_cal.height;
+    }
+    if ((input_corrected && !has_corrected_cal) ||
+        (!input_corrected && camera_calibration_load(cam_name.c_str(), &cal)))
+    {
+        fprintf(stderr, "WARNING: point cloud output disabled\n");
+        return false;
+    }
+
+    const int n = model_width * model_height;
+    ray_x.resize(n);
+    ray_y.resize(n);
+    points.resize(3 * n);
+    camera_calibration_build_rays(&cal, width, height, model_width,
+                                  model_height, ray_x.data(), ray_y.data());
+    return true;
+}
+
+void FastDepthModelHelper::write_depth(const camera_image_metadata_t &meta, const float *depth)
+{
+    // keep the camera timestamp so depth lines up with the pose it was taken at
+    camera_image_metadata_t depth_meta = meta;
+    depth_meta.format = IMAGE_FORMAT_FLOAT32;
+    depth_meta.width = model_width;
+    depth_meta.height = model_height;
+    depth_meta.stride = model_width * sizeof(float);
+    depth_meta.size_bytes = model_width * model_height * sizeof(float);
+
+    pipe_server_write_camera_frame(out_ch(DEPTH_CH), depth_meta, depth);
+}
+
+void FastDepthModelHelper::write_point_cloud(const camera_image_metadata_t &meta, const float *depth)
+{
+    const int n = model_width * model_height;
+    depth_to_points(depth, ray_x.data(), ray_y.data(), n, points.data());
+
+    point_cloud_metadata_t pc_meta = {};
+    pc_meta.magic_number = POINT_CLOUD_MAGIC_NUMBER;
+    pc_meta.timestamp_ns = meta.timestamp_ns;
+    pc_meta.n_points = n;
+    pc_meta.format = POINT_CLOUD_FORMAT_FLOAT_XYZ;
+    pc_meta.id = meta.frame_id;
+    strncpy(pc_meta.server_name, "voxl-tflite-server", sizeof(pc_meta.server_name) - 1);
+
+    pipe_server_write_point_cloud(out_ch(POINT_CLOUD_CH), pc_meta, points.data());
+}
 
 bool FastDepthModelHelper::postprocess(cv::Mat &output_image, double last_inference_time, void *input_params)
 {
@@ -17,8 +83,20 @@ bool FastDepthModelHelper::postprocess(cv::Mat &output_image, double last_infere
     TfLiteTensor *output_locations = interpreter->tensor(interpreter->outputs()[0]);
     float *depth = TensorData<float>(output_locations, 0);
 
-    // actual depth image if desired
-    cv::Mat depthImage(model_height, model_width, CV_32FC1, depth);
+    // metric depth for the mapper, both skipped without a client
+    if (pipe_server_get_num_clients(out_ch(DEPTH_CH)) > 0)
+        write_depth(params->meta, depth);
+    if (pipe_server_get_num_clients(out_ch(POINT_CLOUD_CH)) > 0 && build_rays())
+        write_point_cloud(params->meta, depth);
+
+    // the colormap is only for looking at, build it only for an image client
+    if (!render_output)
+    {
+        if (en_timing)
+            total_postprocess_time +=
+                ((rc_nanos_monotonic_time() - start_time) / 1000000.);
+        return true;
+    }
 
     // setup output metadata
     params->meta.height = model_height;
@@ -27,13 +105,13 @@ bool FastDepthModelHelper::postprocess(cv::Mat &output_image, double last_infere
     params->meta.stride = params->meta.width * 3;
     params->meta.format = IMAGE_FORMAT_RGB;
 
-    // create a pretty colored depth image from the data
+    // create a pretty colored depth image from the data, normalized per frame
+    cv::Mat depthImage(model_height, model_width, CV_32FC1, depth);
     double min_val, max_val;
     cv::Mat depthmap_visual;
     cv::minMaxLoc(depthImage, &min_val, &max_val);
-    depthmap_visual = 255 * (depthImage - min_val) /
-                      (max_val - min_val); // * 255 for "scaled" disparity
-    depthmap_visual.convertTo(depthmap_visual, CV_8U);
+    depthImage.convertTo(depthmap_visual, CV_8U, 255.0 / (max_val - min_val),
+                         -255.0 * min_val / (max_val - min_val));
     cv::applyColorMap(depthmap_visual, output_image, 4); // opencv COLORMAP_JET
 
     if (en_timing)
@@ -51,14 +129,12 @@ bool FastDepthModelHelper::worker(cv::Mat &output_image, double last_inference_t
     FastDepthModelParams* params = new FastDepthModelParams(metadata);
 
     if (!postprocess(output_image, last_inference_time, params)) {
+        delete params;
         return false;
     }
-    params->meta.timestamp_ns = rc_nanos_monotonic_time();
-
-
-    pipe_server_write_camera_frame(IMAGE_CH, params->meta,
-                                   (char *)output_image.data);
+    if (render_output)
+        publish_output_image(params->meta, output_image);
 
     delete params;
     return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+// model_helper/gate_model_helper.cpp
+#include "model_helper/gate_model_helper.h"
+
+GateModelHelper::GateModelHelper(char *model_file,
+                                 char *labels_file,
+                                 DelegateOpt delegate_choice,
+                                 bool _en_debug,
+                                 bool _en_timing,
+                                 NormalizationType _do_normalize,
+                                 const helper_init_t &init)
+  : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize, init),
+    logger(log_rate_hz)
+{
+    // the base constructor already moved us to our camera's channels
+    if (gate_estimate_rate_hz > 0)
+    {
+        estimate_running = true;
+        estimate_thread = std::thread(&GateModelHelper::publish_estimates, this);
+    }
+}
+
+GateModelHelper::~GateModelHelper()
+{
+    estimate_running = false;
+    if (estimate_thread.joinable())
+        estimate_thread.join();
+}
+
+void GateModelHelper::publish_estimates()
+{
+    const auto period = std::chrono::nanoseconds((int64_t)(1e9 / gate_estimate_rate_hz));
+    auto next = std::chrono::steady_clock::now();
+
+    // steady_clock is CLOCK_MONOTONIC like the camera timestamps, so the
+    // prediction time lines up with the frames the estimate was built from
+    while (estimate_running)
+    {
+        next += period;
+        std::this_thread::sleep_until(next);
+
+        if (pipe_server_get_num_clients(out_ch(GATE_ESTIMATE_CH)) <= 0)
+            continue;
+
+        gate_state_t state;
+        if (estimator.predict(rc_nanos_monotonic_time(), state))
+            pipe_server_write(out_ch(GATE_ESTIMATE_CH), &state, sizeof(state));
+    }
+}
+
+bool GateModelHelper::postprocess(cv::Mat &,
+                                  double,
+                                  void *)
+{
+    return true;
+}
+
+bool GateModelHelper::worker(cv::Mat & /*output_image*/,
+                             double /*last_inference_time*/,
+                             camera_image_metadata_t metadata,
+                             void * /*input_params*/)
+{
+    const float *out = interpreter->typed_output_tensor<float>(0);
+
+    gate_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.magic_number = GATE_STATE_MAGIC_NUMBER;
+    state.version = GATE_STATE_VERSION;
+    state.timestamp_ns = metadata.timestamp_ns;
+    state.frame_id = metadata.frame_id;
+    fill_state(out, state);
+
+    last_state = state;
+    has_last_state = true;
+    publish_state(state);
+    fuse_state(state);
+
+    return true;
+}
+
+bool GateModelHelper::republish(const camera_image_metadata_t &meta)
+{
+    if (!has_last_state)
+        return false;
+
+    // the repeat isn't a new measurement, fusing it at the new time would
+    // drag the velocity estimate to zero and shrink the covariance, so it
+    // only goes out on the detection pipe
+    gate_state_t state = last_state;
+    state.timestamp_ns = meta.timestamp_ns;
+    state.frame_id = meta.frame_id;
+    publish_state(state);
+    return true;
+}
+
+void GateModelHelper::publish_state(const gate_state_t &state)
+{
+    pipe_server_write(out_ch(DETECTION_CH), &state, sizeof(state));
+
+    if (state.valid_fields & GATE_STATE_HAS_XYZ)
+        logger.log("Gate frame %d: x=%.3f y=%.3f z=%.3f", state.frame_id,
+                   (double)state.x, (double)state.y, (double)state.z);
+    if (state.valid_fields & GATE_STATE_HAS_YAW)
+        logger.log("Gate frame %d: yaw=%.3f", state.frame_id, (double)state.yaw);
+    if (state.valid_fields & GATE_STATE_HAS_BIN)
+        logger.log("Gate frame %d: bin=%.3f", state.frame_id, (double)state.bin);
+}
+
+void GateModelHelper::fuse_state(const gate_state_t &state)
+{
+    if (estimate_running && !estimator.update(state))
+        logger.log("Gate frame %d: rejected as outlier", state.frame_id);
+}
@@ -1,13 +1,14 @@
 #include "model_helper/generic_classification_model_helper.h"
 #include "tensor_data.h"
 #include "image_utils.h"
+#include "topk.h"
 
 GenericClassificationModelHelper::GenericClassificationModelHelper(char *model_file, char *labels_file,
                                                                    DelegateOpt delegate_choice, bool _en_debug,
-                                                                   bool _en_timing, NormalizationType _do_normalize, int tensor_offset)
-    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize)
+                                                                   bool _en_timing, NormalizationType _do_normalize,
+                                                                   const helper_init_t &init)
+    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize, init)
 {
-    this->tensor_offset = tensor_offset;
     if (labels.empty())
     {
         if (ReadLabelsFile(labels_location, &labels, &label_count) !=
@@ -24,44 +25,121 @@ bool GenericClassificationModelHelper::worker(cv::Mat &output_image, double last
     if (!postprocess(output_image, last_inference_time, input_params))
         return false;
 
-    metadata.timestamp_ns = rc_nanos_monotonic_time();
-    pipe_server_write_camera_frame(IMAGE_CH, metadata,
-                                   (char *)output_image.data);
+    if (num_results > 0)
+        write_results(metadata);
+    if (render_output)
+        publish_output_image(metadata, output_image);
     return true;
 }
 
-bool GenericClassificationModelHelper::postprocess(cv::Mat &output_image, double last_inference_time, void *input_params)
+bool GenericClassificationModelHelper::select_top_k(TfLiteTensor *output)
 {
-    int num_of_classes = 1000;
+    const int num_scores = output->dims->data[output->dims->size - 1];
+
+    // models trained with a background class have one more score than the
+    // labels file has lines, the extra scores come first
+    int offset = num_scores - (int)label_count;
+    if (offset < 0)
+        offset = 0;
+    const int num_classes = num_scores - offset;
+
+    int k = classification_top_k;
+    if (k > AI_CLASSIFICATION_MAX_K)
+        k = AI_CLASSIFICATION_MAX_K;
 
+    switch (output->type)
+    {
+    case kTfLiteFloat32:
+        num_results = topk_f32(output->data.f + offset, num_classes, k,
+                               result_class, result_score);
+        break;
+    case kTfLiteUInt8:
+    {
+        uint8_t raw[AI_CLASSIFICATION_MAX_K];
+        num_results = topk_u8(output->data.uint8 + offset, num_classes, k,
+                              result_class, raw);
+        for (int i = 0; i < num_results; i++)
+            result_score[i] = output->params.scale * ((int)raw[i] - output->params.zero_point);
+        break;
+    }
+    case kTfLiteInt8:
+    {
+        int8_t raw[AI_CLASSIFICATION_MAX_K];
+        num_results = topk_i8(output->data.int8 + offset, num_classes, k,
+                              result_class, raw);
+        for (int i = 0; i < num_results; i++)
+            result_score[i] = output->params.scale * ((int)raw[i] - output->params.zero_point);
+        break;
+    }
+    default:
+        fprintf(stderr, "ERROR: unsupported classification output type %d\n", output->type);
+        num_results = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void GenericClassificationModelHelper::write_results(const camera_image_metadata_t &meta)
+{
+    ai_classification_t results[AI_CLASSIFICATION_MAX_K];
+
+    for (int i = 0; i < num_results; i++)
+    {
+        ai_classification_t &r = results[i];
+        memset(&r, 0, sizeof(r));
+        r.magic_number = AI_CLASSIFICATION_MAGIC_NUMBER;
+        r.timestamp_ns = meta.timestamp_ns;
+        r.frame_id = meta.frame_id;
+        r.class_id = result_class[i];
+        r.rank = i;
+        r.score = result_score[i];
+        strncpy(r.class_name, labels[result_class[i]].c_str(), BUF_LEN - 1);
+        strncpy(r.cam, cam_name.c_str(), BUF_LEN - 1);
+    }
+
+    pipe_server_write(out_ch(DETECTION_CH), (char *)results, sizeof(ai_classification_t) * num_results);
+}
+
+bool GenericClassificationModelHelper::republish(const camera_image_metadata_t &meta)
+{
+    if (num_results > 0)
+        write_results(meta);
+    return true;
+}
+
+bool GenericClassificationModelHelper::postprocess(cv::Mat &output_image, double last_inference_time, void *input_params)
+{
     start_time = rc_nanos_monotonic_time();
 
     TfLiteTensor *output_locations =
         interpreter->tensor(interpreter->outputs()[0]);
-    uint8_t *confidence_tensor = TensorData<uint8_t>(output_locations, 0);
 
-    std::vector<uint8_t> confidences;
-    confidences.assign(
-        confidence_tensor + tensor_offset,
-        confidence_tensor + num_of_classes + tensor_offset);
+    if (!select_top_k(output_locations))
+        return false;
 
-    uint8_t best_prob =
-        *std::max_element(confidences.begin(), confidences.end());
-    int best_class = std::max_element(confidences.begin(), confidences.end()) -
-                     confidences.begin();
+    if (en_debug && num_results > 0)
+        printf("class: %s, score: %.3f\n", labels[result_class[0]].c_str(),
+               (double)result_score[0]);
 
-    fprintf(stderr, "class: %s, prob: %d\n", labels[best_class].c_str(),
-            best_prob);
-    cv::putText(output_image, labels[best_class],
-                cv::Point(input_width / 3, 25), cv::FONT_HERSHEY_SIMPLEX, 0.8,
-                cv::Scalar(0, 255, 0), 1);
+    if (render_output)
+    {
+        for (int i = 0; i < num_results; i++)
+        {
+            char text[128];
+            snprintf(text, sizeof(text), "%s %.2f", labels[result_class[i]].c_str(),
+                     (double)result_score[i]);
+            cv::putText(output_image, text, cv::Point(input_width / 3, 25 + 25 * i),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 0), 1);
+        }
 
-    draw_fps(output_image, last_inference_time, cv::Point(0, 0), 0.5, 2,
-             cv::Scalar(0, 0, 0), cv::Scalar(180, 180, 180), true);
+        draw_fps(output_image, last_inference_time, cv::Point(0, 0), 0.5, 2,
+                 cv::Scalar(0, 0, 0), cv::Scalar(180, 180, 180), true);
+    }
 
     if (en_timing)
         total_postprocess_time +=
             ((rc_nanos_monotonic_time() - start_time) / 1000000.);
 
     return true;
-}
\ No newline at end of file
+}
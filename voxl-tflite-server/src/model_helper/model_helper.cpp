@@ -9,12 +9,28 @@
 #include "model_helper/gate_xyz_model_helper.h"
 #include "model_helper/gate_yaw_model_helper.h"
 #include "model_helper/gate_bin_model_helper.h"
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
 
 
-ModelHelper *create_model_helper(ModelName model_name,
-                                 ModelCategory model_category,
-                                 DelegateOpt opt_,
-                                 NormalizationType do_normalize)
+// same names as the delegate option
+static const char *delegate_names[] = {"cpu", "gpu", "nnapi"};
+
+static DelegateOpt delegate_from_string(const char *name)
+{
+    if (!strcmp(name, "cpu"))
+        return XNNPACK;
+    if (!strcmp(name, "nnapi"))
+        return NNAPI;
+    return GPU;
+}
+
+static ModelHelper *new_model_helper(ModelName model_name,
+                                     ModelCategory model_category,
+                                     DelegateOpt opt_,
+                                     NormalizationType do_normalize,
+                                     const helper_init_t &init)
 {
     switch (model_name)
     {
@@ -22,7 +38,7 @@ ModelHelper *create_model_helper(ModelName model_name,
     {
         if (model_category == POSE)
         {
-            return new PoseNetModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new PoseNetModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -34,7 +50,7 @@ ModelHelper *create_model_helper(ModelName model_name,
     {
         if (model_category == OBJECT_DETECTION)
         {
-            return new YoloV5ModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new YoloV5ModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -47,7 +63,7 @@ ModelHelper *create_model_helper(ModelName model_name,
         if (model_category == OBJECT_DETECTION)
         {
 
-            return new YoloV8ModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new YoloV8ModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -59,12 +75,11 @@ ModelHelper *create_model_helper(ModelName model_name,
     {
         if (model_category == OBJECT_DETECTION)
         {
-            return new GenericObjectDetectionModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new GenericObjectDetectionModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else if (model_category == CLASSIFICATION)
         {
-            int tensor_offset = 1;
-            return new GenericClassificationModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, tensor_offset);
+            return new GenericClassificationModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -76,7 +91,7 @@ ModelHelper *create_model_helper(ModelName model_name,
     {
         if (model_category == MONO_DEPTH)
         {
-            return new FastDepthModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new FastDepthModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -88,7 +103,7 @@ ModelHelper *create_model_helper(ModelName model_name,
     {
         if (model_category == SEGMENTATION)
         {
-            return new DeepLabModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new DeepLabModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -100,8 +115,7 @@ ModelHelper *create_model_helper(ModelName model_name,
     {
         if (model_category == CLASSIFICATION)
         {
-            int tensor_offset = 0;
-            return new GenericClassificationModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, tensor_offset);
+            return new GenericClassificationModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -114,7 +128,7 @@ ModelHelper *create_model_helper(ModelName model_name,
         if (model_category == OBJECT_DETECTION)
         {
             // The usage for v8 and v11 is the same so the same api is used
-            return new YoloV8ModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new YoloV8ModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -129,7 +143,8 @@ ModelHelper *create_model_helper(ModelName model_name,
             opt_,
             en_debug,
             en_timing,
-            do_normalize
+            do_normalize,
+            init
         );
     }
     case GATE_YAW:
@@ -140,7 +155,8 @@ ModelHelper *create_model_helper(ModelName model_name,
             opt_,
             en_debug,
             en_timing,
-            do_normalize
+            do_normalize,
+            init
         );
     }
     case GATE_BIN:
@@ -151,7 +167,8 @@ ModelHelper *create_model_helper(ModelName model_name,
             opt_,
             en_debug,
             en_timing,
-            do_normalize
+            do_normalize,
+            init
         );
     }
     // not sure about the utility of this enum
@@ -160,7 +177,7 @@ ModelHelper *create_model_helper(ModelName model_name,
     {
         if (model_category == OBJECT_DETECTION)
         {
-            return new GenericObjectDetectionModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize);
+            return new GenericObjectDetectionModelHelper(model, labels_in_use, opt_, en_debug, en_timing, do_normalize, init);
         }
         else
         {
@@ -171,9 +188,20 @@ ModelHelper *create_model_helper(ModelName model_name,
     fprintf(stderr, "Unsupported model\n");
     return nullptr;
 }
+
+ModelHelper *create_model_helper(ModelName model_name,
+                                 ModelCategory model_category,
+                                 DelegateOpt opt_,
+                                 NormalizationType do_normalize,
+                                 const helper_init_t &init)
+{
+    return new_model_helper(model_name, model_category, opt_, do_normalize, init);
+}
+
 ModelHelper::ModelHelper(char *model_file, char *labels_file,
                          DelegateOpt delegate_choice, bool _en_debug,
-                         bool _en_timing, NormalizationType _do_normalize)
+                         bool _en_timing, NormalizationType _do_normalize,
+                         const helper_init_t &init)
 {
     // Set the member variables
     en_debug = _en_debug;
@@ -181,41 +209,148 @@ ModelHelper::ModelHelper(char *model_file, char *labels_file,
     do_normalize = _do_normalize;
     hardware_selection = delegate_choice;
     labels_location = labels_file;
+    model_path = model_file;
+    ch_offset = init.channel_offset;
+    scene_gate.configure(scene_change_threshold, scene_change_max_interval_s);
 
-    // Load the model
-    model = tflite::FlatBufferModel::BuildFromFile(model_file);
-    if (!model)
+    // extra cameras run on the first camera's interpreter, one copy of the
+    // weights and one delegate for all of them
+    if (init.share_interpreter_of != nullptr)
+    {
+        interpreter_owner = init.share_interpreter_of;
+        interpreter = interpreter_owner->interpreter;
+    }
+    else
     {
-        fprintf(stderr, "FATAL: Failed to mmap model %s\n", model_file);
-        exit(-1);
+        // Load the model
+        model = tflite::FlatBufferModel::BuildFromFile(model_file);
+        if (!model)
+        {
+            fprintf(stderr, "FATAL: Failed to mmap model %s\n", model_file);
+            exit(-1);
+        }
+
+        if (en_debug)
+            printf("Loaded model %s\n", model_file);
+
+        // Resolve the reporter
+        model->error_reporter();
+        if (en_debug)
+            printf("Resolved reporter\n");
+
+        if (!build_interpreter())
+            exit(-1);
     }
 
-    if (en_debug)
-        printf("Loaded model %s\n", model_file);
+    // Get model-specific parameters
+    TfLiteIntArray *dims = interpreter->tensor(interpreter->inputs()[0])->dims;
+    model_height = dims->data[1];
+    model_width = dims->data[2];
+    model_channels = dims->data[3];
+
+    camera_queue.size = init.queue_size;
+    camera_queue.queue = new TFLiteMessage[camera_queue.size];
+
+    if (nms_method_from_string(nms_method, &nms_params.method))
+        fprintf(stderr, "WARNING: unknown nms_method %s, using hard\n", nms_method);
+    nms_params.class_aware = nms_class_aware;
+    nms_params.top_k = nms_top_k;
+
+    if (overlay_width > 0 || overlay_jpeg)
+        image_publisher = new ImagePublisher(out_ch(IMAGE_CH), overlay_width, overlay_jpeg,
+                                             overlay_jpeg_quality);
+
+    if (interpreter_owner == nullptr)
+        printf("Successfully built interpreter\n");
+}
+
+int TFLiteCamQueue::begin_write()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    int slot = (newest + 1) % size;
+    if (slot == in_use)
+        slot = (slot + 1) % size;
+    return slot;
+}
+
+void TFLiteCamQueue::end_write(int slot)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    newest = slot;
+    written++;
+}
+
+void TFLiteCamQueue::release()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    in_use = -1;
+}
+
+bool ModelHelper::has_clients() const
+{
+    static const int channels[] = {IMAGE_CH, DETECTION_CH, DEPTH_CH, POINT_CLOUD_CH,
+                                   GATE_ESTIMATE_CH, TRACK_CH, STEREO_CH};
+    for (int ch : channels)
+    {
+        if (pipe_server_get_num_clients(out_ch(ch)) > 0)
+            return true;
+    }
+    return false;
+}
 
-    // Resolve the reporter
-    model->error_reporter();
-    if (en_debug)
-        printf("Resolved reporter\n");
+ModelHelper::~ModelHelper()
+{
+    delete image_publisher;
+    release_pool();
+    release_interpreter();
+    release_variants();
+    delete[] camera_queue.queue;
+    discard_pending_input();
+    free(resize_output);
+    free(map.L);
+}
 
+bool ModelHelper::build_interpreter(int width, int height)
+{
     // Build the interpreter
-    tflite::InterpreterBuilder(*model, resolver)(&interpreter);
-    if (!interpreter)
+    std::unique_ptr<tflite::Interpreter> built;
+    tflite::InterpreterBuilder(*model, resolver)(&built);
+    if (!built)
     {
         fprintf(stderr, "Failed to construct interpreter\n");
-        exit(-1);
+        return false;
     }
+    interpreter = std::move(built);
 
     // Set multi-threading
 #ifdef BUILD_QRB5165
-    interpreter->SetNumThreads(8);
+    interpreter->SetNumThreads(num_threads > 0 ? num_threads : 8);
 #else
-    interpreter->SetNumThreads(4);
+    interpreter->SetNumThreads(num_threads > 0 ? num_threads : 4);
 #endif
 
     // Allow FP16 precision loss
     interpreter->SetAllowFp16PrecisionForFp32(true);
 
+    // models exported with a dynamic input (movenet multipose is 1x1x1x3)
+    // get a fixed resolution before the delegate sees the graph
+    const int input_index = interpreter->inputs()[0];
+    const TfLiteIntArray *input_dims = interpreter->tensor(input_index)->dims;
+    if (width > 0 && height > 0)
+    {
+        interpreter->ResizeInputTensor(input_index, {1, height, width, input_dims->data[3]});
+    }
+    else if (input_dims->size == 4 && input_dims->data[1] <= 1 && input_dims->data[2] <= 1)
+    {
+        interpreter->ResizeInputTensor(input_index, {1, DYNAMIC_INPUT_SIZE,
+                                                     DYNAMIC_INPUT_SIZE, input_dims->data[3]});
+    }
+
+    // every input size compiles to its own gpu kernels
+    gpu_model_token = model_path.substr(model_path.rfind('/') + 1);
+    if (width > 0 && height > 0)
+        gpu_model_token += "_" + std::to_string(width) + "x" + std::to_string(height);
+
     // Setup optional hardware delegate
     setupDelegate(hardware_selection);
 
@@ -223,60 +358,349 @@ ModelHelper::ModelHelper(char *model_file, char *labels_file,
     if (interpreter->AllocateTensors() != kTfLiteOk)
     {
         fprintf(stderr, "Failed to allocate tensors!\n");
-        exit(-1);
+        return false;
     }
+    return true;
+}
 
-    // Get model-specific parameters
-    TfLiteIntArray *dims = interpreter->tensor(interpreter->inputs()[0])->dims;
-    model_height = dims->data[1];
-    model_width = dims->data[2];
-    model_channels = dims->data[3];
+static void destroy_variant(interpreter_variant_t &v)
+{
+    // the interpreter has to go before the delegates it was modified with
+    v.interpreter.reset();
 
-    printf("Successfully built interpreter\n");
+    if (v.gpu_delegate != nullptr)
+    {
+        TfLiteGpuDelegateV2Delete(v.gpu_delegate);
+        v.gpu_delegate = nullptr;
+    }
+#ifdef BUILD_QRB5165
+    if (v.xnnpack_delegate != nullptr)
+    {
+        TfLiteXNNPackDelegateDelete(v.xnnpack_delegate);
+        v.xnnpack_delegate = nullptr;
+    }
+    delete v.nnapi_delegate;
+    v.nnapi_delegate = nullptr;
+#endif
 }
 
-bool ModelHelper::preprocess(camera_image_metadata_t &meta,
-                             char *frame, std::shared_ptr<cv::Mat> preprocessed_image,
-                             std::shared_ptr<cv::Mat> output_image)
+void ModelHelper::release_interpreter()
 {
-    start_time = rc_nanos_monotonic_time();
-    num_frames_processed++;
+    interpreter_variant_t active = {};
+    stash_interpreter(active);
+    destroy_variant(active);
+}
+
+void ModelHelper::stash_interpreter(interpreter_variant_t &v)
+{
+    v.interpreter = std::move(interpreter);
+    v.gpu_delegate = gpu_delegate;
+    gpu_delegate = nullptr;
+#ifdef BUILD_QRB5165
+    v.xnnpack_delegate = xnnpack_delegate;
+    xnnpack_delegate = nullptr;
+    v.nnapi_delegate = nnapi_delegate;
+    nnapi_delegate = nullptr;
+#endif
+}
 
-    // initialize the resize map on first frame received only
-    if (num_frames_processed == 1)
+void ModelHelper::load_interpreter(interpreter_variant_t &v)
+{
+    interpreter = std::move(v.interpreter);
+    gpu_delegate = v.gpu_delegate;
+    v.gpu_delegate = nullptr;
+#ifdef BUILD_QRB5165
+    xnnpack_delegate = v.xnnpack_delegate;
+    v.xnnpack_delegate = nullptr;
+    nnapi_delegate = v.nnapi_delegate;
+    v.nnapi_delegate = nullptr;
+#endif
+}
+
+void ModelHelper::release_variants()
+{
+    for (interpreter_variant_t &v : variants)
+        destroy_variant(v);
+}
+
+bool ModelHelper::prepare_interpreter_pool(int extra)
+{
+    if (!can_pool())
     {
-        mcv_init_resize_map(meta.width, meta.height, model_width, model_height,
-                            &map);
-        input_height = meta.height;
-        input_width = meta.width;
+        fprintf(stderr, "WARNING: interpreter_pool is off with tiling, roi, the tracker, stereo "
+                        "or input_scale_levels\n");
+        return false;
+    }
 
-        if (meta.format == IMAGE_FORMAT_RAW8)
+    pool_extra = build_pool(extra);
+    if (pool_extra == 0)
+        return false;
+
+    printf("Interpreter pool:");
+    for (const pool_slot_t &slot : pool)
+        printf(" %s", delegate_names[slot.backend]);
+    printf("\n");
+    return true;
+}
+
+int ModelHelper::build_pool(int extra)
+{
+    pool.clear();
+    pool.emplace_back();
+    pool[0].v.interpreter = interpreter;
+    pool[0].backend = hardware_selection;
+
+    // the others are built through the active members like the input
+    // variants and moved out into their slots
+    interpreter_variant_t own = {};
+    stash_interpreter(own);
+    const DelegateOpt own_delegate = hardware_selection;
+    hardware_selection = delegate_from_string(interpreter_pool_delegate);
+    num_threads = interpreter_pool_threads;
+
+    for (int i = 0; i < extra; i++)
+    {
+        if (!build_interpreter())
         {
-            resize_output =
-                (uint8_t *)malloc(model_height * model_width * sizeof(uint8_t));
+            fprintf(stderr, "WARNING: failed to build pool interpreter %d\n", i + 1);
+            release_interpreter();
+            break;
         }
-        else
+        pool.emplace_back();
+        pool.back().backend = hardware_selection;
+        stash_interpreter(pool.back().v);
+    }
+
+    hardware_selection = own_delegate;
+    num_threads = 0;
+    load_interpreter(own);
+    pool_start_ns = rc_nanos_monotonic_time();
+
+    const int built = (int)pool.size() - 1;
+    if (built == 0)
+        pool.clear();
+    return built;
+}
+
+void ModelHelper::release_pool()
+{
+    // slot 0 only holds a reference to our own interpreter
+    for (size_t i = 1; i < pool.size(); i++)
+        destroy_variant(pool[i].v);
+    pool.clear();
+}
+
+bool ModelHelper::prepare_input_variants(int levels)
+{
+    variant_levels = levels;
+    variants.clear();
+    variants.emplace_back();
+    variants[0].width = model_width;
+    variants[0].height = model_height;
+    active_variant = 0;
+
+    // the model's own interpreter stays built, the others are built in turn
+    // through the active members and moved out into their slots
+    interpreter_variant_t native = {};
+    stash_interpreter(native);
+
+    for (int i = 1; i < levels; i++)
+    {
+        const float scale = 1.0f - i * INPUT_SCALE_STEP;
+        const int w = (int)(model_width * scale + INPUT_SCALE_ALIGN / 2) / INPUT_SCALE_ALIGN * INPUT_SCALE_ALIGN;
+        const int h = (int)(model_height * scale + INPUT_SCALE_ALIGN / 2) / INPUT_SCALE_ALIGN * INPUT_SCALE_ALIGN;
+        if (w < INPUT_SCALE_MIN || h < INPUT_SCALE_MIN)
+            break;
+        if (w == variants.back().width && h == variants.back().height)
+            continue;
+
+        // a resolution only counts once the graph resized to it has run,
+        // which also gets the delegate's kernels compiled ahead of time
+        bool valid = build_interpreter(w, h);
+        if (valid)
+        {
+            TfLiteTensor *input = interpreter->tensor(interpreter->inputs()[0]);
+            valid = input->dims->data[1] == h && input->dims->data[2] == w;
+            if (valid)
+            {
+                memset(input->data.raw, 0, input->bytes);
+                valid = interpreter->Invoke() == kTfLiteOk;
+            }
+        }
+        if (!valid)
         {
-            resize_output = (uint8_t *)malloc(model_height * model_width *
-                                              sizeof(uint8_t) * 3);
+            fprintf(stderr, "WARNING: model doesn't run at %dx%d, leaving that input size out\n", w, h);
+            release_interpreter();
+            continue;
         }
+
+        variants.emplace_back();
+        variants.back().width = w;
+        variants.back().height = h;
+        stash_interpreter(variants.back());
+    }
+
+    load_interpreter(native);
+
+    std::vector<float> cost;
+    printf("Input sizes:");
+    for (const interpreter_variant_t &v : variants)
+    {
+        cost.push_back((float)v.width * v.height);
+        printf(" %dx%d", v.width, v.height);
+    }
+    printf(", latency budget %.1fms\n", (double)latency_budget_ms);
+    governor.configure(latency_budget_ms, cost);
+
+    return variants.size() > 1;
+}
+
+void ModelHelper::adapt_input_size(double last_inference_ms)
+{
+    if (variants.size() < 2)
+        return;
+
+    const int level = governor.update(last_inference_ms);
+    if (level == active_variant)
+        return;
+
+    std::lock_guard<std::shared_timed_mutex> lock(lifecycle_mutex);
+    if (resources_released)
+        return;
+
+    stash_interpreter(variants[active_variant]);
+    load_interpreter(variants[level]);
+    active_variant = level;
+    model_width = variants[level].width;
+    model_height = variants[level].height;
+
+    // resize map and buffer get rebuilt for the new size from the next frame
+    free(resize_output);
+    resize_output = nullptr;
+    free(map.L);
+    map.L = nullptr;
+    input_generation++;
+    input_size_changed();
+
+    printf("Input size %dx%d, inference at %.1fms for a %.1fms budget\n", model_width,
+           model_height, last_inference_ms, (double)latency_budget_ms);
+}
+
+void ModelHelper::release_resources()
+{
+    std::lock_guard<std::shared_timed_mutex> lock(lifecycle_mutex);
+    if (resources_released)
+        return;
+
+    // the pool holds a reference to our interpreter and goes first
+    release_pool();
+    release_interpreter();
+    release_variants();
+
+    // back to the model's own input size, the variants are rebuilt on restore
+    if (active_variant != 0)
+    {
+        active_variant = 0;
+        model_width = variants[0].width;
+        model_height = variants[0].height;
+        input_generation++;
+        input_size_changed();
+    }
+    governor.reset();
+
+    // the frame queue is by far the largest allocation we hold
+    delete[] camera_queue.queue;
+    camera_queue.queue = nullptr;
+    {
+        std::lock_guard<std::mutex> queue_lock(camera_queue.mutex);
+        camera_queue.newest = -1;
+    }
+
+    // resize map and buffer get rebuilt from the next frame received, a
+    // build still running is for a pipeline that is going away
+    discard_pending_input();
+    free(resize_output);
+    resize_output = nullptr;
+    free(map.L);
+    map.L = nullptr;
+
+    resources_released = true;
+}
+
+bool ModelHelper::restore_resources()
+{
+    std::lock_guard<std::shared_timed_mutex> lock(lifecycle_mutex);
+    if (!resources_released)
+        return true;
+
+    // the owner is restored first, borrowers pick its new interpreter up
+    if (interpreter_owner != nullptr)
+    {
+        if (!interpreter_owner->interpreter)
+            return false;
+        interpreter = interpreter_owner->interpreter;
+    }
+    else if (!build_interpreter())
+    {
+        release_interpreter();
         return false;
     }
-    // if color input provided, make sure that is reflected in output image
+    if (variant_levels > 1 && !prepare_input_variants(variant_levels))
+        fprintf(stderr, "WARNING: no smaller input size runs after restoring, staying at %dx%d\n",
+                model_width, model_height);
+
+    // the pipeline runs a thread per pool slot, the pool has to come back
+    // at the size it started with. Anything built so far goes with it
+    if (pool_extra > 0 && build_pool(pool_extra) != pool_extra)
+    {
+        release_pool();
+        release_interpreter();
+        release_variants();
+        return false;
+    }
+    camera_queue.queue = new TFLiteMessage[camera_queue.size];
+    resources_released = false;
+    return true;
+}
+
+bool ModelHelper::preprocess(camera_image_metadata_t &meta,
+                             char *frame, std::shared_ptr<cv::Mat> preprocessed_image,
+                             std::shared_ptr<cv::Mat> output_image)
+{
+    start_time = rc_nanos_monotonic_time();
+    num_frames_processed++;
+
+    // frames are dropped until the resize map and buffer for the stream
+    // geometry are ready
+    if (!input_ready(meta))
+        return false;
+
+    // if color input provided, make sure that is reflected in output image.
+    // A null output_image means nobody will see the overlay for this frame,
+    // so skip building the full resolution rgb image wherever we can
     switch (meta.format)
     {
     case IMAGE_FORMAT_STEREO_NV12:
         meta.format = IMAGE_FORMAT_NV12;
     case IMAGE_FORMAT_NV12:
     {
-        cv::Mat yuv(input_height + input_height / 2, input_width, CV_8UC1,
-                    (uchar *)frame);
-        cv::cvtColor(yuv, *output_image, CV_YUV2RGB_NV12);
-        mcv_resize_8uc3_image(output_image->data, resize_output, &map);
-        cv::Mat holder(model_height, model_width, CV_8UC3,
-                       (uchar *)resize_output);
-
-        *preprocessed_image = holder;
+        // every frame in flight gets its own model input, the pool's
+        // inference threads and postprocess read it after the next frame
+        // was preprocessed
+        preprocessed_image->create(model_height, model_width, CV_8UC3);
+        if (output_image)
+        {
+            cv::Mat yuv(input_height + input_height / 2, input_width, CV_8UC1,
+                        (uchar *)frame);
+            cv::cvtColor(yuv, *output_image, CV_YUV2RGB_NV12);
+            mcv_resize_8uc3_image(output_image->data, preprocessed_image->data, input_map);
+        }
+        else
+        {
+            mcv_resize_nv12_to_rgb((uint8_t *)frame,
+                                   (uint8_t *)frame + input_width * input_height,
+                                   preprocessed_image->data, input_map, 0);
+        }
         meta.format = IMAGE_FORMAT_RGB;
         meta.size_bytes = (meta.height * meta.width * 3);
         meta.stride = (meta.width * 3);
@@ -284,15 +708,15 @@ bool ModelHelper::preprocess(camera_image_metadata_t &meta,
     break;
     case IMAGE_FORMAT_YUV422:
     {
+        // no fused path for yuyv, convert into a scratch image if not rendering
+        cv::Mat rgb;
+        cv::Mat &converted = output_image ? *output_image : rgb;
         cv::Mat yuv(input_height, input_width, CV_8UC2, (uchar *)frame);
-        cv::cvtColor(yuv, *output_image, CV_YUV2RGB_YUYV);
-
-        // Resize to model input dimensions
-        mcv_resize_8uc3_image(output_image->data, resize_output, &map);
-        cv::Mat holder(model_height, model_width, CV_8UC3, (uchar *)resize_output);
+        cv::cvtColor(yuv, converted, CV_YUV2RGB_YUYV);
 
-        // Assign processed image and update meta data
-        *preprocessed_image = holder;
+        // Resize to model input dimensions, into a buffer of its own
+        preprocessed_image->create(model_height, model_width, CV_8UC3);
+        mcv_resize_8uc3_image(converted.data, preprocessed_image->data, input_map);
 
         meta.format = IMAGE_FORMAT_RGB;
         meta.size_bytes = (meta.height * meta.width * 3);
@@ -303,14 +727,20 @@ bool ModelHelper::preprocess(camera_image_metadata_t &meta,
         meta.format = IMAGE_FORMAT_NV21;
     case IMAGE_FORMAT_NV21:
     {
-        cv::Mat yuv(input_height + input_height / 2, input_width, CV_8UC1,
-                    (uchar *)frame);
-        cv::cvtColor(yuv, *output_image, CV_YUV2RGB_NV21);
-        mcv_resize_8uc3_image(output_image->data, resize_output, &map);
-        cv::Mat holder(model_height, model_width, CV_8UC3,
-                       (uchar *)resize_output);
-
-        *preprocessed_image = holder;
+        preprocessed_image->create(model_height, model_width, CV_8UC3);
+        if (output_image)
+        {
+            cv::Mat yuv(input_height + input_height / 2, input_width, CV_8UC1,
+                        (uchar *)frame);
+            cv::cvtColor(yuv, *output_image, CV_YUV2RGB_NV21);
+            mcv_resize_8uc3_image(output_image->data, preprocessed_image->data, input_map);
+        }
+        else
+        {
+            mcv_resize_nv12_to_rgb((uint8_t *)frame,
+                                   (uint8_t *)frame + input_width * input_height,
+                                   preprocessed_image->data, input_map, 1);
+        }
 
         meta.format = IMAGE_FORMAT_RGB;
         meta.size_bytes = (meta.height * meta.width * 3);
@@ -322,13 +752,17 @@ bool ModelHelper::preprocess(camera_image_metadata_t &meta,
         meta.format = IMAGE_FORMAT_RAW8;
     case IMAGE_FORMAT_RAW8:
     {
-        *output_image =
-            cv::Mat(input_height, input_width, CV_8UC1, (uchar *)frame);
-
         // resize to model input dims
-        mcv_resize_image(output_image->data, resize_output, &map);
+        mcv_resize_image((uint8_t *)frame, resize_output, input_map);
+
+        // raw8 frames are published as-is. The overlay is drawn in
+        // postprocess, after the camera queue slot went back to the callback
+        if (output_image)
+            *output_image =
+                cv::Mat(input_height, input_width, CV_8UC1, (uchar *)frame).clone();
 
-        // stack resized input to make "3 channel" grayscale input
+        // stack resized input to make "3 channel" grayscale input, merge
+        // copies it out of the scratch buffer
         cv::Mat holder(model_height, model_width, CV_8UC1,
                        (uchar *)resize_output);
         cv::Mat in[] = {holder, holder, holder};
@@ -343,6 +777,18 @@ bool ModelHelper::preprocess(camera_image_metadata_t &meta,
         return false;
     }
 
+    // results are in the corrected view, so the overlay has to show it too
+    if (input_corrected && output_image && !output_image->empty())
+    {
+        cv::Mat corrected;
+        cv::remap(*output_image, corrected, overlay_map1, overlay_map2, cv::INTER_LINEAR);
+        *output_image = corrected;
+        meta.width = corrected.cols;
+        meta.height = corrected.rows;
+        meta.stride = corrected.cols * corrected.channels();
+        meta.size_bytes = meta.stride * meta.height;
+    }
+
     if (en_timing)
         total_preprocess_time +=
             ((rc_nanos_monotonic_time() - start_time) / 1000000.);
@@ -350,6 +796,230 @@ bool ModelHelper::preprocess(camera_image_metadata_t &meta,
     return true;
 }
 
+// bytes a frame of the stream geometry needs, 0 for formats preprocess
+// doesn't take
+static size_t frame_bytes(const camera_image_metadata_t &meta)
+{
+    const size_t px = (size_t)meta.width * meta.height;
+    switch (meta.format)
+    {
+    case IMAGE_FORMAT_RAW8:
+        return px;
+    case IMAGE_FORMAT_STEREO_RAW8:
+        return px * 2;
+    case IMAGE_FORMAT_NV12:
+    case IMAGE_FORMAT_NV21:
+        return px * 3 / 2;
+    case IMAGE_FORMAT_STEREO_NV12:
+    case IMAGE_FORMAT_STEREO_NV21:
+        return px * 3;
+    case IMAGE_FORMAT_YUV422:
+        return px * 2;
+    default:
+        return 0;
+    }
+}
+
+bool ModelHelper::input_ready(const camera_image_metadata_t &meta)
+{
+    if (resize_output != nullptr && meta.width == input_width &&
+        meta.height == input_height && meta.format == input_format)
+        return true;
+
+    // built and waiting for the preprocess thread to swap it in
+    if (input_state_ready)
+        return false;
+
+    if (input_build_thread.joinable())
+    {
+        if (!input_build_done)
+            return false;
+        input_build_thread.join();
+
+        const input_state_t &s = pending_input;
+        if (s.width == meta.width && s.height == meta.height && s.format == meta.format &&
+            s.model_width == model_width && s.model_height == model_height &&
+            s.resize_output != nullptr)
+        {
+            input_state_ready = true;
+            return false;
+        }
+
+        // the stream or the model size moved on while it was being built
+        discard_pending_input();
+    }
+
+    const size_t needed = frame_bytes(meta);
+    if (needed == 0 || meta.size_bytes < 0 || (size_t)meta.size_bytes < needed)
+    {
+        fprintf(stderr, "ERROR: %dx%d frame of format %d has %d bytes, dropping it\n",
+                meta.width, meta.height, meta.format, (int)meta.size_bytes);
+        return false;
+    }
+
+    if (input_format >= 0)
+        printf("Stream changed to %dx%d format %d, rebuilding input maps\n",
+               meta.width, meta.height, meta.format);
+
+    pending_input.width = meta.width;
+    pending_input.height = meta.height;
+    pending_input.format = meta.format;
+    pending_input.model_width = model_width;
+    pending_input.model_height = model_height;
+    input_build_done = false;
+    input_build_thread = std::thread([this] {
+        build_input_state(pending_input);
+        input_build_done = true;
+    });
+    return false;
+}
+
+void ModelHelper::build_input_state(input_state_t &s)
+{
+    if (input_undistort || input_rotation != 0 || input_flip)
+        build_corrected_map(s);
+
+    // plain resize, also what's left if the correction couldn't be built
+    if (s.map.L == nullptr && letterbox)
+        mcv_init_letterbox_resize_map(s.width, s.height, 0, 0, s.width, s.height,
+                                      s.model_width, s.model_height, LETTERBOX_PAD, &s.map);
+    else if (s.map.L == nullptr)
+        mcv_init_resize_map(s.width, s.height, s.model_width, s.model_height, &s.map);
+    if (s.map.L == nullptr)
+        return;
+
+    // scratch plane for raw8, the rgb paths resize straight into each
+    // frame's own model input
+    s.resize_output = (uint8_t *)malloc(s.model_width * s.model_height);
+}
+
+void ModelHelper::swap_input_state(input_state_t &s)
+{
+    std::swap(input_width, s.width);
+    std::swap(input_height, s.height);
+    std::swap(input_format, s.format);
+    std::swap(map, s.map);
+    std::swap(resize_output, s.resize_output);
+    std::swap(input_corrected, s.corrected);
+    std::swap(has_corrected_cal, s.has_corrected_cal);
+    std::swap(corrected_cal, s.corrected_cal);
+    std::swap(overlay_map1, s.overlay_map1);
+    std::swap(overlay_map2, s.overlay_map2);
+}
+
+void ModelHelper::discard_pending_input()
+{
+    if (input_build_thread.joinable())
+        input_build_thread.join();
+    input_state_ready = false;
+
+    free(pending_input.resize_output);
+    free(pending_input.map.L);
+    pending_input = input_state_t();
+}
+
+void ModelHelper::install_input_state()
+{
+    if (!input_state_ready)
+        return;
+
+    std::lock_guard<std::shared_timed_mutex> lock(lifecycle_mutex);
+    if (!input_state_ready)
+        return; // discarded by release_resources() meanwhile
+
+    input_state_ready = false;
+    if (resources_released || pending_input.model_width != model_width ||
+        pending_input.model_height != model_height)
+    {
+        discard_pending_input();
+        return;
+    }
+
+    // pending_input gets the old state, which nothing can be using anymore
+    swap_input_state(pending_input);
+    discard_pending_input();
+    input_generation++;
+    input_size_changed();
+}
+
+void ModelHelper::build_corrected_map(input_state_t &s)
+{
+    input_correction_t corr = {input_undistort, input_rotation, input_flip};
+
+    camera_calibration_t cal;
+    if (corr.undistort && camera_calibration_load(cam_name.c_str(), &cal))
+    {
+        fprintf(stderr, "WARNING: input of %s is not undistorted\n", cam_name.c_str());
+        corr.undistort = false;
+    }
+
+    int cw, ch;
+    camera_correction_size(&corr, s.width, s.height, &cw, &ch);
+    int u0 = 0, v0 = 0, w_fit = s.model_width, h_fit = s.model_height;
+    if (letterbox)
+        mcv_letterbox_fit(cw, ch, s.model_width, s.model_height, &u0, &v0, &w_fit, &h_fit);
+
+    // undistortion, rotation, flip and scaling all end up in the one map,
+    // the resize kernels don't know the difference
+    std::vector<float> fit_x(w_fit * h_fit), fit_y(w_fit * h_fit);
+    camera_calibration_build_remap(corr.undistort ? &cal : nullptr, &corr, s.width,
+                                   s.height, w_fit, h_fit, fit_x.data(), fit_y.data(),
+                                   &s.corrected_cal);
+    std::vector<float> src_x(s.model_width * s.model_height, -1.0f);
+    std::vector<float> src_y(s.model_width * s.model_height, -1.0f);
+    for (int v = 0; v < h_fit; v++)
+    {
+        memcpy(&src_x[(v + v0) * s.model_width + u0], &fit_x[v * w_fit], w_fit * sizeof(float));
+        memcpy(&src_y[(v + v0) * s.model_width + u0], &fit_y[v * w_fit], w_fit * sizeof(float));
+    }
+    if (mcv_init_remap(s.width, s.height, s.model_width, s.model_height, src_x.data(),
+                       src_y.data(), LETTERBOX_PAD, &s.map))
+        return;
+
+    // results map back to the corrected view at input resolution
+    const float x_r = (float)(cw - 1) / w_fit;
+    const float y_r = (float)(ch - 1) / h_fit;
+    s.map.T = {-u0 * x_r, -v0 * y_r, s.model_width * x_r, s.model_height * y_r};
+    s.corrected = true;
+    s.has_corrected_cal = corr.undistort;
+
+    // the overlay gets the same correction, only on frames that render
+    std::vector<float> overlay_x(cw * ch), overlay_y(cw * ch);
+    camera_calibration_build_remap(corr.undistort ? &cal : nullptr, &corr, s.width,
+                                   s.height, cw, ch, overlay_x.data(), overlay_y.data(),
+                                   nullptr);
+    cv::convertMaps(cv::Mat(ch, cw, CV_32FC1, overlay_x.data()),
+                    cv::Mat(ch, cw, CV_32FC1, overlay_y.data()),
+                    s.overlay_map1, s.overlay_map2, CV_16SC2);
+
+    printf("Correcting input of %s:%s rotation %d%s\n", cam_name.c_str(),
+           corr.undistort ? " undistorted," : "", corr.rotation, corr.flip ? ", flipped" : "");
+}
+
+bool ModelHelper::should_render_output(const camera_image_metadata_t &meta)
+{
+    if (pipe_server_get_num_clients(out_ch(IMAGE_CH)) <= 0)
+        return false;
+
+    // overlay rate is decoupled from the detection rate
+    if (overlay_rate_hz > 0.0f &&
+        meta.timestamp_ns - last_render_ns < (int64_t)(1e9 / overlay_rate_hz))
+        return false;
+
+    last_render_ns = meta.timestamp_ns;
+    return true;
+}
+
+void ModelHelper::publish_output_image(camera_image_metadata_t meta,
+                                       const cv::Mat &image)
+{
+    meta.timestamp_ns = rc_nanos_monotonic_time();
+    if (image_publisher != nullptr)
+        image_publisher->publish(meta, image);
+    else
+        pipe_server_write_camera_frame(out_ch(IMAGE_CH), meta, (char *)image.data);
+}
+
 void ModelHelper::setupDelegate(DelegateOpt delegate_choice)
 {
     switch (delegate_choice)
@@ -358,7 +1028,7 @@ void ModelHelper::setupDelegate(DelegateOpt delegate_choice)
 #ifdef BUILD_QRB5165
     {
         TfLiteXNNPackDelegateOptions xnnpack_options = TfLiteXNNPackDelegateOptionsDefault();
-        xnnpack_options.num_threads = 8;
+        xnnpack_options.num_threads = num_threads > 0 ? num_threads : 8;
         xnnpack_delegate = TfLiteXNNPackDelegateCreate(&xnnpack_options);
         if (interpreter->ModifyGraphWithDelegate(xnnpack_delegate) != kTfLiteOk)
             fprintf(stderr, "Failed to apply XNNPACK delegate\n");
@@ -371,6 +1041,16 @@ void ModelHelper::setupDelegate(DelegateOpt delegate_choice)
         TfLiteGpuDelegateOptionsV2 gpu_opts = TfLiteGpuDelegateOptionsV2Default();
         gpu_opts.inference_preference = TFLITE_GPU_INFERENCE_PREFERENCE_SUSTAINED_SPEED;
         gpu_opts.inference_priority1 = TFLITE_GPU_INFERENCE_PRIORITY_MIN_LATENCY;
+
+        // cache compiled kernels on disk, keyed by model file name, so that
+        // rebuilding the delegate after an idle release doesn't recompile
+        if (gpu_cache_dir[0] != '\0' &&
+            (mkdir(gpu_cache_dir, 0755) == 0 || errno == EEXIST))
+        {
+            gpu_opts.experimental_flags |= TFLITE_GPU_EXPERIMENTAL_FLAGS_ENABLE_SERIALIZATION;
+            gpu_opts.serialization_dir = gpu_cache_dir;
+            gpu_opts.model_token = gpu_model_token.c_str();
+        }
         gpu_delegate = TfLiteGpuDelegateV2Create(&gpu_opts);
         if (interpreter->ModifyGraphWithDelegate(gpu_delegate) != kTfLiteOk)
             fprintf(stderr, "Failed to apply GPU delegate\n");
@@ -405,16 +1085,80 @@ bool ModelHelper::run_inference(cv::Mat &preprocessed_image,
                                 double *last_inference_time)
 {
     start_time = rc_nanos_monotonic_time();
+
+    if (!fill_input(preprocessed_image))
+        return false;
+
+    if (interpreter->Invoke() != kTfLiteOk)
+    {
+        fprintf(stderr, "FATAL: Failed to invoke tflite!\n");
+        return false;
+    }
+
+    int64_t end_time = rc_nanos_monotonic_time();
+
+    if (en_timing)
+        total_inference_time += ((end_time - start_time) / 1000000.);
+    if (last_inference_time != nullptr)
+        *last_inference_time = ((double)(end_time - start_time) / 1000000.);
+
+    return true;
+}
+
+bool ModelHelper::run_inference_on(int slot, const cv::Mat &preprocessed_image,
+                                   double *last_inference_time)
+{
+    pool_slot_t &s = pool_owner()->pool[slot];
+    const int64_t start = rc_nanos_monotonic_time();
+
+    if (!fill_input(s.v.interpreter.get(), preprocessed_image))
+        return false;
+
+    if (s.v.interpreter->Invoke() != kTfLiteOk)
+    {
+        fprintf(stderr, "FATAL: Failed to invoke tflite!\n");
+        return false;
+    }
+
+    const int64_t ns = rc_nanos_monotonic_time() - start;
+    const double ms = ns / 1000000.;
+    s.frames++;
+    s.total_ms += ms;
+    if (en_timing)
+        pool_inference_ns += ns;
+    if (last_inference_time != nullptr)
+        *last_inference_time = ms;
+
+    return true;
+}
+
+bool ModelHelper::slot_on_accelerator(int slot)
+{
+    ModelHelper *owner = pool_owner();
+    if (slot < (int)owner->pool.size())
+        return owner->pool[slot].backend != XNNPACK;
+    return owner->hardware_selection != XNNPACK;
+}
+
+void ModelHelper::select_interpreter(int slot)
+{
+    ModelHelper *owner = pool_owner();
+    if (slot < (int)owner->pool.size())
+        interpreter = owner->pool[slot].v.interpreter;
+}
+
+bool ModelHelper::fill_input(tflite::Interpreter *interp, const cv::Mat &preprocessed_image)
+{
     // Get input dimension from the input tensor metadata assuming one input
     // only
-    int input = interpreter->inputs()[0];
+    int input = interp->inputs()[0];
 
     // manually fill tensor with image data, specific to input format
-    switch (interpreter->tensor(input)->type)
+    switch (interp->tensor(input)->type)
     {
     case kTfLiteFloat32:
     {
-        float *dst = TensorData<float>(interpreter->tensor(input), 0);
+        float *dst = TensorData<float>(interp->tensor(input), 0);
         const int row_elems = model_width * model_channels;
         for (int row = 0; row < model_height; row++)
         {
@@ -436,7 +1180,7 @@ bool ModelHelper::run_inference(cv::Mat &preprocessed_image,
 
     case kTfLiteInt8:
     {
-        int8_t *dst = TensorData<int8_t>(interpreter->tensor(input), 0);
+        int8_t *dst = TensorData<int8_t>(interp->tensor(input), 0);
         const int row_elems = model_width * model_channels;
         for (int row = 0; row < model_height; row++)
         {
@@ -452,11 +1196,11 @@ bool ModelHelper::run_inference(cv::Mat &preprocessed_image,
 
     case kTfLiteUInt8:
     {
-        uint8_t *dst = TensorData<uint8_t>(interpreter->tensor(input), 0);
+        uint8_t *dst = TensorData<uint8_t>(interp->tensor(input), 0);
         int row_elems = model_width * model_channels;
         for (int row = 0; row < model_height; row++)
         {
-            uchar *row_ptr = preprocessed_image.ptr(row);
+            const uchar *row_ptr = preprocessed_image.ptr(row);
             for (int i = 0; i < row_elems; i++)
             {
                 dst[i] = row_ptr[i];
@@ -471,19 +1215,6 @@ bool ModelHelper::run_inference(cv::Mat &preprocessed_image,
         return false;
     }
 
-    if (interpreter->Invoke() != kTfLiteOk)
-    {
-        fprintf(stderr, "FATAL: Failed to invoke tflite!\n");
-        return false;
-    }
-
-    int64_t end_time = rc_nanos_monotonic_time();
-
-    if (en_timing)
-        total_inference_time += ((end_time - start_time) / 1000000.);
-    if (last_inference_time != nullptr)
-        *last_inference_time = ((double)(end_time - start_time) / 1000000.);
-
     return true;
 }
 
@@ -497,13 +1228,23 @@ void ModelHelper::print_summary_stats()
             "Preprocessing Time  -> Total: %6.2fms, Average: %6.2fms\n",
             (double)(total_preprocess_time),
             (double)((total_preprocess_time / (num_frames_processed))));
+    const double inference_time = total_inference_time + pool_inference_ns / 1000000.;
     fprintf(stderr,
             "Inference Time      -> Total: %6.2fms, Average: %6.2fms\n",
-            (double)(total_inference_time),
-            (double)((total_inference_time / (num_frames_processed))));
+            inference_time,
+            inference_time / num_frames_processed);
     fprintf(stderr,
             "Postprocessing Time -> Total: %6.2fms, Average: %6.2fms\n",
             (double)(total_postprocess_time),
             (double)((total_postprocess_time / (num_frames_processed))));
+    if (pool.size() > 1)
+    {
+        const double elapsed_s = (rc_nanos_monotonic_time() - pool_start_ns) / 1e9;
+        for (size_t i = 0; i < pool.size(); i++)
+            fprintf(stderr, "Interpreter %zu (%-5s) -> %6.1f fps, Average: %6.2fms\n", i,
+                    delegate_names[pool[i].backend], pool[i].frames / elapsed_s,
+                    pool[i].frames > 0 ? pool[i].total_ms / pool[i].frames : 0.0);
+    }
+    scene_gate.print_stats();
     fprintf(stderr, "------------------------------------------\n");
 }
\ No newline at end of file
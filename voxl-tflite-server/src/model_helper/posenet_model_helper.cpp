@@ -25,54 +25,120 @@ static const std::vector<std::pair<int32_t, int32_t>> kJointLineList{
     {13, 15},
 };
 
+// multipose rows are 17 (y, x, score) keypoints then ymin, xmin, ymax, xmax, score
+#define MULTIPOSE_ROW_LEN 56
+#define MULTIPOSE_BOX_OFFSET 51
+
 PoseNetModelHelper::PoseNetModelHelper(char *model_file, char *labels_file,
                                        DelegateOpt delegate_choice, bool _en_debug,
-                                       bool _en_timing, NormalizationType _do_normalize)
-    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize) {}
+                                       bool _en_timing, NormalizationType _do_normalize,
+                                       const helper_init_t &init)
+    : ModelHelper(model_file, labels_file, delegate_choice, _en_debug, _en_timing, _do_normalize, init)
+{
+    letterbox = letterbox_input;
+}
+
+// keypoints come as (y, x, score) triplets normalized to the model input
+static void decode_keypoints(const float *data, const resize_transform_t &t, ai_pose_t &pose)
+{
+    for (int i = 0; i < AI_POSE_NUM_KEYPOINTS; i++)
+    {
+        pose.keypoints[i].x = t.x + data[i * 3 + 1] * t.w;
+        pose.keypoints[i].y = t.y + data[i * 3] * t.h;
+        pose.keypoints[i].confidence = data[i * 3 + 2];
+    }
+}
+
+void PoseNetModelHelper::decode_single(const float *data)
+{
+    poses.resize(1);
+    ai_pose_t &pose = poses[0];
+    decode_keypoints(data, map.T, pose);
+
+    // no box from singlepose, use the extent of the confident keypoints
+    float sum = 0;
+    pose.x_min = pose.y_min = pose.x_max = pose.y_max = 0;
+    bool first = true;
+    for (const ai_pose_keypoint_t &k : pose.keypoints)
+    {
+        sum += k.confidence;
+        if (k.confidence < confidence_threshold)
+            continue;
+        if (first || k.x < pose.x_min) pose.x_min = k.x;
+        if (first || k.y < pose.y_min) pose.y_min = k.y;
+        if (first || k.x > pose.x_max) pose.x_max = k.x;
+        if (first || k.y > pose.y_max) pose.y_max = k.y;
+        first = false;
+    }
+    pose.score = sum / AI_POSE_NUM_KEYPOINTS;
+}
+
+void PoseNetModelHelper::decode_multi(const float *data, int num_people)
+{
+    poses.clear();
+    for (int p = 0; p < num_people; p++)
+    {
+        const float *row = data + p * MULTIPOSE_ROW_LEN;
+        const float *box = row + MULTIPOSE_BOX_OFFSET;
+        if (box[4] < person_threshold)
+            continue;
+
+        poses.emplace_back();
+        ai_pose_t &pose = poses.back();
+        decode_keypoints(row, map.T, pose);
+        pose.y_min = map.T.y + box[0] * map.T.h;
+        pose.x_min = map.T.x + box[1] * map.T.w;
+        pose.y_max = map.T.y + box[2] * map.T.h;
+        pose.x_max = map.T.x + box[3] * map.T.w;
+        pose.score = box[4];
+    }
+}
 
 bool PoseNetModelHelper::postprocess(cv::Mat &output_image, double last_inference_time, void *input_params)
 {
     start_time = rc_nanos_monotonic_time();
 
-    float confidence_threshold = 0.2;
-
     TfLiteTensor *output_locations =
         interpreter->tensor(interpreter->outputs()[0]);
-    float *pose_tensor = TensorData<float>(output_locations, 0);
+    const float *pose_tensor = TensorData<float>(output_locations, 0);
+    const TfLiteIntArray *dims = output_locations->dims;
 
-    std::vector<int32_t> x_coords;
-    std::vector<int32_t> y_coords;
-    std::vector<float> confidences;
+    if (dims->data[dims->size - 1] == MULTIPOSE_ROW_LEN)
+        decode_multi(pose_tensor, dims->data[dims->size - 2]);
+    else
+        decode_single(pose_tensor);
 
-    for (int i = 0; i < 17; i++)
-    {
-        x_coords.push_back(
-            static_cast<int32_t>(pose_tensor[i * 3 + 1] * input_width));
-        y_coords.push_back(
-            static_cast<int32_t>(pose_tensor[i * 3] * input_height));
-        confidences.push_back(pose_tensor[i * 3 + 2]);
-    }
+    if (en_timing)
+        total_postprocess_time +=
+            ((rc_nanos_monotonic_time() - start_time) / 1000000.);
 
-    for (const auto &jointLine : kJointLineList)
+    // the poses are already decoded for the data pipe, drawing is only for
+    // an image client
+    if (!render_output)
+        return true;
+
+    for (const ai_pose_t &pose : poses)
     {
-        if (confidences[jointLine.first] >= confidence_threshold &&
-            confidences[jointLine.second] >= confidence_threshold)
+        const ai_pose_keypoint_t *k = pose.keypoints;
+        for (const auto &jointLine : kJointLineList)
         {
-            int32_t x0 = x_coords[jointLine.first];
-            int32_t y0 = y_coords[jointLine.first];
-            int32_t x1 = x_coords[jointLine.second];
-            int32_t y1 = y_coords[jointLine.second];
-            cv::line(output_image, cv::Point(x0, y0), cv::Point(x1, y1),
-                     cv::Scalar(200, 200, 200), 2);
+            if (k[jointLine.first].confidence >= confidence_threshold &&
+                k[jointLine.second].confidence >= confidence_threshold)
+            {
+                cv::line(output_image,
+                         cv::Point(k[jointLine.first].x, k[jointLine.first].y),
+                         cv::Point(k[jointLine.second].x, k[jointLine.second].y),
+                         cv::Scalar(200, 200, 200), 2);
+            }
         }
-    }
 
-    for (unsigned int i = 0; i < x_coords.size(); i++)
-    {
-        if (confidences[i] > confidence_threshold)
+        for (int i = 0; i < AI_POSE_NUM_KEYPOINTS; i++)
         {
-            cv::circle(output_image, cv::Point(x_coords[i], y_coords[i]), 4,
-                       cv::Scalar(255, 255, 0), cv::FILLED);
+            if (k[i].confidence > confidence_threshold)
+            {
+                cv::circle(output_image, cv::Point(k[i].x, k[i].y), 4,
+                           cv::Scalar(255, 255, 0), cv::FILLED);
+            }
         }
     }
 
@@ -86,8 +152,34 @@ bool PoseNetModelHelper::worker(cv::Mat &output_image, double last_inference_tim
 {
     if (!postprocess(output_image, last_inference_time, input_params))
         return false;
-    metadata.timestamp_ns = rc_nanos_monotonic_time();
-    pipe_server_write_camera_frame(IMAGE_CH, metadata,
-                                   (char *)output_image.data);
+
+    write_poses(metadata);
+
+    if (render_output)
+        publish_output_image(metadata, output_image);
     return true;
-}
\ No newline at end of file
+}
+
+bool PoseNetModelHelper::republish(const camera_image_metadata_t &meta)
+{
+    write_poses(meta);
+    return true;
+}
+
+void PoseNetModelHelper::write_poses(const camera_image_metadata_t &meta)
+{
+    if (poses.empty())
+        return;
+
+    for (size_t i = 0; i < poses.size(); i++)
+    {
+        ai_pose_t &pose = poses[i];
+        pose.magic_number = AI_POSE_MAGIC_NUMBER;
+        pose.timestamp_ns = meta.timestamp_ns;
+        pose.frame_id = meta.frame_id;
+        pose.person_id = i;
+        memset(pose.cam, 0, BUF_LEN);
+        strncpy(pose.cam, cam_name.c_str(), BUF_LEN - 1);
+    }
+    pipe_server_write(out_ch(DETECTION_CH), (char *)poses.data(), sizeof(ai_pose_t) * poses.size());
+}
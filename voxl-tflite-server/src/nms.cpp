@@ -0,0 +1,365 @@
+#include "nms.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+// cells per side for NMS_GRID, spread over the extent of the candidates
+#define NMS_GRID_CELLS 16
+
+int nms_method_from_string(const char *str, NmsMethod *method)
+{
+    if (!strcmp(str, "hard"))
+        *method = NMS_HARD;
+    else if (!strcmp(str, "grid"))
+        *method = NMS_GRID;
+    else if (!strcmp(str, "soft_linear"))
+        *method = NMS_SOFT_LINEAR;
+    else if (!strcmp(str, "soft_gaussian"))
+        *method = NMS_SOFT_GAUSSIAN;
+    else
+        return -1;
+
+    return 0;
+}
+
+void NmsEngine::clear()
+{
+    x1.clear();
+    y1.clear();
+    x2.clear();
+    y2.clear();
+    score.clear();
+    class_id.clear();
+}
+
+void NmsEngine::add(float x_min, float y_min, float x_max, float y_max,
+                    float s, int cls)
+{
+    x1.push_back(x_min);
+    y1.push_back(y_min);
+    x2.push_back(x_max);
+    y2.push_back(y_max);
+    score.push_back(s);
+    class_id.push_back(cls);
+}
+
+// maps a float onto an unsigned int that sorts in the same order
+static inline uint32_t float_sort_key(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+void NmsEngine::sort_candidates(const nms_params_t &params)
+{
+    const int n = size();
+
+    // pack (descending score, index) into one integer so the sort moves 8
+    // bytes per element and ties keep insertion order
+    keys.clear();
+    for (int i = 0; i < n; i++)
+    {
+        if (score[i] <= params.score_threshold)
+            continue;
+        keys.push_back(((uint64_t)~float_sort_key(score[i]) << 32) | (uint32_t)i);
+    }
+
+    if (params.top_k > 0 && params.top_k < (int)keys.size())
+    {
+        std::partial_sort(keys.begin(), keys.begin() + params.top_k, keys.end());
+        keys.resize(params.top_k);
+    }
+    else
+        std::sort(keys.begin(), keys.end());
+
+    order.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+        order[i] = (int)(keys[i] & 0xFFFFFFFFu);
+}
+
+// true if the box overlaps any of the first n working boxes by more than
+// thr of their union, written as inter > thr * union to avoid the divide
+static bool overlaps_any(const float *wx1, const float *wy1, const float *wx2,
+                         const float *wy2, const float *warea, const int *wcls,
+                         int n, float bx1, float by1, float bx2, float by2,
+                         int bcls, bool class_aware, float thr)
+{
+    const float barea = (bx2 - bx1) * (by2 - by1);
+    int j = 0;
+
+#ifdef __ARM_NEON
+    const float32x4_t vx1 = vdupq_n_f32(bx1);
+    const float32x4_t vy1 = vdupq_n_f32(by1);
+    const float32x4_t vx2 = vdupq_n_f32(bx2);
+    const float32x4_t vy2 = vdupq_n_f32(by2);
+    const float32x4_t varea = vdupq_n_f32(barea);
+    const float32x4_t vthr = vdupq_n_f32(thr);
+    const float32x4_t vzero = vdupq_n_f32(0.0f);
+    const int32x4_t vcls = vdupq_n_s32(bcls);
+    const uint32x4_t vall = vdupq_n_u32(class_aware ? 0 : 0xFFFFFFFFu);
+
+    for (; j + 4 <= n; j += 4)
+    {
+        float32x4_t w = vmaxq_f32(vsubq_f32(vminq_f32(vx2, vld1q_f32(wx2 + j)),
+                                            vmaxq_f32(vx1, vld1q_f32(wx1 + j))),
+                                  vzero);
+        float32x4_t h = vmaxq_f32(vsubq_f32(vminq_f32(vy2, vld1q_f32(wy2 + j)),
+                                            vmaxq_f32(vy1, vld1q_f32(wy1 + j))),
+                                  vzero);
+        float32x4_t inter = vmulq_f32(w, h);
+        float32x4_t uni = vsubq_f32(vaddq_f32(varea, vld1q_f32(warea + j)), inter);
+        uint32x4_t hit = vcgtq_f32(inter, vmulq_f32(vthr, uni));
+        hit = vandq_u32(hit, vorrq_u32(vall, vceqq_s32(vcls, vld1q_s32(wcls + j))));
+
+        uint32x2_t m = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+        if (vget_lane_u32(m, 0) | vget_lane_u32(m, 1))
+            return true;
+    }
+#else
+    // fixed width blocks without an early exit so the compiler can vectorize
+    for (; j + 8 <= n; j += 8)
+    {
+        int hit = 0;
+        for (int k = j; k < j + 8; k++)
+        {
+            float w = std::max(std::min(bx2, wx2[k]) - std::max(bx1, wx1[k]), 0.0f);
+            float h = std::max(std::min(by2, wy2[k]) - std::max(by1, wy1[k]), 0.0f);
+            float inter = w * h;
+            hit |= (inter > thr * (barea + warea[k] - inter)) &
+                   (!class_aware | (wcls[k] == bcls));
+        }
+        if (hit)
+            return true;
+    }
+#endif
+
+    for (; j < n; j++)
+    {
+        if (class_aware && wcls[j] != bcls)
+            continue;
+        float w = std::max(std::min(bx2, wx2[j]) - std::max(bx1, wx1[j]), 0.0f);
+        float h = std::max(std::min(by2, wy2[j]) - std::max(by1, wy1[j]), 0.0f);
+        float inter = w * h;
+        if (inter > thr * (barea + warea[j] - inter))
+            return true;
+    }
+
+    return false;
+}
+
+void NmsEngine::run(const nms_params_t &params, std::vector<int> &keep)
+{
+    keep.clear();
+    sort_candidates(params);
+    if (order.empty())
+        return;
+
+    wx1.clear();
+    wy1.clear();
+    wx2.clear();
+    wy2.clear();
+    warea.clear();
+    wscore.clear();
+    widx.clear();
+
+    switch (params.method)
+    {
+    case NMS_GRID:
+        run_grid(params, keep);
+        break;
+    case NMS_SOFT_LINEAR:
+    case NMS_SOFT_GAUSSIAN:
+        run_soft(params, keep);
+        break;
+    case NMS_HARD:
+    default:
+        run_hard(params, keep);
+        break;
+    }
+}
+
+void NmsEngine::run_hard(const nms_params_t &params, std::vector<int> &keep)
+{
+    // the working set holds the kept boxes, widx their class
+    for (int i : order)
+    {
+        if (overlaps_any(wx1.data(), wy1.data(), wx2.data(), wy2.data(),
+                         warea.data(), widx.data(), (int)wx1.size(),
+                         x1[i], y1[i], x2[i], y2[i], class_id[i],
+                         params.class_aware, params.iou_threshold))
+            continue;
+
+        wx1.push_back(x1[i]);
+        wy1.push_back(y1[i]);
+        wx2.push_back(x2[i]);
+        wy2.push_back(y2[i]);
+        warea.push_back((x2[i] - x1[i]) * (y2[i] - y1[i]));
+        widx.push_back(class_id[i]);
+        keep.push_back(i);
+
+        if (params.max_detections > 0 && (int)keep.size() >= params.max_detections)
+            break;
+    }
+}
+
+void NmsEngine::run_grid(const nms_params_t &params, std::vector<int> &keep)
+{
+    float min_x = x1[order[0]], min_y = y1[order[0]];
+    float max_x = x2[order[0]], max_y = y2[order[0]];
+    for (int i : order)
+    {
+        min_x = std::min(min_x, x1[i]);
+        min_y = std::min(min_y, y1[i]);
+        max_x = std::max(max_x, x2[i]);
+        max_y = std::max(max_y, y2[i]);
+    }
+
+    const float cell_w = std::max((max_x - min_x) / NMS_GRID_CELLS, 1e-6f);
+    const float cell_h = std::max((max_y - min_y) / NMS_GRID_CELLS, 1e-6f);
+
+    cells.resize(NMS_GRID_CELLS * NMS_GRID_CELLS);
+    for (auto &c : cells)
+        c.clear();
+
+    // stamp[k] is the last candidate kept box k was tested against, so a box
+    // spanning several cells is only tested once
+    stamp.clear();
+
+    auto cell_range = [&](int i, int *cx0, int *cy0, int *cx1, int *cy1)
+    {
+        *cx0 = std::min((int)((x1[i] - min_x) / cell_w), NMS_GRID_CELLS - 1);
+        *cy0 = std::min((int)((y1[i] - min_y) / cell_h), NMS_GRID_CELLS - 1);
+        *cx1 = std::min((int)((x2[i] - min_x) / cell_w), NMS_GRID_CELLS - 1);
+        *cy1 = std::min((int)((y2[i] - min_y) / cell_h), NMS_GRID_CELLS - 1);
+    };
+
+    for (int n = 0; n < (int)order.size(); n++)
+    {
+        const int i = order[n];
+        const float area = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+        int cx0, cy0, cx1, cy1;
+        cell_range(i, &cx0, &cy0, &cx1, &cy1);
+
+        bool suppressed = false;
+        for (int cy = cy0; cy <= cy1 && !suppressed; cy++)
+        {
+            for (int cx = cx0; cx <= cx1 && !suppressed; cx++)
+            {
+                for (int k : cells[cy * NMS_GRID_CELLS + cx])
+                {
+                    if (stamp[k] == n)
+                        continue;
+                    stamp[k] = n;
+
+                    if (params.class_aware && widx[k] != class_id[i])
+                        continue;
+                    float w = std::max(std::min(x2[i], wx2[k]) - std::max(x1[i], wx1[k]), 0.0f);
+                    float h = std::max(std::min(y2[i], wy2[k]) - std::max(y1[i], wy1[k]), 0.0f);
+                    float inter = w * h;
+                    if (inter > params.iou_threshold * (area + warea[k] - inter))
+                    {
+                        suppressed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (suppressed)
+            continue;
+
+        const int k = (int)wx1.size();
+        wx1.push_back(x1[i]);
+        wy1.push_back(y1[i]);
+        wx2.push_back(x2[i]);
+        wy2.push_back(y2[i]);
+        warea.push_back(area);
+        widx.push_back(class_id[i]);
+        stamp.push_back(-1);
+        keep.push_back(i);
+
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++)
+                cells[cy * NMS_GRID_CELLS + cx].push_back(k);
+
+        if (params.max_detections > 0 && (int)keep.size() >= params.max_detections)
+            break;
+    }
+}
+
+void NmsEngine::run_soft(const nms_params_t &params, std::vector<int> &keep)
+{
+    // the working set holds every remaining candidate, [0, n) is live
+    for (int i : order)
+    {
+        wx1.push_back(x1[i]);
+        wy1.push_back(y1[i]);
+        wx2.push_back(x2[i]);
+        wy2.push_back(y2[i]);
+        warea.push_back((x2[i] - x1[i]) * (y2[i] - y1[i]));
+        wscore.push_back(score[i]);
+        widx.push_back(i);
+    }
+
+    const bool linear = params.method == NMS_SOFT_LINEAR;
+    int n = (int)widx.size();
+
+    while (n > 0)
+    {
+        int best = 0;
+        for (int j = 1; j < n; j++)
+            if (wscore[j] > wscore[best])
+                best = j;
+
+        const int i = widx[best];
+        const float bx1 = wx1[best], by1 = wy1[best];
+        const float bx2 = wx2[best], by2 = wy2[best];
+        const float barea = warea[best];
+        score[i] = wscore[best];
+        keep.push_back(i);
+
+        if (params.max_detections > 0 && (int)keep.size() >= params.max_detections)
+            break;
+
+        // decay the rest against the box just kept and compact out anything
+        // that fell under the score threshold
+        int m = 0;
+        for (int j = 0; j < n; j++)
+        {
+            if (j == best)
+                continue;
+
+            float s = wscore[j];
+            if (!params.class_aware || class_id[widx[j]] == class_id[i])
+            {
+                float w = std::max(std::min(bx2, wx2[j]) - std::max(bx1, wx1[j]), 0.0f);
+                float h = std::max(std::min(by2, wy2[j]) - std::max(by1, wy1[j]), 0.0f);
+                float inter = w * h;
+                float uni = barea + warea[j] - inter;
+                float iou = (uni > 0.0f) ? inter / uni : 0.0f;
+
+                if (linear)
+                    s *= (iou > params.iou_threshold) ? (1.0f - iou) : 1.0f;
+                else
+                    s *= expf(-(iou * iou) / params.sigma);
+            }
+
+            if (s <= params.score_threshold)
+                continue;
+
+            wx1[m] = wx1[j];
+            wy1[m] = wy1[j];
+            wx2[m] = wx2[j];
+            wy2[m] = wy2[j];
+            warea[m] = warea[j];
+            wscore[m] = s;
+            widx[m] = widx[j];
+            m++;
+        }
+        n = m;
+    }
+}
@@ -19,8 +19,7 @@ int mcv_resize_image(const uint8_t* input, uint8_t* output, undistort_map_t* map
 
         // check for invalid (blank) pixels
         if(L[pix].I[0]<0){
-            output[pix] = 0;
-            printf("INVALID PIXEL\n");
+            output[pix] = map->pad;
             continue;
         }
 
@@ -59,9 +58,9 @@ int mcv_resize_8uc3_image(const uint8_t* rgb_input, uint8_t* output, undistort_m
         out_pix = pix * 3;
         // check for invalid (blank) pixels
         if(L[pix].I[0]<0){
-            output[out_pix] = 0;
-            output[out_pix+1] = 0;
-            output[out_pix+2] = 0;
+            output[out_pix] = map->pad;
+            output[out_pix+1] = map->pad;
+            output[out_pix+2] = map->pad;
             continue;
         }
 
@@ -114,27 +113,102 @@ int mcv_resize_8uc3_image(const uint8_t* rgb_input, uint8_t* output, undistort_m
         output[out_pix+1] = (	p4*L[pix].F[0] +
                                 p5*L[pix].F[1] +
                                 p6*L[pix].F[2] +
-                                p7*L[pix].F[3]) /256;
+                                p10*L[pix].F[3]) /256;
 
         // multiply add each pixel with weighting
         output[out_pix+2] = (	p8*L[pix].F[0]  +
                                 p9*L[pix].F[1]  +
-                                p10*L[pix].F[2] +
+                                p7*L[pix].F[2] +
                                 p11*L[pix].F[3]) /256;
 
     }
     return 0;
 }
 
+// fixed point BT.601 coefficients, same as opencv's yuv420sp to rgb conversion
+#define YUV_SHIFT   20
+#define YUV_HALF    (1 << (YUV_SHIFT - 1))
+#define YUV_CY      1220542
+#define YUV_CUB     2116026
+#define YUV_CUG     -409993
+#define YUV_CVG     -852492
+#define YUV_CVR     1673527
+
+static inline uint8_t _clamp_u8(int v)
+{
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+int mcv_resize_nv12_to_rgb(const uint8_t* y_plane, const uint8_t* uv_plane,
+                           uint8_t* output, undistort_map_t* map, int swap_uv)
+{
+    // shortcut variables to make code cleaner
+    int n_pix = map->w_out*map->h_out;
+    int w_in = map->w_in;
+    bilinear_lookup_t* L = map->L;
+    int u_off = swap_uv ? 1 : 0;
+    int v_off = swap_uv ? 0 : 1;
+
+    for(int pix=0; pix<n_pix; pix++){
+        uint8_t* out = &output[pix*3];
+
+        // check for invalid (blank) pixels
+        if(L[pix].I[0]<0){
+            out[0] = map->pad;
+            out[1] = map->pad;
+            out[2] = map->pad;
+            continue;
+        }
+
+        uint16_t x1 = L[pix].I[0];
+        uint16_t y1 = L[pix].I[1];
+
+        const uint8_t* y_row0 = &y_plane[w_in*y1 + x1];
+        const uint8_t* y_row1 = y_row0 + w_in;
+        int y = (y_row0[0]*L[pix].F[0] +
+                 y_row0[1]*L[pix].F[1] +
+                 y_row1[0]*L[pix].F[2] +
+                 y_row1[1]*L[pix].F[3]) /256;
+
+        // chroma is subsampled 2x in both directions, one UV pair per 2x2 block
+        const uint8_t* uv = &uv_plane[w_in*(y1>>1) + (x1 & ~1)];
+        int u = uv[u_off] - 128;
+        int v = uv[v_off] - 128;
+
+        int yy = (y > 16 ? y - 16 : 0) * YUV_CY;
+        out[0] = _clamp_u8((yy + YUV_HALF + YUV_CVR*v) >> YUV_SHIFT);
+        out[1] = _clamp_u8((yy + YUV_HALF + YUV_CVG*v + YUV_CUG*u) >> YUV_SHIFT);
+        out[2] = _clamp_u8((yy + YUV_HALF + YUV_CUB*u) >> YUV_SHIFT);
+    }
+    return 0;
+}
+
 int mcv_init_resize_map(int w_in, int h_in, int w_out, int h_out, undistort_map_t* map)
+{
+    return mcv_init_crop_resize_map(w_in, h_in, 0, 0, w_in, h_in, w_out, h_out, map);
+}
+
+// maps the crop onto the w_fit x h_fit region at (u0, v0) of the output,
+// everything else in the output is marked invalid
+static int _init_fit_resize_map(int w_in, int h_in, int x0, int y0, int w_crop, int h_crop,
+                                int w_out, int h_out, int u0, int v0, int w_fit, int h_fit,
+                                uint8_t pad, undistort_map_t* map)
 {
     map->h_out = h_out;
     map->w_out = w_out;
     map->h_in = h_in;
     map->w_in = w_in;
+    map->pad = pad;
+
+    if(x0 < 0 || y0 < 0 || w_crop < 2 || h_crop < 2 ||
+       x0 + w_crop > w_in || y0 + h_crop > h_in){
+        fprintf(stderr, "ERROR: crop %dx%d at (%d,%d) outside %dx%d input\n",
+                w_crop, h_crop, x0, y0, w_in, h_in);
+        map->L = NULL;
+        return -1;
+    }
 
     // allocate new map
-    // TODO some sanity and error checking here
     map->L = (bilinear_lookup_t*)malloc(w_out*h_out*sizeof(bilinear_lookup_t));
     if(map->L==NULL){
         perror("failed to allocate memory for lookup table");
@@ -142,20 +216,36 @@ int mcv_init_resize_map(int w_in, int h_in, int w_out, int h_out, undistort_map_
     }
     bilinear_lookup_t* L = map->L;
 
-    float x_r = ((float)(w_in - 1)/(float)(w_out));
-    float y_r = ((float)(h_in - 1)/(float)(h_out));
+    float x_r = ((float)(w_crop - 1)/(float)(w_fit));
+    float y_r = ((float)(h_crop - 1)/(float)(h_fit));
+
+    // output pixel u samples input x0 + (u - u0)*x_r, extended over the
+    // whole output that is the region the transform describes
+    map->T.x = x0 - u0*x_r;
+    map->T.y = y0 - v0*y_r;
+    map->T.w = w_out*x_r;
+    map->T.h = h_out*y_r;
 
     for(int v=0; v<h_out; ++v){
         for(int u=0; u<w_out; ++u){
-            int x_l = (x_r * u);
-            int y_l = (y_r * v);
+            int pix = w_out*v + u;
+
+            // letterbox padding
+            if(u < u0 || u >= u0 + w_fit || v < v0 || v >= v0 + h_fit){
+                L[pix].I[0] = -1;
+                L[pix].I[1] = -1;
+                continue;
+            }
+
+            // indices stay relative to the full input so the resize kernels
+            // read the crop straight out of the frame
+            int x_l = x0 + (int)(x_r * (u - u0));
+            int y_l = y0 + (int)(y_r * (v - v0));
             int x2 = x_l + 1;
             int y2 = y_l + 1;
             // x and y difference for top left point
-            float x_w = (x_r * u) - x_l;
-            float y_w = (y_r * v) - y_l;
-
-            int pix = w_out*v + u;
+            float x_w = (x_r * (u - u0)) - (x_l - x0);
+            float y_w = (y_r * (v - v0)) - (y_l - y0);
 
             if((x_l < 0 || x2 > (w_in-1)) || (y_l < 0 || y2 > (h_in-1))){
                 L[pix].I[0] = -1;
@@ -177,3 +267,105 @@ int mcv_init_resize_map(int w_in, int h_in, int w_out, int h_out, undistort_map_
     }
     return 0;
 }
+
+int mcv_init_crop_resize_map(int w_in, int h_in, int x0, int y0, int w_crop, int h_crop,
+                             int w_out, int h_out, undistort_map_t* map)
+{
+    return _init_fit_resize_map(w_in, h_in, x0, y0, w_crop, h_crop, w_out, h_out,
+                                0, 0, w_out, h_out, 0, map);
+}
+
+void mcv_letterbox_fit(int w_crop, int h_crop, int w_out, int h_out,
+                       int* u0, int* v0, int* w_fit, int* h_fit)
+{
+    // scale by the tighter side, the other one gets even padding
+    *w_fit = w_out;
+    *h_fit = h_out;
+    if((long)w_crop*h_out > (long)h_crop*w_out)
+        *h_fit = (int)((long)h_crop*w_out*2/w_crop + 1)/2;
+    else
+        *w_fit = (int)((long)w_crop*h_out*2/h_crop + 1)/2;
+    if(*w_fit < 1) *w_fit = 1;
+    if(*h_fit < 1) *h_fit = 1;
+    *u0 = (w_out - *w_fit)/2;
+    *v0 = (h_out - *h_fit)/2;
+}
+
+int mcv_init_letterbox_resize_map(int w_in, int h_in, int x0, int y0, int w_crop, int h_crop,
+                                  int w_out, int h_out, uint8_t pad, undistort_map_t* map)
+{
+    int u0, v0, w_fit, h_fit;
+    mcv_letterbox_fit(w_crop, h_crop, w_out, h_out, &u0, &v0, &w_fit, &h_fit);
+
+    return _init_fit_resize_map(w_in, h_in, x0, y0, w_crop, h_crop, w_out, h_out,
+                                u0, v0, w_fit, h_fit, pad, map);
+}
+
+int mcv_init_remap(int w_in, int h_in, int w_out, int h_out,
+                   const float* src_x, const float* src_y, uint8_t pad,
+                   undistort_map_t* map)
+{
+    map->h_out = h_out;
+    map->w_out = w_out;
+    map->h_in = h_in;
+    map->w_in = w_in;
+    map->pad = pad;
+    map->T.x = 0;
+    map->T.y = 0;
+    map->T.w = w_out;
+    map->T.h = h_out;
+
+    map->L = (bilinear_lookup_t*)malloc(w_out*h_out*sizeof(bilinear_lookup_t));
+    if(map->L==NULL){
+        perror("failed to allocate memory for lookup table");
+        return -1;
+    }
+    bilinear_lookup_t* L = map->L;
+
+    int n_pix = w_out*h_out;
+    for(int pix=0; pix<n_pix; pix++){
+        float x = src_x[pix];
+        float y = src_y[pix];
+
+        // also catches nan
+        if(!(x >= 0.0f && y >= 0.0f && x <= (float)(w_in-1) && y <= (float)(h_in-1))){
+            L[pix].I[0] = -1;
+            L[pix].I[1] = -1;
+            continue;
+        }
+
+        // the last row/column is read as the far corner of the square
+        // before it so the 2x2 read stays inside the image
+        int x_l = (int)x;
+        int y_l = (int)y;
+        if(x_l > w_in-2) x_l = w_in-2;
+        if(y_l > h_in-2) y_l = h_in-2;
+        float x_w = x - x_l;
+        float y_w = y - y_l;
+        // a full weight of 256 doesn't fit the uint8 coefficients
+        if(x_w > 255.0f/256) x_w = 255.0f/256;
+        if(y_w > 255.0f/256) y_w = 255.0f/256;
+
+        L[pix].I[0] = x_l;
+        L[pix].I[1] = y_l;
+        L[pix].F[0] = (1-x_w)*(1-y_w)*256;
+        L[pix].F[1] = (x_w)*(1-y_w)*256;
+        L[pix].F[2] = (y_w)*(1-x_w)*256;
+        L[pix].F[3] = (x_w)*(y_w)*256;
+    }
+    return 0;
+}
+
+void mcv_shift_resize_map(undistort_map_t* map, int dx, int dy)
+{
+    int n_pix = map->w_out*map->h_out;
+    bilinear_lookup_t* L = map->L;
+
+    for(int pix=0; pix<n_pix; pix++){
+        if(L[pix].I[0]<0) continue;
+        L[pix].I[0] += dx;
+        L[pix].I[1] += dy;
+    }
+    map->T.x += dx;
+    map->T.y += dy;
+}
@@ -0,0 +1,126 @@
+#include "scene_gate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+bool scene_thumbnail(const camera_image_metadata_t &meta, const uint8_t *frame,
+                     uint8_t *thumb)
+{
+    // planar formats start with the (left eye) Y plane, yuyv interleaves
+    // chroma between the luma bytes
+    int step;
+    switch (meta.format)
+    {
+    case IMAGE_FORMAT_RAW8:
+    case IMAGE_FORMAT_STEREO_RAW8:
+    case IMAGE_FORMAT_NV12:
+    case IMAGE_FORMAT_STEREO_NV12:
+    case IMAGE_FORMAT_NV21:
+    case IMAGE_FORMAT_STEREO_NV21:
+        step = 1;
+        break;
+    case IMAGE_FORMAT_YUV422:
+        step = 2;
+        break;
+    default:
+        return false;
+    }
+
+    const int width = meta.width;
+    const int height = meta.height;
+    if (width < SCENE_THUMB_W * SCENE_THUMB_SAMPLES ||
+        height < SCENE_THUMB_H * SCENE_THUMB_SAMPLES)
+        return false;
+
+    const int n = SCENE_THUMB_SAMPLES * SCENE_THUMB_SAMPLES;
+    for (int ty = 0; ty < SCENE_THUMB_H; ty++)
+    {
+        const int y0 = ty * height / SCENE_THUMB_H;
+        const int cell_h = (ty + 1) * height / SCENE_THUMB_H - y0;
+
+        for (int tx = 0; tx < SCENE_THUMB_W; tx++)
+        {
+            const int x0 = tx * width / SCENE_THUMB_W;
+            const int cell_w = (tx + 1) * width / SCENE_THUMB_W - x0;
+
+            int sum = 0;
+            for (int sy = 0; sy < SCENE_THUMB_SAMPLES; sy++)
+            {
+                const int y = y0 + (2 * sy + 1) * cell_h / (2 * SCENE_THUMB_SAMPLES);
+                const uint8_t *row = frame + (size_t)y * width * step;
+                for (int sx = 0; sx < SCENE_THUMB_SAMPLES; sx++)
+                    sum += row[(x0 + (2 * sx + 1) * cell_w / (2 * SCENE_THUMB_SAMPLES)) * step];
+            }
+            thumb[ty * SCENE_THUMB_W + tx] = (sum + n / 2) / n;
+        }
+    }
+    return true;
+}
+
+int scene_thumbnail_diff(const uint8_t *a, const uint8_t *b)
+{
+    int i = 0;
+    int max_diff = 0;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t m = vdupq_n_u8(0);
+    for (; i + 16 <= SCENE_THUMB_SIZE; i += 16)
+        m = vmaxq_u8(m, vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+    max_diff = vmaxvq_u8(m);
+#endif
+
+    for (; i < SCENE_THUMB_SIZE; i++)
+    {
+        const int d = abs(a[i] - b[i]);
+        if (d > max_diff)
+            max_diff = d;
+    }
+    return max_diff;
+}
+
+void SceneGate::configure(int _threshold, float max_interval_s)
+{
+    threshold = _threshold;
+    max_interval_ns = (int64_t)(max_interval_s * 1e9);
+}
+
+bool SceneGate::unchanged(const uint8_t *thumb, int64_t timestamp_ns)
+{
+    if (!has_reference || threshold <= 0)
+        return false;
+
+    frames_checked++;
+    if (scene_thumbnail_diff(thumb, reference) >= threshold)
+        return false;
+
+    if (timestamp_ns - reference_ns >= max_interval_ns)
+    {
+        frames_forced++;
+        return false;
+    }
+
+    frames_skipped++;
+    return true;
+}
+
+void SceneGate::set_reference(const uint8_t *thumb, int64_t timestamp_ns)
+{
+    memcpy(reference, thumb, SCENE_THUMB_SIZE);
+    reference_ns = timestamp_ns;
+    has_reference = true;
+}
+
+void SceneGate::print_stats()
+{
+    if (threshold <= 0)
+        return;
+
+    fprintf(stderr, "Scene gate: %d frames checked, %d skipped (%.1f%%), %d forced by max interval\n",
+            frames_checked, frames_skipped,
+            frames_checked > 0 ? 100.0 * frames_skipped / frames_checked : 0.0,
+            frames_forced);
+}
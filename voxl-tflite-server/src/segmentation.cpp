@@ -0,0 +1,192 @@
+#include "segmentation.h"
+#include <stddef.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+template <typename T>
+static inline void labels_to_mask(const T *classes, int n, uint8_t *mask)
+{
+    for (int i = 0; i < n; i++)
+    {
+        T c = classes[i];
+        mask[i] = (c >= 0 && c < SEG_INVALID_CLASS) ? (uint8_t)c : SEG_INVALID_CLASS;
+    }
+}
+
+void seg_mask_from_labels_i64(const int64_t *classes, int n, uint8_t *mask)
+{
+    labels_to_mask(classes, n, mask);
+}
+
+void seg_mask_from_labels_i32(const int32_t *classes, int n, uint8_t *mask)
+{
+    labels_to_mask(classes, n, mask);
+}
+
+// first index holding the max of p[0..c), the vector paths below only find
+// the max itself and use this scan for the index
+template <typename T>
+static inline uint8_t first_index_of(const T *p, int c, T best)
+{
+    for (int k = 0; k < c; k++)
+        if (p[k] == best)
+            return (uint8_t)k;
+    return 0;
+}
+
+template <typename T>
+static inline uint8_t argmax_scalar(const T *p, int c)
+{
+    int best = 0;
+    for (int k = 1; k < c; k++)
+        if (p[k] > p[best])
+            best = k;
+    return (uint8_t)best;
+}
+
+void seg_argmax_f32(const float *logits, int n, int num_classes, uint8_t *mask)
+{
+    for (int i = 0; i < n; i++, logits += num_classes)
+    {
+#ifdef __ARM_NEON
+        if (num_classes >= 8)
+        {
+            float32x4_t m = vld1q_f32(logits);
+            int k = 4;
+            for (; k + 4 <= num_classes; k += 4)
+                m = vmaxq_f32(m, vld1q_f32(logits + k));
+#ifdef __aarch64__
+            float best = vmaxvq_f32(m);
+#else
+            float32x2_t h = vpmax_f32(vget_low_f32(m), vget_high_f32(m));
+            float best = vget_lane_f32(vpmax_f32(h, h), 0);
+#endif
+            for (; k < num_classes; k++)
+                if (logits[k] > best)
+                    best = logits[k];
+            mask[i] = first_index_of(logits, num_classes, best);
+            continue;
+        }
+#endif
+        mask[i] = argmax_scalar(logits, num_classes);
+    }
+}
+
+void seg_argmax_u8(const uint8_t *logits, int n, int num_classes, uint8_t *mask)
+{
+    for (int i = 0; i < n; i++, logits += num_classes)
+    {
+#ifdef __aarch64__
+        if (num_classes >= 16)
+        {
+            uint8x16_t m = vld1q_u8(logits);
+            int k = 16;
+            for (; k + 16 <= num_classes; k += 16)
+                m = vmaxq_u8(m, vld1q_u8(logits + k));
+            uint8_t best = vmaxvq_u8(m);
+            for (; k < num_classes; k++)
+                if (logits[k] > best)
+                    best = logits[k];
+            mask[i] = first_index_of(logits, num_classes, best);
+            continue;
+        }
+#endif
+        mask[i] = argmax_scalar(logits, num_classes);
+    }
+}
+
+void seg_argmax_i8(const int8_t *logits, int n, int num_classes, uint8_t *mask)
+{
+    for (int i = 0; i < n; i++, logits += num_classes)
+    {
+#ifdef __aarch64__
+        if (num_classes >= 16)
+        {
+            int8x16_t m = vld1q_s8(logits);
+            int k = 16;
+            for (; k + 16 <= num_classes; k += 16)
+                m = vmaxq_s8(m, vld1q_s8(logits + k));
+            int8_t best = vmaxvq_s8(m);
+            for (; k < num_classes; k++)
+                if (logits[k] > best)
+                    best = logits[k];
+            mask[i] = first_index_of(logits, num_classes, best);
+            continue;
+        }
+#endif
+        mask[i] = argmax_scalar(logits, num_classes);
+    }
+}
+
+void seg_colorize_blend(const uint8_t *img, int img_stride, const uint8_t *mask,
+                        int width, int height, const seg_color_lut_t *lut,
+                        uint8_t *out, int out_stride)
+{
+#ifdef __aarch64__
+    const uint8x16x2_t tr = {{vld1q_u8(lut->r), vld1q_u8(lut->r + 16)}};
+    const uint8x16x2_t tg = {{vld1q_u8(lut->g), vld1q_u8(lut->g + 16)}};
+    const uint8x16x2_t tb = {{vld1q_u8(lut->b), vld1q_u8(lut->b + 16)}};
+    const uint8x8_t three = vdup_n_u8(3);
+#endif
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *src = img + (size_t)y * img_stride;
+        const uint8_t *m = mask + (size_t)y * width;
+        uint8_t *dst = out + (size_t)y * out_stride;
+        int x = 0;
+
+#ifdef __aarch64__
+        // 16 pixels per step, the table lookup returns 0 (black) for ids
+        // past the end of the 32 entry table just like the scalar path
+        for (; x + 16 <= width; x += 16)
+        {
+            uint8x16_t idx = vld1q_u8(m + x);
+            uint8x16x3_t px = vld3q_u8(src + 3 * x);
+            uint8x16_t col[3] = {vqtbl2q_u8(tr, idx), vqtbl2q_u8(tg, idx),
+                                 vqtbl2q_u8(tb, idx)};
+
+            for (int c = 0; c < 3; c++)
+            {
+                // (3 * img + color + 2) >> 2 in 16 bit
+                uint16x8_t lo = vmlal_u8(vmovl_u8(vget_low_u8(col[c])),
+                                         vget_low_u8(px.val[c]), three);
+                uint16x8_t hi = vmlal_u8(vmovl_u8(vget_high_u8(col[c])),
+                                         vget_high_u8(px.val[c]), three);
+                px.val[c] = vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2));
+            }
+            vst3q_u8(dst + 3 * x, px);
+        }
+#endif
+
+        for (; x < width; x++)
+        {
+            const uint8_t id = m[x];
+            const uint8_t r = id < SEG_MAX_COLORS ? lut->r[id] : 0;
+            const uint8_t g = id < SEG_MAX_COLORS ? lut->g[id] : 0;
+            const uint8_t b = id < SEG_MAX_COLORS ? lut->b[id] : 0;
+            dst[3 * x + 0] = (3 * src[3 * x + 0] + r + 2) >> 2;
+            dst[3 * x + 1] = (3 * src[3 * x + 1] + g + 2) >> 2;
+            dst[3 * x + 2] = (3 * src[3 * x + 2] + b + 2) >> 2;
+        }
+    }
+}
+
+int seg_rle_encode(const uint8_t *mask, int n, uint8_t *out)
+{
+    int len = 0;
+    int i = 0;
+    while (i < n)
+    {
+        const uint8_t id = mask[i];
+        int run = 1;
+        while (i + run < n && run < 255 && mask[i + run] == id)
+            run++;
+        out[len++] = id;
+        out[len++] = (uint8_t)run;
+        i += run;
+    }
+    return len;
+}
@@ -0,0 +1,189 @@
+#include "stereo.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+int stereo_mode_from_string(const char *str, StereoMode *mode)
+{
+    if (!strcmp(str, "left"))
+        *mode = STEREO_LEFT;
+    else if (!strcmp(str, "both"))
+        *mode = STEREO_BOTH;
+    else if (!strcmp(str, "alternate"))
+        *mode = STEREO_ALTERNATE;
+    else
+        return -1;
+
+    return 0;
+}
+
+size_t stereo_eye_bytes(const camera_image_metadata_t &meta)
+{
+    switch (meta.format)
+    {
+    case IMAGE_FORMAT_STEREO_RAW8:
+    case IMAGE_FORMAT_STEREO_NV12:
+    case IMAGE_FORMAT_STEREO_NV21:
+        return meta.size_bytes / 2;
+    default:
+        return 0;
+    }
+}
+
+bool StereoMatcher::init(const char *cam_name, int input_width, int input_height)
+{
+    calibrated = false;
+    if (stereo_calibration_load(cam_name, &cal))
+        return false;
+
+    width = input_width;
+    height = input_height;
+    const double sy = cal.right.height > 0 ? (double)cal.right.height / input_height : 1.0;
+    focal_right = (float)(cal.right.fy / sy);
+
+    const double *R = cal.R, *T = cal.T;
+    const double Tx[9] = {0, -T[2], T[1], T[2], 0, -T[0], -T[1], T[0], 0};
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+        {
+            E[i * 3 + j] = Tx[i * 3 + 0] * R[0 * 3 + j] + Tx[i * 3 + 1] * R[1 * 3 + j] +
+                           Tx[i * 3 + 2] * R[2 * 3 + j];
+            Rt[i * 3 + j] = R[j * 3 + i];
+        }
+    for (int i = 0; i < 3; i++)
+        C2[i] = -(Rt[i * 3 + 0] * T[0] + Rt[i * 3 + 1] * T[1] + Rt[i * 3 + 2] * T[2]);
+
+    calibrated = true;
+    return true;
+}
+
+void StereoMatcher::centers(const camera_calibration_t &c, const ai_detection_t *d, int n,
+                            std::vector<float> &rx, std::vector<float> &ry)
+{
+    px.resize(n);
+    py.resize(n);
+    rx.resize(n);
+    ry.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        px[i] = 0.5f * (d[i].x_min + d[i].x_max);
+        py[i] = 0.5f * (d[i].y_min + d[i].y_max);
+    }
+    camera_calibration_undistort_points(&c, width, height, px.data(), py.data(), n,
+                                        rx.data(), ry.data());
+}
+
+bool StereoMatcher::triangulate(float xl, float yl, float xr, float yr, float p[3])
+{
+    // left ray s * d1 from the origin, right ray C2 + t * d2, both in the
+    // left frame. Least squares s, t for the closest approach
+    const double d1[3] = {xl, yl, 1.0};
+    double d2[3];
+    for (int i = 0; i < 3; i++)
+        d2[i] = Rt[i * 3 + 0] * xr + Rt[i * 3 + 1] * yr + Rt[i * 3 + 2];
+
+    double a = 0, b = 0, c = 0, d = 0, e = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        a += d1[i] * d1[i];
+        b += d1[i] * d2[i];
+        c += d2[i] * d2[i];
+        d += d1[i] * C2[i];
+        e += d2[i] * C2[i];
+    }
+    const double denom = a * c - b * b;
+    if (denom < 1e-12) // parallel rays, too far to tell
+        return false;
+    const double s = (c * d - b * e) / denom;
+    const double t = (b * d - a * e) / denom;
+    if (s <= 0 || t <= 0)
+        return false;
+
+    for (int i = 0; i < 3; i++)
+        p[i] = (float)(0.5 * (s * d1[i] + C2[i] + t * d2[i]));
+    return true;
+}
+
+void StereoMatcher::match(const ai_detection_t *left, int n_left, const ai_detection_t *right,
+                          int n_right, const char *cam, int32_t frame_id,
+                          int64_t timestamp_ns, std::vector<ai_stereo_detection_t> &out)
+{
+    out.clear();
+    if (!calibrated || n_left == 0 || n_right == 0)
+        return;
+
+    centers(cal.left, left, n_left, lx, ly);
+    centers(cal.right, right, n_right, rx, ry);
+
+    pairs.clear();
+    for (int l = 0; l < n_left; l++)
+    {
+        const float hl = left[l].y_max - left[l].y_min;
+
+        // epipolar line of the left center in the right image, normalized
+        const double pl[3] = {lx[l], ly[l], 1.0};
+        double line[3];
+        for (int i = 0; i < 3; i++)
+            line[i] = E[i * 3 + 0] * pl[0] + E[i * 3 + 1] * pl[1] + E[i * 3 + 2] * pl[2];
+        const double norm = sqrt(line[0] * line[0] + line[1] * line[1]);
+        if (norm < 1e-12)
+            continue;
+
+        for (int r = 0; r < n_right; r++)
+        {
+            if (right[r].class_id != left[l].class_id)
+                continue;
+
+            const float hr = right[r].y_max - right[r].y_min;
+            if (hl <= 0 || hr <= 0 || std::max(hl, hr) > STEREO_MAX_SIZE_RATIO * std::min(hl, hr))
+                continue;
+
+            const double dist = fabs(line[0] * rx[r] + line[1] * ry[r] + line[2]) / norm;
+            const float cost = (float)(dist * focal_right) / hr;
+            if (cost < STEREO_MAX_EPIPOLAR)
+                pairs.push_back({l, r, cost});
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end(),
+              [](const pair_t &a, const pair_t &b) { return a.cost < b.cost; });
+    used_l.assign(n_left, false);
+    used_r.assign(n_right, false);
+
+    for (const pair_t &m : pairs)
+    {
+        if (used_l[m.l] || used_r[m.r])
+            continue;
+
+        float p[3];
+        if (!triangulate(lx[m.l], ly[m.l], rx[m.r], ry[m.r], p))
+            continue;
+        used_l[m.l] = used_r[m.r] = true;
+
+        const ai_detection_t &a = left[m.l];
+        const ai_detection_t &b = right[m.r];
+        ai_stereo_detection_t s;
+        memset(&s, 0, sizeof(s));
+        s.magic_number = AI_STEREO_DETECTION_MAGIC_NUMBER;
+        s.timestamp_ns = timestamp_ns;
+        s.frame_id = frame_id;
+        s.class_id = a.class_id;
+        memcpy(s.class_name, a.class_name, BUF_LEN);
+        strncpy(s.cam, cam, BUF_LEN - 1);
+        s.class_confidence = std::min(a.class_confidence, b.class_confidence);
+        s.left_x_min = a.x_min;
+        s.left_y_min = a.y_min;
+        s.left_x_max = a.x_max;
+        s.left_y_max = a.y_max;
+        s.right_x_min = b.x_min;
+        s.right_y_min = b.y_min;
+        s.right_x_max = b.x_max;
+        s.right_y_max = b.y_max;
+        s.x = p[0];
+        s.y = p[1];
+        s.z = p[2];
+        s.range = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        out.push_back(s);
+    }
+}
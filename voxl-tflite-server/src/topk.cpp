@@ -0,0 +1,104 @@
+#include "topk.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#define TOPK_BLOCK 16
+
+static inline float block_max(const float *x)
+{
+#ifdef __aarch64__
+    float32x4_t m = vmaxq_f32(vmaxq_f32(vld1q_f32(x), vld1q_f32(x + 4)),
+                              vmaxq_f32(vld1q_f32(x + 8), vld1q_f32(x + 12)));
+    return vmaxvq_f32(m);
+#else
+    float m = x[0];
+    for (int j = 1; j < TOPK_BLOCK; j++)
+        m = x[j] > m ? x[j] : m;
+    return m;
+#endif
+}
+
+static inline uint8_t block_max(const uint8_t *x)
+{
+#ifdef __aarch64__
+    return vmaxvq_u8(vld1q_u8(x));
+#else
+    uint8_t m = x[0];
+    for (int j = 1; j < TOPK_BLOCK; j++)
+        m = x[j] > m ? x[j] : m;
+    return m;
+#endif
+}
+
+static inline int8_t block_max(const int8_t *x)
+{
+#ifdef __aarch64__
+    return vmaxvq_s8(vld1q_s8(x));
+#else
+    int8_t m = x[0];
+    for (int j = 1; j < TOPK_BLOCK; j++)
+        m = x[j] > m ? x[j] : m;
+    return m;
+#endif
+}
+
+// insertion into the descending buffer, replaces the last entry once full
+template <typename T>
+static inline void insert(T v, int i, int k, int &count, int *idx, T *val)
+{
+    int pos = count < k ? count++ : k - 1;
+    while (pos > 0 && val[pos - 1] < v)
+    {
+        val[pos] = val[pos - 1];
+        idx[pos] = idx[pos - 1];
+        pos--;
+    }
+    val[pos] = v;
+    idx[pos] = i;
+}
+
+template <typename T>
+static int topk(const T *x, int n, int k, int *idx, T *val)
+{
+    if (k > n)
+        k = n;
+    if (k <= 0)
+        return 0;
+
+    int count = 0;
+    int i = 0;
+    for (; i < k; i++)
+        insert(x[i], i, k, count, idx, val);
+
+    for (; i + TOPK_BLOCK <= n; i += TOPK_BLOCK)
+    {
+        if (!(block_max(x + i) > val[k - 1]))
+            continue;
+        for (int j = i; j < i + TOPK_BLOCK; j++)
+            if (x[j] > val[k - 1])
+                insert(x[j], j, k, count, idx, val);
+    }
+
+    for (; i < n; i++)
+        if (x[i] > val[k - 1])
+            insert(x[i], i, k, count, idx, val);
+
+    return count;
+}
+
+int topk_f32(const float *x, int n, int k, int *idx, float *val)
+{
+    return topk(x, n, k, idx, val);
+}
+
+int topk_u8(const uint8_t *x, int n, int k, int *idx, uint8_t *val)
+{
+    return topk(x, n, k, idx, val);
+}
+
+int topk_i8(const int8_t *x, int n, int k, int *idx, int8_t *val)
+{
+    return topk(x, n, k, idx, val);
+}
@@ -0,0 +1,277 @@
+#include "tracker.h"
+#include <math.h>
+#include <algorithm>
+
+static float median(std::vector<float> &v)
+{
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+static float iou(const track_t &t, const detection_candidate_t &c)
+{
+    const float ix = std::min(t.x_max(), (float)(c.x + c.w)) - std::max(t.x_min(), (float)c.x);
+    const float iy = std::min(t.y_max(), (float)(c.y + c.h)) - std::max(t.y_min(), (float)c.y);
+    if (ix <= 0.0f || iy <= 0.0f)
+        return 0.0f;
+    const float inter = ix * iy;
+    return inter / (t.w.p * t.h.p + (float)c.w * c.h - inter);
+}
+
+void Tracker::set_view(float x, float y, float model_per_input_x, float model_per_input_y)
+{
+    views[cur] = {x, y, model_per_input_x, model_per_input_y};
+}
+
+float Tracker::min_confidence() const
+{
+    float m = 1.0f;
+    for (const track_t &t : tracks)
+        m = std::min(m, t.confidence);
+    return m;
+}
+
+void Tracker::predict(int64_t timestamp_ns)
+{
+    const float dt = (last_ns > 0 && timestamp_ns > last_ns) ? (timestamp_ns - last_ns) * 1e-9f : 0.0f;
+    last_ns = timestamp_ns;
+
+    for (track_t &t : tracks)
+    {
+        t.cx.predict(dt, TRACK_POS_ACCEL_NOISE);
+        t.cy.predict(dt, TRACK_POS_ACCEL_NOISE);
+        t.w.predict(dt, TRACK_SIZE_ACCEL_NOISE);
+        t.h.predict(dt, TRACK_SIZE_ACCEL_NOISE);
+        t.age++;
+    }
+}
+
+void Tracker::start_track(const detection_candidate_t &c, float score)
+{
+    const float r = TRACK_DET_SIGMA * TRACK_DET_SIGMA;
+    track_t t;
+    t.id = next_id++;
+    t.class_id = c.class_id;
+    t.confidence = score;
+    t.age = 0;
+    t.misses = 0;
+    t.propagated = false;
+    t.cx.init(c.x + 0.5f * c.w, r, 100.0f * 100.0f);
+    t.cy.init(c.y + 0.5f * c.h, r, 100.0f * 100.0f);
+    t.w.init(c.w, r, 10.0f * 10.0f);
+    t.h.init(c.h, r, 10.0f * 10.0f);
+    tracks.push_back(t);
+}
+
+void Tracker::update(const std::vector<detection_candidate_t> &candidates,
+                     const std::vector<int> &keep, NmsEngine &nms, int64_t timestamp_ns)
+{
+    predict(timestamp_ns);
+
+    // greedy association, highest overlap first, same class only
+    pairs.clear();
+    for (size_t ti = 0; ti < tracks.size(); ti++)
+    {
+        for (size_t k = 0; k < keep.size(); k++)
+        {
+            const detection_candidate_t &c = candidates[keep[k]];
+            if (c.class_id != tracks[ti].class_id)
+                continue;
+            const float o = iou(tracks[ti], c);
+            if (o >= TRACK_IOU_THRESHOLD)
+                pairs.push_back({o, {(int)ti, (int)k}});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(),
+              [](const std::pair<float, std::pair<int, int>> &a,
+                 const std::pair<float, std::pair<int, int>> &b) { return a.first > b.first; });
+
+    track_matched.assign(tracks.size(), 0);
+    det_matched.assign(keep.size(), 0);
+
+    const float r = TRACK_DET_SIGMA * TRACK_DET_SIGMA;
+    for (const auto &p : pairs)
+    {
+        const int ti = p.second.first;
+        const int k = p.second.second;
+        if (track_matched[ti] || det_matched[k])
+            continue;
+        track_matched[ti] = det_matched[k] = 1;
+
+        track_t &t = tracks[ti];
+        const detection_candidate_t &c = candidates[keep[k]];
+        t.cx.correct(c.x + 0.5f * c.w - t.cx.p, r);
+        t.cy.correct(c.y + 0.5f * c.h - t.cy.p, r);
+        t.w.correct(c.w - t.w.p, r);
+        t.h.correct(c.h - t.h.p, r);
+        t.confidence = nms.get_score(keep[k]);
+        t.misses = 0;
+        t.propagated = false;
+    }
+
+    // unmatched tracks coast on their prediction until they run out of misses
+    size_t n = 0;
+    for (size_t ti = 0; ti < tracks.size(); ti++)
+    {
+        track_t &t = tracks[ti];
+        if (!track_matched[ti])
+        {
+            t.misses++;
+            t.confidence *= 0.5f;
+            t.propagated = true;
+            if (t.misses > TRACK_MAX_MISSES || t.confidence < TRACK_DROP_CONFIDENCE)
+                continue;
+        }
+        tracks[n++] = t;
+    }
+    tracks.resize(n);
+
+    for (size_t k = 0; k < keep.size(); k++)
+        if (!det_matched[k])
+            start_track(candidates[keep[k]], nms.get_score(keep[k]));
+
+    cur ^= 1;
+}
+
+void Tracker::propagate(int64_t timestamp_ns)
+{
+    const cv::Mat &prev = frames[cur ^ 1];
+    const cv::Mat &next = frames[cur];
+    const view_t &pv = views[cur ^ 1];
+    const view_t &v = views[cur];
+
+    if (tracks.empty() || prev.empty() || prev.size() != next.size() ||
+        pv.x != v.x || pv.y != v.y || pv.sx != v.sx || pv.sy != v.sy)
+    {
+        predict(timestamp_ns);
+        cur ^= 1;
+        return;
+    }
+
+    // grid of points inside every box at its last position, in model pixels
+    prev_pts.clear();
+    for (const track_t &t : tracks)
+    {
+        for (int j = 0; j < TRACK_GRID; j++)
+        {
+            for (int i = 0; i < TRACK_GRID; i++)
+            {
+                const float fx = (i + 0.5f) / TRACK_GRID;
+                const float fy = (j + 0.5f) / TRACK_GRID;
+                prev_pts.push_back(cv::Point2f((t.x_min() + fx * t.w.p - v.x) * v.sx,
+                                               (t.y_min() + fy * t.h.p - v.y) * v.sy));
+            }
+        }
+    }
+
+    cv::calcOpticalFlowPyrLK(prev, next, prev_pts, next_pts, status, err,
+                             cv::Size(15, 15), 2);
+
+    // box the flow puts each track at, measured before predict() moves it
+    struct flow_box_t { float cx, cy, w, h, agree; };
+    std::vector<flow_box_t> boxes(tracks.size());
+
+    const int per_track = TRACK_GRID * TRACK_GRID;
+    for (size_t ti = 0; ti < tracks.size(); ti++)
+    {
+        const track_t &t = tracks[ti];
+        const int base = ti * per_track;
+        boxes[ti].agree = 0.0f;
+
+        dx.clear();
+        dy.clear();
+        for (int k = base; k < base + per_track; k++)
+        {
+            if (!status[k])
+                continue;
+            dx.push_back(next_pts[k].x - prev_pts[k].x);
+            dy.push_back(next_pts[k].y - prev_pts[k].y);
+        }
+        if (dx.size() < 3)
+            continue;
+
+        scratch.assign(dx.begin(), dx.end());
+        const float mdx = median(scratch);
+        scratch.assign(dy.begin(), dy.end());
+        const float mdy = median(scratch);
+
+        // points moving with the median are the object, the rest is
+        // background, occlusion or a failed match
+        float pcx = 0, pcy = 0, ncx = 0, ncy = 0;
+        int inliers = 0;
+        for (int k = base, m = 0; k < base + per_track; k++)
+        {
+            if (!status[k])
+                continue;
+            if (fabsf(dx[m] - mdx) + fabsf(dy[m] - mdy) < 2.0f)
+            {
+                pcx += prev_pts[k].x;
+                pcy += prev_pts[k].y;
+                ncx += next_pts[k].x;
+                ncy += next_pts[k].y;
+                inliers++;
+            }
+            m++;
+        }
+        if (inliers < 3)
+            continue;
+        pcx /= inliers;
+        pcy /= inliers;
+        ncx /= inliers;
+        ncy /= inliers;
+
+        // scale change from the spread of the inliers around their center
+        ratio.clear();
+        for (int k = base, m = 0; k < base + per_track; k++)
+        {
+            if (!status[k])
+                continue;
+            if (fabsf(dx[m] - mdx) + fabsf(dy[m] - mdy) < 2.0f)
+            {
+                const float d0 = hypotf(prev_pts[k].x - pcx, prev_pts[k].y - pcy);
+                const float d1 = hypotf(next_pts[k].x - ncx, next_pts[k].y - ncy);
+                if (d0 > 1.0f)
+                    ratio.push_back(d1 / d0);
+            }
+            m++;
+        }
+        const float scale = ratio.size() >= 3 ? median(ratio) : 1.0f;
+
+        boxes[ti].agree = (float)inliers / per_track;
+        boxes[ti].cx = t.cx.p + mdx / v.sx;
+        boxes[ti].cy = t.cy.p + mdy / v.sy;
+        boxes[ti].w = t.w.p * scale;
+        boxes[ti].h = t.h.p * scale;
+    }
+
+    predict(timestamp_ns);
+
+    const float r = TRACK_FLOW_SIGMA * TRACK_FLOW_SIGMA;
+    size_t n = 0;
+    for (size_t ti = 0; ti < tracks.size(); ti++)
+    {
+        track_t &t = tracks[ti];
+        const flow_box_t &b = boxes[ti];
+        t.propagated = true;
+
+        if (b.agree >= TRACK_MIN_FLOW_RATIO)
+        {
+            t.cx.correct(b.cx - t.cx.p, r);
+            t.cy.correct(b.cy - t.cy.p, r);
+            t.w.correct(b.w - t.w.p, r);
+            t.h.correct(b.h - t.h.p, r);
+            t.confidence *= b.agree;
+        }
+        else
+        {
+            // flow lost the object, coast on the prediction
+            t.confidence *= 0.5f;
+        }
+
+        if (t.confidence >= TRACK_DROP_CONFIDENCE)
+            tracks[n++] = t;
+    }
+    tracks.resize(n);
+
+    cur ^= 1;
+}
@@ -0,0 +1,192 @@
+#include "yolo_decode.h"
+#include <algorithm>
+#include <stddef.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+// anchors per block in the v8 decoder, the running max/argmax for a block
+// stays in L1 while the class rows stream past it
+#define YOLOV8_BLOCK 256
+
+#ifdef __ARM_NEON
+static inline float hmax_f32(float32x4_t v)
+{
+#ifdef __aarch64__
+    return vmaxvq_f32(v);
+#else
+    float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+    m = vpmax_f32(m, m);
+    return vget_lane_f32(m, 0);
+#endif
+}
+
+static inline bool any_u32(uint32x4_t v)
+{
+#ifdef __aarch64__
+    return vmaxvq_u32(v) != 0;
+#else
+    uint32x2_t m = vorr_u32(vget_low_u32(v), vget_high_u32(v));
+    return (vget_lane_u32(m, 0) | vget_lane_u32(m, 1)) != 0;
+#endif
+}
+#endif
+
+// max of n scores, never below 0
+static inline float max_positive(const float *p, int n)
+{
+    float best = 0.0f;
+    int i = 0;
+
+#ifdef __ARM_NEON
+    if (n >= 8)
+    {
+        float32x4_t m0 = vdupq_n_f32(0.0f);
+        float32x4_t m1 = vdupq_n_f32(0.0f);
+        for (; i + 8 <= n; i += 8)
+        {
+            m0 = vmaxq_f32(m0, vld1q_f32(p + i));
+            m1 = vmaxq_f32(m1, vld1q_f32(p + i + 4));
+        }
+        best = hmax_f32(vmaxq_f32(m0, m1));
+    }
+#endif
+
+    for (; i < n; i++)
+        if (p[i] > best)
+            best = p[i];
+
+    return best;
+}
+
+void yolov5_decode(const float *data, int num_anchors, int num_classes,
+                   float box_thresh, float class_thresh,
+                   float scale_x, float scale_y,
+                   std::vector<detection_candidate_t> &out)
+{
+    const int stride = num_classes + 5;
+
+    for (int a = 0; a < num_anchors; a++, data += stride)
+    {
+        // most anchors are background, reject before touching the classes
+        const float box_conf = data[4];
+        if (box_conf < box_thresh)
+            continue;
+
+        const float *scores = data + 5;
+        const float conf = max_positive(scores, num_classes);
+        if (conf < class_thresh)
+            continue;
+
+        // first class holding the max, same tie-break as a linear scan
+        int32_t class_id = 0;
+        for (int c = 0; c < num_classes; c++)
+        {
+            if (scores[c] == conf)
+            {
+                class_id = c;
+                break;
+            }
+        }
+
+        // no need to add the grid offset or exp, the export bakes both in
+        int32_t cx = static_cast<int32_t>(data[0] * scale_x);
+        int32_t cy = static_cast<int32_t>(data[1] * scale_y);
+        int32_t w = static_cast<int32_t>(data[2] * scale_x);
+        int32_t h = static_cast<int32_t>(data[3] * scale_y);
+
+        out.push_back({class_id, conf, box_conf, cx - w / 2, cy - h / 2, w, h});
+    }
+}
+
+static inline void yolov8_emit(const float *data, int num_anchors, int a,
+                               int32_t class_id, float score,
+                               float scale_x, float scale_y,
+                               std::vector<detection_candidate_t> &out)
+{
+    float xc = data[a];
+    float yc = data[num_anchors + a];
+    float w = data[2 * num_anchors + a];
+    float h = data[3 * num_anchors + a];
+
+    int left = int((xc - 0.5 * w) * scale_x);
+    int top = int((yc - 0.5 * h) * scale_y);
+    int width = int(w * scale_x);
+    int height = int(h * scale_y);
+
+    out.push_back({class_id, score, -1.0f, left, top, width, height});
+}
+
+void yolov8_decode(const float *data, int num_anchors, int num_channels,
+                   int num_classes, float score_thresh,
+                   float scale_x, float scale_y,
+                   std::vector<detection_candidate_t> &out)
+{
+    num_classes = std::min(num_classes, num_channels);
+    if (num_classes <= 0)
+        return;
+
+    const float *scores = data + 4 * (size_t)num_anchors;
+    float best[YOLOV8_BLOCK];
+    int32_t best_id[YOLOV8_BLOCK];
+
+    for (int base = 0; base < num_anchors; base += YOLOV8_BLOCK)
+    {
+        const int n = std::min(YOLOV8_BLOCK, num_anchors - base);
+
+        // class 0 seeds the running max and later classes only replace it
+        // when strictly greater, so ties go to the lowest class id
+        std::copy(scores + base, scores + base + n, best);
+        std::fill(best_id, best_id + n, 0);
+
+        for (int c = 1; c < num_classes; c++)
+        {
+            const float *row = scores + (size_t)c * num_anchors + base;
+            int i = 0;
+
+#ifdef __ARM_NEON
+            const int32x4_t vc = vdupq_n_s32(c);
+            for (; i + 4 <= n; i += 4)
+            {
+                float32x4_t v = vld1q_f32(row + i);
+                float32x4_t b = vld1q_f32(best + i);
+                uint32x4_t gt = vcgtq_f32(v, b);
+                vst1q_f32(best + i, vbslq_f32(gt, v, b));
+                vst1q_s32(best_id + i, vbslq_s32(gt, vc, vld1q_s32(best_id + i)));
+            }
+#endif
+
+            for (; i < n; i++)
+            {
+                if (row[i] > best[i])
+                {
+                    best[i] = row[i];
+                    best_id[i] = c;
+                }
+            }
+        }
+
+        int i = 0;
+
+#ifdef __ARM_NEON
+        // test four anchors at a time, nearly every group is rejected here
+        const float32x4_t vt = vdupq_n_f32(score_thresh);
+        for (; i + 4 <= n; i += 4)
+        {
+            if (!any_u32(vcgtq_f32(vld1q_f32(best + i), vt)))
+                continue;
+
+            for (int j = i; j < i + 4; j++)
+                if (best[j] > score_thresh)
+                    yolov8_emit(data, num_anchors, base + j, best_id[j], best[j],
+                                scale_x, scale_y, out);
+        }
+#endif
+
+        for (; i < n; i++)
+            if (best[i] > score_thresh)
+                yolov8_emit(data, num_anchors, base + i, best_id[i], best[i],
+                            scale_x, scale_y, out);
+    }
+}